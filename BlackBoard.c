@@ -5,19 +5,29 @@
 #include <sys/types.h> 
 #include <unistd.h> 
 #include <stdlib.h>
-#define _XOPEN_SOURCE_EXTENDED
-#include <locale.h>
-#include <ncurses.h>
 #include <sys/time.h>
 #include <time.h>
 #include <math.h>
 #include <stdbool.h>
 #include <errno.h>
 #include <sys/file.h>
+#include <pthread.h>
 #include "logger.h"
 #include <signal.h>
 #include "logger_custom.h"
-#define MAX_ITEMS 20
+#include "world_state.h"
+#include "ipc_frame.h"
+#include "render.h"
+#include "force_field.h"
+#include "spatial_grid.h"
+#include "tick_scheduler.h"
+#include "swarm_state.h"
+#include "session_record.h"
+#include "heartbeat.h"
+#include "latency_hist.h"
+#include "dead_reckoning.h"
+#define MAX_ITEMS 65536   // Per kind (obstacles, targets); the oldest is dropped when full
+#define MAX_REMOTES 64   // Remote drones from the network (server: clients, client: server + peers)
 typedef struct {
     int x;
     int y;
@@ -33,34 +43,92 @@ int mass;
 int k_intial ;
 int working_area;
 int t_intial;  
-int H = 0, W = 0;
+int swarm_size = 0;            // Parameter file: drones in swarm mode, 0 = single drone
+int render_fps = 20;           // Parameter file: terminal frame rate cap, 0 = every tick
 int wh = 0, ww = 0;
 bool running = true;
 bool skip_drone_update = false;
-bool repulsion_sent = false;
-bool colors_enabled = false;
-Point obstacles[MAX_ITEMS];
-int obs_head = 0;
-int obs_count = 0;
-
-Point targets[MAX_ITEMS];
-int tar_head = 0;
-int tar_count = 0;
+FieldSources field_sources;    // Obstacles (and client drones) pushing our drone, SoA
+bool headless = false;         // No curses: scripted input, state written to state_out
+FILE *state_out = NULL;
+unsigned long state_tick = 0;
+SpatialGrid obstacles;         // Keyed on window cells, see spatial_grid.h
+SpatialGrid targets;
+int near_ids[FIELD_MAX_SOURCES];   // Obstacles returned by the repulsion radius query
+
+// Remote drones keyed by the id the server gave them (0 = server drone).
+// pos is where the dead reckoning puts the drone this tick.
+typedef struct {
+    int id;
+    Point pos;
+    DrTrack track;
+} RemoteDrone;
+RemoteDrone remotes[MAX_REMOTES];
+int remote_count = 0;
+DrParams dr_params;            // Remote drone model, see dead_reckoning.h
+
+// Shared world state (NULL when Drone/BlackBoard talk over pipes)
+WorldState *world = NULL;
+uint32_t reset_gen_sent = 0;   // Resets published to the drone so far
+FrameWriter toDrone, toRepul, toComm;
+
+// Swarm mode: the Drone process integrates the swarm, we draw it
+SwarmState *swarm = NULL;
+float swarm_x[SWARM_MAX_DRONES], swarm_y[SWARM_MAX_DRONES];
+int swarm_count = 0;
+uint32_t swarm_reset_gen = 1;  // Bumped to re-form the swarm at the centre
+SwarmArena arena;
+bool items_dirty = true;       // Obstacles/targets/remote drones changed since last publish
+
+// Session recording / replay of our inputs, see session_record.h
+int session_mode = SESSION_OFF;
+bool replaying = false;
+SessionWriter session_out;
+SessionReader session_in;
+uint32_t bb_tick = 0;          // Frames drawn so far, the session time base
+
+// Key -> frame latency, see latency_hist.h. The main loop records drone->BB;
+// the render thread records BB->frame and the whole path.
+LatencyHist lat_drone_bb, lat_bb_frame, lat_key_frame;
+uint64_t key_t_in = 0;         // Newest key stamp seen in a drone position
+uint64_t key_t_taken = 0;      // When we took that position
+
+// Render thread: the main loop fills a snapshot of what to draw once per
+// tick and swaps it in; the render thread draws the newest snapshot. Only
+// the render thread calls ncurses, so a slow terminal never delays the pipes
+// or the repulsion sent to the drone.
+enum { CELL_EMPTY, CELL_OBSTACLE, CELL_TARGET, CELL_SWARM };
 
-Point remote_drone={-1,-1};
-bool remote_drone_valid = false;
+typedef struct {
+    int ww, wh;
+    unsigned char *cells;          // ww x wh CELL_* codes
+    size_t cells_cap;
+    RemoteDrone remotes[MAX_REMOTES];
+    int remote_count;
+    int mode;
+    float drone_x, drone_y;
+    bool show_drone;               // Single drone (swarm drones are in cells)
+    bool paused;
+    uint64_t t_in_us, t_taken_us;  // key_t_in / key_t_taken when filled
+} ViewSnapshot;
+
+ViewSnapshot views[2];
+ViewSnapshot *view_back = &views[0];    // Filled by the main loop
+ViewSnapshot *view_front = &views[1];   // Newest complete snapshot, drawn by the render thread
+pthread_mutex_t view_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t view_cond = PTHREAD_COND_INITIALIZER;
+pthread_t render_tid;
+bool render_running = false;
+// Guarded by view_lock
+bool view_fresh = false;           // view_front not drawn yet
+bool view_stop = false;
+bool view_ready = false;           // Curses set up, view_w x view_h valid
+bool view_resized = false;         // Terminal resized, not yet taken by the main loop
+int view_w = 0, view_h = 0;
 
 // sig_atomic_t ensures atomic access during signal handling
-volatile sig_atomic_t health_check = 0;
 volatile sig_atomic_t should_exit = 0;
 
-// Handler for health check signal from watchdog
-void handle_signal(int signo) {
-    if (signo == SIGUSR1) {
-        health_check = 1; // Mark that we received a ping
-    }
-}
-
 //termination handler from master process
 void handle_terminate(int signo) {
     if (signo == SIGTERM) {
@@ -89,12 +157,13 @@ void Parameter_File() {
         // The words are separated by a token defined in the parameter file.
         char* tokens[10]; 
         int token_count = 0;
-        char* token = strtok(line, "_");
+        char* save = NULL; // strtok_r: other components may be parsing in the same process
+        char* token = strtok_r(line, "_", &save);
 
         while (token != NULL && token_count < 10) {
             tokens[token_count] = token;
             token_count++;
-            token = strtok(NULL, "_"); 
+            token = strtok_r(NULL, "_", &save); 
         }
 
         // Assign the respective values to the global parameters
@@ -126,50 +195,518 @@ void Parameter_File() {
             case 9:
                 if (token_count > 2) t_intial = atoi(tokens[2]);
                 break;
+            case 14:
+                if (token_count > 2) swarm_size = atoi(tokens[2]);
+                break;
+            case 15:
+                if (token_count > 2) render_fps = atoi(tokens[2]);
+                break;
         }
     }
     fclose(file);
 }
 
-static void layout_and_draw(WINDOW *win) {
-    
-    getmaxyx(stdscr, H, W);
-
-    // Window with fixed margin
-    wh = (H > 6) ? H - 6 : H;
-    ww = (W > 10) ? W - 10 : W;
-    if (wh < 3) wh = 3;
-    if (ww < 3) ww = 3;
-
-    // Resize and recenter window
-    wresize(win, wh, ww);
-    mvwin(win, (H - wh) / 2, (W - ww) / 2);
-
-    // Clean up and draw again
-    werase(stdscr);
-    werase(win);
-    if (colors_enabled) {
-        wattron(win, COLOR_PAIR(4));
-        box(win, 0, 0);
-        wattroff(win, COLOR_PAIR(4));
-    } else {
-        box(win, 0, 0);
-    }
-   
-
-    refresh();
-    wrefresh(win);
+  
+// Move the drone: over fdFromBB, or as a reset in the shared world state
+static void send_drone_position(float x, float y) {
+    if (swarm != NULL) return;   // Swarm resets go through the arena
+    if (world != NULL) {
+        world_publish_reset(world, x, y);
+        reset_gen_sent++;
+        return;
+    }
+    frame_send_position(&toDrone, (int)x, (int)y, 0);
+}
+
+// A drone position carrying a key stamp we have not seen yet ends the
+// drone->BB stage (sent_us: when the Drone sent or published it)
+static void take_key_stamp(uint64_t t_in_us, uint64_t sent_us) {
+    if (t_in_us == 0 || t_in_us == key_t_in) return;
+    uint64_t now = lat_now_us();
+    lat_record(&lat_drone_bb, now - sent_us);
+    key_t_in = t_in_us;
+    key_t_taken = now;
+}
+
+static void log_latency(const LatencyHist *h, const char *when) {
+    char buf[160];
+    lat_format(h, buf, sizeof(buf));
+    LOG_INFO("BlackBoard", "Latency%s: %s", when, buf);
+}
+
+// Send MY drone position to the communication process (networked modes)
+static void forward_to_comm(float x, float y) {
+    if (frame_send_position(&toComm, x, y, 0) == -1) {
+        // If error is Broken Pipe, the Server is dead.
+        if (errno == EPIPE) {
+            LOG_ERROR("BlackBoard", "CommServer died (Broken Pipe).");
+            // Optional: running = false; // Exit if you want BB to die when Server dies
+        }
+    }
+}
+
+// Store a new obstacle/target, dropping the oldest one when the grid is full
+static void add_item(SpatialGrid *g, int x, int y) {
+    if (grid_insert(g, x, y) == -1) {
+        grid_remove(g, g->oldest);
+        grid_insert(g, x, y);
+    }
+    items_dirty = true;
+}
+
+// Store an obstacle/target sent in parameter-file coordinates, scaled to the current window
+static void receive_item(SpatialGrid *g, int new_x, int new_y) {
+    //apply to current window size
+    float ratio_x = (float)new_x / (float)window_width;
+    float ratio_y = (float)new_y / (float)window_height;
+
+    //Aplies to current window size
+    new_x=ratio_x*ww;
+    new_y=ratio_y*wh;
+
+    // Clamp to window dimensions to prevent vanishing
+    if (new_x >= ww - 1) new_x = ww - 2;
+    if (new_y >= wh - 1) new_y = wh - 2;
+
+    if (session_mode == SESSION_RECORD) {
+        session_record(&session_out, bb_tick, (g == &obstacles) ? SESS_OBSTACLE : SESS_TARGET,
+                       0, new_x, new_y);
+    }
+    add_item(g, new_x, new_y);
+}
+
+// Rescale every item of g from the old window size to the new one
+static void rescale_items(SpatialGrid *g, int old_ww, int old_wh) {
+    for (int id = g->oldest; id != -1; id = g->items[id].newer) {
+        GridItem *it = &g->items[id];
+        it->x = (int)(((float)it->x * ww) / old_ww);
+        it->y = (int)(((float)it->y * wh) / old_wh);
+        // Clamp to window dimensions to prevent vanishing
+        if (it->x >= ww - 1) it->x = ww - 2;
+        if (it->y >= wh - 1) it->y = wh - 2;
+    }
+    if (grid_resize(g, ww, wh) == -1) {
+        LOG_ERROR("BlackBoard", "Out of memory resizing the item grid");
+        running = false;
+    }
+}
+
+// Mark each occupied cell, so the cost is bounded by the window size
+static void snap_items(ViewSnapshot *v, const SpatialGrid *g, unsigned char code) {
+    for (int y = 1; y < g->h && y < v->wh; y++) {
+        for (int x = 1; x < g->w && x < v->ww; x++) {
+            if (grid_cell_first(g, x, y) != -1) v->cells[y * v->ww + x] = code;
+        }
+    }
+}
+
+// Remove every target on cell (x, y)
+static void collect_targets_at(int x, int y) {
+    int id = grid_cell_first(&targets, x, y);
+    while (id != -1) {
+        int next = targets.items[id].next;
+        if (targets.items[id].x == x && targets.items[id].y == y) {
+            grid_remove(&targets, id);
+            items_dirty = true;
+        }
+        id = next;
+    }
+}
+
+// Window size, the newest obstacles and the reset generation for the swarm
+static void publish_arena(void) {
+    arena.reset_gen = swarm_reset_gen;
+    arena.width = ww;
+    arena.height = wh;
+    arena.obs_count = 0;
+    for (int id = obstacles.newest; id != -1 && arena.obs_count < SWARM_MAX_OBSTACLES;
+         id = obstacles.items[id].older) {
+        arena.obs_x[arena.obs_count] = obstacles.items[id].x;
+        arena.obs_y[arena.obs_count] = obstacles.items[id].y;
+        arena.obs_count++;
+    }
+    swarm_publish_arena(swarm, &arena);
+}
+
+// Mark each window cell holding at least one swarm drone
+static void snap_swarm(ViewSnapshot *v) {
+    for (int i = 0; i < swarm_count; i++) {
+        int x = (int)swarm_x[i], y = (int)swarm_y[i];
+        if (x <= 0 || x >= v->ww || y <= 0 || y >= v->wh) continue;
+        v->cells[y * v->ww + x] = CELL_SWARM;
+    }
+}
+
+// Fill the back snapshot with the current frame and hand it to the render thread
+static void view_publish(int mode, float x, float y, bool paused) {
+    ViewSnapshot *v = view_back;
+    size_t need = (size_t)ww * (size_t)wh;
+    if (need > v->cells_cap) {
+        unsigned char *cells = realloc(v->cells, need);
+        if (cells == NULL) return;   // Keep showing the previous frame
+        v->cells = cells;
+        v->cells_cap = need;
+    }
+    v->ww = ww;
+    v->wh = wh;
+    memset(v->cells, CELL_EMPTY, need);
+    snap_items(v, &obstacles, CELL_OBSTACLE);
+    snap_items(v, &targets, CELL_TARGET);
+    if (swarm != NULL) snap_swarm(v);
+    v->remote_count = remote_count;
+    memcpy(v->remotes, remotes, sizeof(RemoteDrone) * (size_t)remote_count);
+    v->mode = mode;
+    v->drone_x = x;
+    v->drone_y = y;
+    v->show_drone = (swarm == NULL);
+    v->paused = paused;
+    v->t_in_us = key_t_in;
+    v->t_taken_us = key_t_taken;
+
+    // The render thread only holds the lock while it copies a snapshot into
+    // its cell buffer, never while it writes to the terminal
+    pthread_mutex_lock(&view_lock);
+    view_back = view_front;
+    view_front = v;
+    view_fresh = true;
+    pthread_cond_signal(&view_cond);
+    pthread_mutex_unlock(&view_lock);
+}
+
+// Render thread: compose a snapshot with the render.c calls
+static void view_draw(const ViewSnapshot *v) {
+    static const char *glyphs[] = { NULL, "O", "T", "+" };
+    static const int pairs[] = { 0, RENDER_OBSTACLE, RENDER_TARGET, RENDER_DRONE };
+
+    render_clear();
+    for (int y = 0; y < v->wh; y++) {
+        for (int x = 0; x < v->ww; x++) {
+            unsigned char c = v->cells[y * v->ww + x];
+            if (c != CELL_EMPTY) render_glyph(y, x, pairs[c], false, glyphs[c]);
+        }
+    }
+
+    for (int i = 0; v->mode != 1 && i < v->remote_count; i++) {
+        Point rp = v->remotes[i].pos;
+        // Remote drone is out of bounds, skip drawing
+        if (rp.x <= 0 || rp.x >= v->ww || rp.y <= 0 || rp.y >= v->wh) continue;
+
+        // Draw client drones as 'C'
+        if (v->mode == 2 || v->remotes[i].id != 0) {
+            render_glyph(rp.y, rp.x, RENDER_OBSTACLE, false, "C");
+        }
+        else {
+            // Client sees server drone (display only, different color)
+            render_glyph(rp.y, rp.x, RENDER_DRONE, true, "S");
+        }
+    }
+
+    if (v->show_drone) render_glyph((int)v->drone_y, (int)v->drone_x, RENDER_DRONE, false, "+");
+    if (v->paused) render_text(0, 0, "Game Paused, Press 'u' to Resume");
+}
+
+static void *render_main(void *arg) {
+    (void)arg;
+    int w, h;
+    render_init(RENDER_CURSES, window_width, window_height, &w, &h);
+    render_set_max_fps(render_fps);
+
+    pthread_mutex_lock(&view_lock);
+    view_w = w;
+    view_h = h;
+    view_ready = true;
+    pthread_cond_broadcast(&view_cond);
+
+    struct timespec last_report;
+    clock_gettime(CLOCK_MONOTONIC, &last_report);
+    char stats[256];
+    uint64_t pend_in = 0, pend_taken = 0;   // Key stamp of the newest composed frame
+    uint64_t shown_in = 0;                  // Key stamp already on screen
+    while (!view_stop) {
+        // Wake for every snapshot, and at least every 50 ms to notice resizes
+        if (!view_fresh) {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += 50 * 1000000L;
+            if (until.tv_nsec >= 1000000000L) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&view_cond, &view_lock, &until);
+        }
+        bool fresh = view_fresh;
+        if (fresh) {
+            view_draw(view_front);
+            pend_in = view_front->t_in_us;
+            pend_taken = view_front->t_taken_us;
+            view_fresh = false;
+        }
+        pthread_mutex_unlock(&view_lock);
+
+        // Terminal output happens without the lock
+        if (fresh && render_present() && pend_in != 0 && pend_in != shown_in) {
+            uint64_t now = lat_now_us();
+            lat_record(&lat_bb_frame, now - pend_taken);
+            lat_record(&lat_key_frame, now - pend_in);
+            shown_in = pend_in;
+        }
+        if (render_poll_resize(&w, &h)) {
+            pthread_mutex_lock(&view_lock);
+            view_w = w;
+            view_h = h;
+            view_resized = true;
+            pthread_mutex_unlock(&view_lock);
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec - last_report.tv_sec >= 10) {
+            render_format_stats(stats, sizeof(stats));
+            LOG_INFO("BlackBoard", "Render stats: %s", stats);
+            log_latency(&lat_bb_frame, "");
+            log_latency(&lat_key_frame, "");
+            last_report = now;
+        }
+        pthread_mutex_lock(&view_lock);
+    }
+    pthread_mutex_unlock(&view_lock);
+
+    render_format_stats(stats, sizeof(stats));
+    LOG_INFO("BlackBoard", "Render stats at exit: %s", stats);
+    log_latency(&lat_bb_frame, " at exit");
+    log_latency(&lat_key_frame, " at exit");
+    render_close();
+    return NULL;
+}
+
+// Start the render thread and wait for the terminal size (the map size)
+static int view_start(int *w, int *h) {
+    if (pthread_create(&render_tid, NULL, render_main, NULL) != 0) return -1;
+    render_running = true;
+    pthread_mutex_lock(&view_lock);
+    while (!view_ready) pthread_cond_wait(&view_cond, &view_lock);
+    *w = view_w;
+    *h = view_h;
+    pthread_mutex_unlock(&view_lock);
+    return 0;
+}
+
+// New map size if the terminal was resized since the last call
+static bool view_take_resize(int *w, int *h) {
+    if (!render_running) return false;
+    pthread_mutex_lock(&view_lock);
+    bool resized = view_resized;
+    if (resized) {
+        *w = view_w;
+        *h = view_h;
+        view_resized = false;
+    }
+    pthread_mutex_unlock(&view_lock);
+    return resized;
+}
+
+// Stop the render thread (it restores the terminal), or close the headless backend
+static void view_stop_thread(void) {
+    if (!render_running) {
+        render_close();
+        return;
+    }
+    pthread_mutex_lock(&view_lock);
+    view_stop = true;
+    pthread_cond_signal(&view_cond);
+    pthread_mutex_unlock(&view_lock);
+    pthread_join(render_tid, NULL);
+    render_running = false;
+    free(views[0].cells);
+    free(views[1].cells);
+}
+
+// Apply one frame from the communication process:
+// FRAME_REMOTE adds or moves remote drone <id>, FRAME_REMOTE_DEL removes it
+static void handle_remote_frame(const Frame *frame) {
+    if (session_mode == SESSION_RECORD) {
+        if (frame->hdr.type == FRAME_REMOTE_DEL) {
+            session_record(&session_out, bb_tick, SESS_REMOTE_DEL, frame->u.del.id, 0, 0);
+        } else if (frame->hdr.type == FRAME_REMOTE) {
+            session_record(&session_out, bb_tick, SESS_REMOTE, frame->u.remote.id,
+                           frame->u.remote.x, frame->u.remote.y);
+        }
+    }
+
+    if (frame->hdr.type == FRAME_REMOTE_DEL) {
+        int id = frame->u.del.id;
+        for (int i = 0; i < remote_count; i++) {
+            if (remotes[i].id == id) {
+                remotes[i] = remotes[--remote_count];
+                items_dirty = true;
+                LOG_INFO("BlackBoard", "Remote drone %d left", id);
+                break;
+            }
+        }
+        return;
+    }
+
+    if (frame->hdr.type != FRAME_REMOTE) return;
+    int id = frame->u.remote.id;
+    float x = frame->u.remote.x;
+    float y = frame->u.remote.y;
+    if (session_mode == SESSION_RECORD) {
+        // The velocity goes first so that replay has it when the position comes
+        session_record(&session_out, bb_tick, SESS_REMOTE_VEL, id, frame->u.remote.vx, frame->u.remote.vy);
+    }
+
+    RemoteDrone *r = NULL;
+    for (int i = 0; i < remote_count; i++) {
+        if (remotes[i].id == id) { r = &remotes[i]; break; }
+    }
+    if (r == NULL) {
+        if (remote_count >= MAX_REMOTES) {
+            LOG_WARNING("BlackBoard", "Remote drone table full, ignoring drone %d", id);
+            return;
+        }
+        r = &remotes[remote_count++];
+        memset(r, 0, sizeof(*r));
+        r->id = id;
+        LOG_INFO("BlackBoard", "Remote drone %d joined", id);
+    }
+
+    // Age of the sample on the Comm process's clock (the same CLOCK_MONOTONIC)
+    uint64_t now = lat_now_us();
+    float age_s = (frame->u.remote.t_us != 0 && now > frame->u.remote.t_us)
+                  ? (now - frame->u.remote.t_us) / 1e6f : 0.0f;
+    dr_sample(&r->track, &dr_params, x, y, frame->u.remote.vx, frame->u.remote.vy, age_s);
+    float rx, ry;
+    dr_position(&r->track, &rx, &ry);
+    r->pos.x = (int)rx;
+    r->pos.y = (int)ry;
+    items_dirty = true;
+}
+
+// Move every remote drone on by one tick of dead reckoning
+static void step_remotes(void) {
+    for (int i = 0; i < remote_count; i++) {
+        RemoteDrone *r = &remotes[i];
+        dr_step(&r->track, &dr_params);
+        float rx, ry;
+        dr_position(&r->track, &rx, &ry);
+        if ((int)rx != r->pos.x || (int)ry != r->pos.y) {
+            r->pos.x = (int)rx;
+            r->pos.y = (int)ry;
+            items_dirty = true;
+        }
+    }
+}
+
+// Replay: feed the inputs recorded for this frame through the same paths as
+// the live pipes. Returns false once the session is over.
+static bool replay_tick(char *sIn) {
+    SessionEvent ev;
+    bool more = true;
+    float vx = 0, vy = 0;          // From the SESS_REMOTE_VEL before a SESS_REMOTE
+    while (session_next(&session_in, bb_tick, &ev)) {
+        Frame frame;
+        switch (ev.type) {
+            case SESS_KEY:
+                // A quit always wins, otherwise the newest command is used
+                if (sIn[0] != 'q') {
+                    sIn[0] = (char)ev.id;
+                    sIn[1] = '\0';
+                }
+                break;
+            case SESS_OBSTACLE:
+            case SESS_TARGET: {
+                // Recorded in the recording's window, kept inside ours
+                int x = (int)ev.a, y = (int)ev.b;
+                if (x >= ww - 1) x = ww - 2;
+                if (y >= wh - 1) y = wh - 2;
+                add_item((ev.type == SESS_OBSTACLE) ? &obstacles : &targets, x, y);
+                break;
+            }
+            case SESS_REMOTE_VEL:
+                vx = ev.a;
+                vy = ev.b;
+                break;
+            case SESS_REMOTE:
+                frame.hdr.type = FRAME_REMOTE;
+                frame.u.remote.id = ev.id;
+                frame.u.remote.x = ev.a;
+                frame.u.remote.y = ev.b;
+                frame.u.remote.vx = vx;
+                frame.u.remote.vy = vy;
+                frame.u.remote.t_us = 0;    // Taken on this tick
+                handle_remote_frame(&frame);
+                vx = vy = 0;
+                break;
+            case SESS_REMOTE_DEL:
+                frame.hdr.type = FRAME_REMOTE_DEL;
+                frame.u.del.id = ev.id;
+                handle_remote_frame(&frame);
+                break;
+            case SESS_END:
+                more = false;
+                break;
+        }
+    }
+    return more && !session_finished(&session_in);
+}
+
+// Headless output: one JSON object per line
+// {"tick":N,"t_ms":T,"drone":[x,y],"obstacles":[[x,y],...],"targets":[...],"remotes":[[id,x,y],...]}
+static void emit_state(float x, float y) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    long long t_ms = (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+    fprintf(state_out, "{\"tick\":%lu,\"t_ms\":%lld,\"drone\":[%.2f,%.2f],\"obstacles\":[",
+            state_tick++, t_ms, x, y);
+    for (int id = obstacles.oldest; id != -1; id = obstacles.items[id].newer) {
+        fprintf(state_out, "%s[%d,%d]", id != obstacles.oldest ? "," : "",
+                obstacles.items[id].x, obstacles.items[id].y);
+    }
+    fputs("],\"targets\":[", state_out);
+    for (int id = targets.oldest; id != -1; id = targets.items[id].newer) {
+        fprintf(state_out, "%s[%d,%d]", id != targets.oldest ? "," : "",
+                targets.items[id].x, targets.items[id].y);
+    }
+    fputs("],\"remotes\":[", state_out);
+    for (int i = 0; i < remote_count; i++) {
+        fprintf(state_out, "%s[%d,%d,%d]", i ? "," : "", remotes[i].id, remotes[i].pos.x, remotes[i].pos.y);
+    }
+    fputs("]", state_out);
+    if (swarm != NULL) fprintf(state_out, ",\"swarm\":%d", swarm_count);
+    fputs("}\n", state_out);
+    fflush(state_out);
+}
+
+// Copy the newest obstacles/targets (up to WORLD_MAX_ITEMS) and the remote
+// drones into the shared world state
+static void publish_items(void) {
+    ItemsSnapshot items;
+    memset(&items, 0, sizeof(items));
+    for (int id = obstacles.newest; id != -1 && items.obs_count < WORLD_MAX_ITEMS;
+         id = obstacles.items[id].older) {
+        items.obstacles[items.obs_count].x = obstacles.items[id].x;
+        items.obstacles[items.obs_count].y = obstacles.items[id].y;
+        items.obs_count++;
+    }
+    for (int id = targets.newest; id != -1 && items.tar_count < WORLD_MAX_ITEMS;
+         id = targets.items[id].older) {
+        items.targets[items.tar_count].x = targets.items[id].x;
+        items.targets[items.tar_count].y = targets.items[id].y;
+        items.tar_count++;
+    }
+    items.remote_count = (remote_count < WORLD_MAX_REMOTES) ? remote_count : WORLD_MAX_REMOTES;
+    for (int i = 0; i < items.remote_count; i++) {
+        items.remotes[i].x = remotes[i].pos.x;
+        items.remotes[i].y = remotes[i].pos.y;
+    }
+    world_publish_items(world, &items);
 }
   
 int main(int argc, char *argv[]) {
 
     // Setup signal handling FIRST
     struct sigaction sa;
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = handle_signal;
-    sigemptyset(&sa.sa_mask);
-    sigaction(SIGUSR1, &sa, NULL);
-
     memset(&sa, 0, sizeof(sa));
     sa.sa_handler = handle_terminate;
     sa.sa_flags =0; // Restart interrupted syscalls
@@ -179,53 +716,19 @@ int main(int argc, char *argv[]) {
     
     // LOG SELF immediately
     log_process("BlackBoard", getpid());
-    logger_init("system.log",0);
+    logger_init_mode("system.log", 0, LOG_MODE_ASYNC);
     LOG_INFO("BlackBoard", "Starting BlackBoard Process (PID=%d)", getpid());
     
-    pid_t watchdog_pid = -1;
-    int retries = 0;
-    while (watchdog_pid == -1 && retries < 10) {
-        sleep(1);
-        watchdog_pid = get_pid_by_name("Watchdog");
-        retries++;
-    }
-    
-    if (watchdog_pid == -1) {
-        LOG_WARNING("BlackBoard","Could not find Watchdog! Exiting.\n");
-        return 1;
-    }
     Parameter_File();
-    
-    setlocale(LC_ALL, "");
-
-    initscr();
-    cbreak();
-    noecho();
-    keypad(stdscr, TRUE);
-    (void)curs_set(0);
-    if (has_colors()) {
-        start_color();
-        use_default_colors();
-        init_pair(1, COLOR_CYAN, -1);  // drone
-        init_pair(2, COLOR_GREEN, -1); // target
-        init_pair(3, COLOR_RED, -1);   // obstacle
-        init_pair(4, COLOR_BLUE, -1);  // border
-        colors_enabled = true;
+    lat_init(&lat_drone_bb, "drone->BB");
+    lat_init(&lat_bb_frame, "BB->frame");
+    lat_init(&lat_key_frame, "key->frame");
+
+    // Watchdog: one heartbeat per loop, at least one per frame
+    if (heartbeat_register("BlackBoard", t_intial * 3 / 2) == -1) {
+        LOG_WARNING("BlackBoard", "Heartbeat table unavailable, not monitored by the watchdog");
     }
     
-    int term_h, term_w;
-    getmaxyx(stdscr, term_h, term_w);
-    // Parameter file values clamped to terminal size 
-    int win_h = (window_height > 0) ? window_height : term_h;
-    int win_w = (window_width  > 0) ? window_width  : term_w;
-    if (win_h > term_h) win_h = term_h;
-    if (win_w > term_w) win_w = term_w;
-
-    WINDOW *win = newwin(win_w, win_h, 0, 0);
-    layout_and_draw(win);
-    // Allow window to report keys / KEY_RESIZE without blocking
-    keypad(win, TRUE);
-    wtimeout(win, 50); // wait up to 50 ms in wgetch, then continue to select()
 
     // Standardized exit codes
     #define USAGE_ERROR 64
@@ -237,7 +740,6 @@ int main(int argc, char *argv[]) {
     {
         fprintf(stderr, "Usage: %s <fd>\n", argv[0]);
         LOG_CRITICAL("BlackBoard", "Insufficient arguments provided.");
-        endwin();
         exit(USAGE_ERROR);
     }
 
@@ -247,31 +749,109 @@ int main(int argc, char *argv[]) {
     int fdOb = atoi(argv[3]);    
     int fdTa = atoi(argv[4]);    
     char *path_bb = argv[5];
-    int fdIn_BB = open(path_bb, O_RDONLY | O_NONBLOCK);
+    int fdIn_BB = chan_open(path_bb, O_RDONLY | O_NONBLOCK);   // Named pipe, or a channel when threaded
     if (fdIn_BB == -1) { LOG_ERRNO("BlackBoard","Failed to open In_BB Pipe"); return OPEN_FAIL; }
     int fdRepul =atoi(argv[6]);
     int fdComm_FromBB = atoi(argv[7]);
     int fdComm_ToBB = atoi(argv[8]);
     int mode = atoi(argv[9]);       //1,2,3
+    int use_shm = (argc > 10) ? atoi(argv[10]) : 0;   // 1 = shared-memory world state
+    // Headless: world state output ("" = curses)
+    const char *state_path = (argc > 11 && argv[11][0] != '\0') ? argv[11] : NULL;
+    const char *session_path = NULL;
+    if (argc > 13) {
+        session_mode = atoi(argv[12]);
+        session_path = argv[13];
+    }
+    replaying = (session_mode == SESSION_REPLAY || session_mode == SESSION_REPLAY_FAST);
+
+    if (state_path != NULL) {
+        headless = true;
+        state_out = (strcmp(state_path, "-") == 0) ? stdout : fopen(state_path, "w");
+        if (state_out == NULL) {
+            LOG_ERRNO("BlackBoard", "Failed to open headless state output");
+            exit(OPEN_FAIL);
+        }
+        LOG_INFO("BlackBoard", "Headless mode, world state written to %s", state_path);
+    }
+
+    if (session_mode == SESSION_RECORD) {
+        if (session_open(&session_out, session_path, SESSION_BB) == -1) {
+            LOG_ERRNO("BlackBoard", "Failed to open the session file, not recording");
+            session_mode = SESSION_OFF;
+        }
+    } else if (replaying) {
+        if (session_load(&session_in, session_path, SESSION_BB) == -1) {
+            LOG_ERRNO("BlackBoard", "Failed to load the session file");
+            exit(OPEN_FAIL);
+        }
+        t_intial = session_in.hdr.tick_ms;   // Draw at the recorded rate
+        LOG_INFO("BlackBoard", "Replaying %zu events", session_in.count);
+    }
+
+    if (use_shm) {
+        world = world_attach();
+        if (world == NULL) {
+            LOG_CRITICAL("BlackBoard", "Failed to attach shared world state");
+            exit(OPEN_FAIL);
+        }
+        LOG_INFO("BlackBoard", "Using shared-memory world state");
+    }
+
+    if (headless) {
+        render_init(RENDER_HEADLESS, window_width, window_height, &ww, &wh);
+    } else if (view_start(&ww, &wh) == -1) {
+        LOG_CRITICAL("BlackBoard", "Failed to start the render thread");
+        exit(RUNTIME_ERROR);
+    }
+    if (grid_init(&obstacles, ww, wh, MAX_ITEMS) == -1 || grid_init(&targets, ww, wh, MAX_ITEMS) == -1) {
+        LOG_CRITICAL("BlackBoard", "Failed to allocate the item grids");
+        view_stop_thread();
+        exit(RUNTIME_ERROR);
+    }
+    uint32_t drone_gen_seen = 0;   // Last drone snapshot consumed (shared-memory mode)
 
-    struct timeval tv;
     int retval;
-    char strOb[100], strTa[100], strIn[100], strComm_ToBB[100]; 
-    char sToBB[135],sFromBB[135],sIn[10],sRepul[40];
-    char format_stringOb[100] = "%d,%d";
-    char format_stringTa[100] = "%d,%d"; 
-    float x_ToBB, y_ToBB; 
+    char sIn[10];
+    FrameReader droneReader, obReader, taReader, inReader, commReader;
+    frame_reader_init(&droneReader, fdToBB);
+    frame_reader_init(&obReader, fdOb);
+    frame_reader_init(&taReader, fdTa);
+    frame_reader_init(&inReader, fdIn_BB);
+    frame_reader_init(&commReader, fdComm_ToBB);
+    frame_writer_init(&toDrone, fdFromBB);
+    frame_writer_init(&toRepul, fdRepul);
+    frame_writer_init(&toComm, fdComm_FromBB);
+    Frame frame;
 
     
-    float dx,dy;
-    float distance;
-
+    FieldParams field;
+    field_params_init(&field, rph_intial, eta_intial);
+    dr_params_init(&dr_params, mass, k_intial, t_intial / 1000.0f);
+
+    // One frame every T ms; pipes are read as soon as they have data
+    // Only the obstacle/target pipes in standalone mode, the communication pipe otherwise;
+    // a replay reads its inputs from the session and only listens to the drone
+    TickScheduler sched;
+    bool sched_ok = tick_init(&sched, t_intial, TICK_MAX_CATCHUP) == 0 &&
+                    tick_watch(&sched, fdToBB) == 0;
+    if (sched_ok && replaying) {
+        if (session_mode == SESSION_REPLAY_FAST) tick_set_unpaced(&sched);
+    } else if (sched_ok && mode == 1) {
+        sched_ok = tick_watch(&sched, fdIn_BB) == 0 && tick_watch(&sched, fdOb) == 0 &&
+                   tick_watch(&sched, fdTa) == 0;
+    } else if (sched_ok) {
+        sched_ok = tick_watch(&sched, fdIn_BB) == 0 && tick_watch(&sched, fdComm_ToBB) == 0;
+    }
+    if (!sched_ok) {
+        LOG_ERRNO("BlackBoard", "Failed to set up the tick scheduler");
+        view_stop_thread();
+        exit(RUNTIME_ERROR);
+    }
     fd_set readfds;
-    int maxfd = fdToBB;
-    if (fdOb > maxfd) maxfd = fdOb;
-    if (fdTa > maxfd) maxfd = fdTa;
-    if (fdIn_BB > maxfd) maxfd = fdIn_BB;
-    if (mode != 1 && fdComm_ToBB > maxfd) maxfd = fdComm_ToBB;
+    int steps = 0;
+    bool paused = false;
+    sIn[0] = '\0';
 
     // Persistent Coordinates (Initialize off-screen or valid default)
     // Removed single coordinates in favor of arrays
@@ -282,9 +862,19 @@ int main(int argc, char *argv[]) {
     float y_curr = wh / 2.0;
     
 
+    // Swarm mode (standalone only): the drones come from the swarm segment
+    if (swarm_size > 0 && mode == 1) {
+        swarm = swarm_attach();
+        if (swarm == NULL) {
+            LOG_WARNING("BlackBoard", "Swarm state unavailable, showing a single drone");
+        } else {
+            LOG_INFO("BlackBoard", "Swarm mode, %d drones", swarm_size);
+            publish_arena();
+        }
+    }
+
     // Initial handshake with drone to get starting position
-    snprintf(sFromBB, sizeof(sFromBB), "%.0f,%.0f", x_curr, y_curr);
-    write(fdFromBB, sFromBB, strlen(sFromBB) + 1);
+    send_drone_position(x_curr, y_curr);
 
     if(running == false){
         exit(0);
@@ -299,96 +889,22 @@ int main(int argc, char *argv[]) {
             break;
         }
         
-        int ch = wgetch(win); // poll window for keys (returns KEY_RESIZE)
-        sIn[0]='\0';
-        repulsion_sent = false;
-
-        if (ch == KEY_RESIZE) {
-            // Store old window dimensions for scaling
-            int old_ww = ww;
-            int old_wh = wh;
-
-            // Update ncurses internal structures for new dimensions
-            resize_term(0, 0);
-            layout_and_draw(win);
-
-            // Recalculate and reproportionate obstacles
-            for (int i = 0; i < obs_count; i++) {
-                mvwprintw(win, obstacles[i].y, obstacles[i].x, " ");
-                obstacles[i].x = (int)(((float)obstacles[i].x * ww) / old_ww);
-                obstacles[i].y = (int)(((float)obstacles[i].y * wh) / old_wh);
-                wattron(win, COLOR_PAIR(3));
-                mvwprintw(win, obstacles[i].y, obstacles[i].x, "O");
-                wattroff(win, COLOR_PAIR(3));
-                // Clamp to window dimensions to prevent vanishing
-                if (obstacles[i].x >= ww - 1) obstacles[i].x = ww - 2;
-                if (obstacles[i].y >= wh - 1) obstacles[i].y = wh - 2;
-            }
-
-            // Recalculate and reproportionate targets
-            for (int i = 0; i < tar_count; i++) {
-                mvwprintw(win, targets[i].y, targets[i].x, " ");
-                targets[i].x = (int)(((float)targets[i].x * ww) / old_ww);
-                targets[i].y = (int)(((float)targets[i].y * wh) / old_wh);
-                wattron(win, COLOR_PAIR(2));
-                mvwprintw(win, targets[i].y, targets[i].x, "T");
-                wattroff(win, COLOR_PAIR(2));
-                // Clamp to window dimensions to prevent vanishing
-                if (targets[i].x >= ww - 1) targets[i].x = ww - 2;
-                if (targets[i].y >= wh - 1) targets[i].y = wh - 2;
-            }
-
-            // Clamp current position to new window bounds (in case it's off-screen now)
-            // Clamp to window dimensions to prevent vanishing
-            x_curr = ww / 2;
-            y_curr = wh / 2;
-            snprintf(sFromBB, sizeof(sFromBB), "%.0f,%.0f", x_curr, y_curr);
-            write(fdFromBB, sFromBB, strlen(sFromBB) + 1);
-            skip_drone_update = true;
-        }
-        
-
-        // Clear window for new frame
-        werase(win);
-        if (colors_enabled) {
-            wattron(win, COLOR_PAIR(4));
-            box(win, 0, 0);
-            wattroff(win, COLOR_PAIR(4));
-        } else {
-            box(win, 0, 0);
-        }
-
-        FD_ZERO(&readfds);
-        FD_SET(fdToBB, &readfds);
-        FD_SET(fdIn_BB, &readfds);
-        
-        
-        // Only monitor obstacle/target pipes in standalone mode
-        if (mode == 1) {
-            FD_SET(fdOb, &readfds);
-            FD_SET(fdTa, &readfds);
-        }
-
-        // Monitor communication pipe in networked modes
-        if (mode != 1) {
-            FD_SET(fdComm_ToBB, &readfds);
-        }
-
-        // Small timeout so loop stays responsive
-        tv.tv_sec = 0;
-        tv.tv_usec = 100000;
-
-        retval = select(maxfd + 1, &readfds, NULL, NULL, &tv);
+        // Sleep until a pipe has data or the next frame is due
+        retval = tick_wait(&sched, &readfds, &steps);
+        heartbeat_beat();
         if (retval == -1) break;
         else if (retval > 0) {
             
             // Receiving commands from Input process
-            if (FD_ISSET(fdIn_BB, &readfds)) {
-                // Clear strIn before reading new data
-                memset(strIn, 0, sizeof(strIn)); 
-                ssize_t bytes = read(fdIn_BB, strIn, sizeof(strIn)-1);
+            if (fdIn_BB != -1 && FD_ISSET(fdIn_BB, &readfds)) {
+                int bytes = frame_fill(&inReader);
                 if (bytes > 0) {
-                    sscanf(strIn, "%1s", sIn); 
+                    // A quit always wins, otherwise the newest command is used
+                    while (frame_next(&inReader, &frame)) {
+                        if (frame.hdr.type != FRAME_KEY || sIn[0] == 'q') continue;
+                        sIn[0] = frame.u.key.key;
+                        sIn[1] = '\0';
+                    }
                     LOG_INFO("BlackBoard","Received input command: %s", sIn);
                 } else if (bytes == 0) {
                     // --- FIX: Handle Clean Closure ---
@@ -396,13 +912,13 @@ int main(int argc, char *argv[]) {
                     // Even if we didn't, if Input closes, we should just stop.
                     LOG_INFO("BlackBoard", "Input process disconnected (Pipe Closed).");
                     
-                    // Close our end so select doesn't loop infinitely on the closed pipe
+                    // Close our end so epoll doesn't loop infinitely on the closed pipe
+                    tick_unwatch(&sched, fdIn_BB);
                     close(fdIn_BB); 
-                    FD_CLR(fdIn_BB, &readfds); 
                     fdIn_BB = -1; // Mark as invalid
                     
                 }
-                else { // bytes < 0 (Real Error)
+                else if (bytes == -1) { // Real Error
                     LOG_ERROR("BlackBoard", "Input pipe closed unexpectedly");
                     running = false; 
                 } // Pipe closed
@@ -410,32 +926,40 @@ int main(int argc, char *argv[]) {
 
             // Receiving coordinates from drone pipe
             if (FD_ISSET(fdToBB, &readfds)) {
-                ssize_t bytes = read(fdToBB, sToBB, sizeof(sToBB)-1);
+                int bytes = frame_fill(&droneReader);
                 if (bytes > 0) {
+                    // Only the newest position matters
+                    bool have_pos = false;
+                    FramePosition newest;
+                    uint64_t newest_sent_us = 0;
+                    while (frame_next(&droneReader, &frame)) {
+                        if (frame.hdr.type != FRAME_POSITION) continue;
+                        newest = frame.u.pos;
+                        newest_sent_us = frame.hdr.t_us;
+                        have_pos = true;
+                    }
                     if (skip_drone_update) {
                         skip_drone_update = false;
                     } 
-                    else {
-                        sToBB[bytes] = '\0';
-                        sscanf(sToBB, "%f,%f", &x_curr, &y_curr);
+                    else if (have_pos) {
+                        x_curr = newest.x;
+                        y_curr = newest.y;
+                        take_key_stamp(newest.t_in_us, newest_sent_us);
                         LOG_INFO("BlackBoard","Received drone coordinates");
 
                        //In networked mode, send MY drone position to communication process
                         if (mode != 1) {
-                            char comm_msg[100];
-                            snprintf(comm_msg, sizeof(comm_msg), "%.1f,%.1f", x_curr, y_curr);
-                            if (write(fdComm_FromBB, comm_msg, strlen(comm_msg) + 1) == -1) {
-                                // If error is Broken Pipe, the Server is dead.
-                                if (errno == EPIPE) {
-                                    LOG_ERROR("BlackBoard", "CommServer died (Broken Pipe).");
-                                    // Optional: running = false; // Exit if you want BB to die when Server dies
-                                }
-                            }
-                            
-                            //LOG_INFO("BlackBoard","Sent drone coordinates to Communication Client");
+                            forward_to_comm(x_curr, y_curr);
                         } 
                     }   
                 }
+                else if (bytes == -2) {
+                    // Woken for data that was already taken (threaded channels only)
+                }
+                else if (replaying) {
+                    // The drone finished its replay first, ours goes on without it
+                    tick_unwatch(&sched, fdToBB);
+                }
                 else { 
                     LOG_ERROR("BlackBoard", "Drone pipe closed unexpectedly");
                     running = false; }
@@ -444,108 +968,104 @@ int main(int argc, char *argv[]) {
 
             // Receiving coordinates from obstacle pipe
             if (mode == 1 && FD_ISSET(fdOb, &readfds)) {
-                ssize_t bytes = read(fdOb, strOb, sizeof(strOb)-1);
+                int bytes = frame_fill(&obReader);
                 if (bytes > 0) {
-                    strOb[bytes] = '\0';
-                    int new_x, new_y;
-                    sscanf(strOb, format_stringOb, &new_x, &new_y);
-                    LOG_INFO("BlackBoard","Received obstacle coordinates:");
-
-                    //apply to current window size
-                    float ratio_x = (float)new_x / (float)window_width;
-                    float ratio_y = (float)new_y / (float)window_height;
-                    
-                    //Aplies to current window size
-                    new_x=ratio_x*ww;
-                    new_y=ratio_y*wh;
-
-                    // Clamp to window dimensions to prevent vanishing
-                    if (new_x >= ww - 1) new_x = ww - 2;
-                    if (new_y >= wh - 1) new_y = wh - 2;
-                    
-                    // Store in array
-                    obstacles[obs_head].x = new_x;
-                    obstacles[obs_head].y = new_y;
-                    obs_head = (obs_head + 1) % MAX_ITEMS;
-                    if (obs_count < MAX_ITEMS) obs_count++;
+                    // Every obstacle that arrived, in order
+                    while (frame_next(&obReader, &frame)) {
+                        if (frame.hdr.type != FRAME_ITEM) continue;
+                        LOG_INFO("BlackBoard","Received obstacle coordinates:");
+                        receive_item(&obstacles, frame.u.item.x, frame.u.item.y);
+                    }
                 }
-                else { 
+                else if (bytes != -2) { 
                     LOG_ERROR("BlackBoard", "Obstacle pipe closed unexpectedly");
                     running = false; }
             }
 
             // Reading coordinates from target pipe
             if (mode ==1 && FD_ISSET(fdTa, &readfds)) {
-                ssize_t bytes = read(fdTa, strTa, sizeof(strTa)-1);
+                int bytes = frame_fill(&taReader);
                 if (bytes > 0) {
-                    strTa[bytes] = '\0';
-                    int new_x, new_y;
-                    sscanf(strTa, format_stringTa, &new_x, &new_y);
-                    LOG_INFO("BlackBoard","Received target coordinates:");
-
-                    //apply to current window size
-                    float ratio_x = (float)new_x / (float)window_width;
-                    float ratio_y = (float)new_y / (float)window_height;
-                    
-                    //Aplies to current window size
-                    new_x=ratio_x*ww;
-                    new_y=ratio_y*wh;
-                    
-                    // Clamp to window dimensions to prevent vanishing
-                    if (new_x >= ww - 1) new_x = ww - 2;
-                    if (new_y >= wh - 1) new_y = wh - 2;
-
-                    // Store in array
-                    if (tar_count < MAX_ITEMS) {
-                        targets[tar_count].x = new_x;
-                        targets[tar_count].y = new_y;
-                        tar_count++;
-                    } else {
-                        // Drop the oldest target to make room
-                        memmove(&targets[0], &targets[1], sizeof(targets[0]) * (MAX_ITEMS - 1));
-                        targets[MAX_ITEMS - 1].x = new_x;
-                        targets[MAX_ITEMS - 1].y = new_y;
+                    // Every target that arrived, in order
+                    while (frame_next(&taReader, &frame)) {
+                        if (frame.hdr.type != FRAME_ITEM) continue;
+                        LOG_INFO("BlackBoard","Received target coordinates:");
+                        receive_item(&targets, frame.u.item.x, frame.u.item.y);
                     }
                 }
-                else { 
+                else if (bytes != -2) { 
                     LOG_ERROR("BlackBoard", "Target pipe closed unexpectedly");
                     running = false; }
             }
             
             // Reading from communication pipe
             if (FD_ISSET(fdComm_ToBB, &readfds)) {
-                ssize_t bytes = read(fdComm_ToBB, strComm_ToBB, sizeof(strComm_ToBB)-1);
+                int bytes = frame_fill(&commReader);
                 if (bytes > 0) {
-                    strComm_ToBB[bytes] = '\0';
-
-                    if (sscanf(strComm_ToBB, "%f,%f", &x_ToBB, &y_ToBB) == 2){
-                        remote_drone.x = (int)x_ToBB;
-                        remote_drone.y = (int)y_ToBB;
-                        remote_drone_valid = true;
-
-                        LOG_INFO("BlackBoard","Received remote drone coordinates");
-
-                        // In SERVER mode only, treat client drone position as obstacle
-                        if (mode == 2){
-                            // Use slot 0 for remote drone obstacle (single moving obstacle)
-                            obstacles[0].x = remote_drone.x;
-                            obstacles[0].y = remote_drone.y;
-                            if (obs_count == 0) obs_count = 1;  // Ensure we have exactly 1 obstacle
-
-                            LOG_INFO("BlackBoard","Treated remote drone as obstacle at (%d,%d)", remote_drone.x, remote_drone.y);
-                        }
-                    }
-                    LOG_INFO("BlackBoard","Received communication command: %s", strComm_ToBB);
+                    // One read can carry several frames (one per remote drone)
+                    while (frame_next(&commReader, &frame)) handle_remote_frame(&frame);
                 } 
-                else { 
+                else if (bytes != -2) { 
                     LOG_ERROR("BlackBoard", "Communication pipe closed unexpectedly");
                     running = false; 
                 } // Pipe closed
             }
         }                
 
-        // Update input_key after reading from pipes
+        // Everything below runs once per tick; input read in between is kept in sIn
+        if (steps == 0) continue;
+
+        for (int i = 0; i < steps; i++) step_remotes();
+
+        if (replaying && !replay_tick(sIn)) {
+            LOG_INFO("BlackBoard", "Replay finished after %u frames", bb_tick);
+            running = false;
+        }
+
+        // Store old window dimensions for scaling
+        int old_ww = ww;
+        int old_wh = wh;
+        bool resized = view_take_resize(&ww, &wh);
+
+        if (resized) {
+
+            // Recalculate and reproportionate obstacles and targets
+            rescale_items(&obstacles, old_ww, old_wh);
+            rescale_items(&targets, old_ww, old_wh);
+
+            // Clamp current position to new window bounds (in case it's off-screen now)
+            // Clamp to window dimensions to prevent vanishing
+            x_curr = ww / 2;
+            y_curr = wh / 2;
+            send_drone_position(x_curr, y_curr);
+            // With pipes the next drone message is stale; shared memory tracks resets itself
+            if (world == NULL) skip_drone_update = true;
+            items_dirty = true;
+        }
+
+
+        // Latest drone position from the shared world state
+        if (world != NULL) {
+            DroneSnapshot snap;
+            world_read_drone(world, &snap);
+            // Ignore positions computed before the drone saw our last reset
+            if (snap.gen != drone_gen_seen && snap.reset_ack == reset_gen_sent) {
+                drone_gen_seen = snap.gen;
+                x_curr = snap.x;
+                y_curr = snap.y;
+                take_key_stamp(snap.t_in_us, snap.t_us);
+                if (mode != 1) {
+                    forward_to_comm(x_curr, y_curr);
+                }
+            }
+        }
+
+        // Update input_key after reading from pipes, the command is consumed by this tick
         char input_key = sIn[0];
+        sIn[0] = '\0';
+        if (session_mode == SESSION_RECORD && input_key != '\0') {
+            session_record(&session_out, bb_tick, SESS_KEY, input_key, 0, 0);
+        }
         
         // Quit the game
         if (input_key=='q'){
@@ -553,253 +1073,154 @@ int main(int argc, char *argv[]) {
             running = false;
         }
 
-        // If drone overlaps a target, remove that target
-        {
-            int drone_x = (int)x_curr;
-            int drone_y = (int)y_curr;
-            for (int i = 0; i < tar_count; ) {
-                if (targets[i].x == drone_x && targets[i].y == drone_y) {
-                    if (i < tar_count - 1) {
-                        memmove(&targets[i], &targets[i + 1], sizeof(targets[0]) * (tar_count - i - 1));
-                    }
-                    tar_count--;
-                    continue;
+        // Latest swarm positions; the drone position shown in headless output is the centroid
+        if (swarm != NULL) {
+            swarm_read_drones(swarm, swarm_x, swarm_y, SWARM_MAX_DRONES, &swarm_count);
+            if (swarm_count > 0) {
+                float sx = 0, sy = 0;
+                for (int i = 0; i < swarm_count; i++) {
+                    sx += swarm_x[i];
+                    sy += swarm_y[i];
                 }
-                i++;
+                x_curr = sx / swarm_count;
+                y_curr = sy / swarm_count;
             }
         }
 
+        // Pause the game until 'u'. The loop keeps serving the pipes and only
+        // publishes the paused frame (a replay skips the pause)
+        if (input_key == 'p' && !replaying) {
+            paused = true;
+            LOG_INFO("BlackBoard", "Game paused");
+        }
+        if (paused) {
+            if (input_key != 'u') {
+                if (!headless) view_publish(mode, x_curr, y_curr, true);
+                continue;
+            }
+            paused = false;
+            LOG_INFO("BlackBoard", "Game resumed");
+        }
+
+        // If a drone overlaps a target, remove that target (only the drone's cell is looked at)
+        if (swarm != NULL) {
+            for (int i = 0; i < swarm_count && targets.count > 0; i++) {
+                collect_targets_at((int)swarm_x[i], (int)swarm_y[i]);
+            }
+        } else {
+            collect_targets_at((int)x_curr, (int)y_curr);
+        }
+
         // Reset button - recentre drone
-        if (input_key == 'a'){
-            mvwprintw(win, y_curr, x_curr, " " );
+        if (input_key == 'a' && swarm != NULL) {
+            swarm_reset_gen++;
+            items_dirty = true;
+            LOG_INFO("BlackBoard","Swarm re-formed at the centre");
+        }
+        else if (input_key == 'a'){
             x_curr=ww/2;
             y_curr=wh/2;
 
-            snprintf(sFromBB, sizeof(sFromBB), "%.0f,%.0f", x_curr, y_curr);     
-            write(fdFromBB, sFromBB, strlen(sFromBB) + 1);
+            send_drone_position(x_curr, y_curr);
             
             // In networked mode, send updated position to communication process
             if (mode != 1) {
-                char comm_msg[100];
-                snprintf(comm_msg, sizeof(comm_msg), "%.1f,%.1f", x_curr, y_curr);
-                write(fdComm_FromBB, comm_msg, strlen(comm_msg) + 1);
+                forward_to_comm(x_curr, y_curr);
                 LOG_INFO("BlackBoard","Sent reset position to Communication process");
             }
             
-            wrefresh(win);
             LOG_INFO("BlackBoard","Drone recentred to");
         }
 
-        // Pause the game, wait for 'u' to unpause
-        if (input_key == 'p') {
-            mvwprintw(win, 0, 0, "Game Paused, Press 'u' to Resume");
-            wrefresh(win);
-
-            fd_set pause_fds;
-            struct timeval pause_tv;
-            int pause_ret;
-            
-            
-
-            while (running) {
-                FD_ZERO(&pause_fds);
-                FD_SET(fdIn_BB, &pause_fds);
-                int maxfd_pause = fdIn_BB;
-                pause_tv.tv_sec = 0;
-                pause_tv.tv_usec = 100 * 1000; 
-
-                pause_ret = select(maxfd_pause + 1, &pause_fds, NULL, NULL, &pause_tv);
-                if (pause_ret > 0) {
-                    // If input pipe has data, read and update sIn
-                    if (FD_ISSET(fdIn_BB, &pause_fds)) {
-                        ssize_t bytes = read(fdIn_BB, strIn, sizeof(strIn) - 1);
-                        if (bytes > 0) {
-                            strIn[bytes] = '\0';
-                            sscanf(strIn, "%s", sIn);
-                            if (sIn[0] == 'u') { 
-                                break;
-                            }
-                            if (sIn[0] == 'q'){
-                                running=false;
-                                break;
-                            }
-                            } else {
-                                running = false; //pipe broken
-                                break;
-                            }
-                    }
-                }
-            }
-
-            input_key=' ';
-            werase(win);
-            if (colors_enabled) {
-                wattron(win, COLOR_PAIR(4));
-                box(win, 0, 0);
-                wattroff(win, COLOR_PAIR(4));
-            } else {
-                box(win, 0, 0);
-            }
-            mvwprintw(win, 0, 0, "                       ");    
-
-        }
-        
         //clamping drone to window size
         if (x_curr >= ww - 1) {
             x_curr = ww - 1;
             
-            snprintf(sFromBB, sizeof(sFromBB), "%.0f,%.0f", x_curr, y_curr);        
-            write(fdFromBB, sFromBB, strlen(sFromBB) + 1);
+            send_drone_position(x_curr, y_curr);
         } else if (x_curr <= 0) {
             x_curr = 0;
-            snprintf(sFromBB, sizeof(sFromBB), "%.0f,%.0f", x_curr, y_curr);       
-            write(fdFromBB, sFromBB, strlen(sFromBB) + 1);
+            send_drone_position(x_curr, y_curr);
         }
 
         if (y_curr >= wh - 1) {
             y_curr = wh - 1;
-            snprintf(sFromBB, sizeof(sFromBB), "%.0f,%.0f", x_curr, y_curr);       
-            write(fdFromBB, sFromBB, strlen(sFromBB) + 1);
+            send_drone_position(x_curr, y_curr);
             
         } else if (y_curr <= 0) {
             y_curr = 0;
-            snprintf(sFromBB, sizeof(sFromBB), "%.0f,%.0f", x_curr, y_curr);      
-            write(fdFromBB, sFromBB, strlen(sFromBB) + 1);
+            send_drone_position(x_curr, y_curr);
             
         }
 
-        // Draw Obstacles while checking if we having an closeness of a drone
-        for(int i=0; i<obs_count; i++) {
-            if (obstacles[i].x > 0 && obstacles[i].y > 0){ 
-                wattron(win, COLOR_PAIR(3));
-                mvwprintw(win, obstacles[i].y, obstacles[i].x, "O");
-                wattroff(win, COLOR_PAIR(3));
-            }
-            
-            dx =  x_curr - obstacles[i].x;
-            dy =  y_curr - obstacles[i].y;
-            distance = sqrt(pow(dx, 2) + pow(dy, 2));
-            
-            if (!repulsion_sent) { 
-                if(distance < rph_intial ){
-    
-                    if (distance <= 1.0) {distance = 1.0;}
-    
-                    snprintf(sRepul, sizeof(sRepul), "%.2f,%.2f,%.2f",distance, dx, dy);
-                    write(fdRepul, sRepul, strlen(sRepul) + 1);
-                    //it recieves that it has reached the obstacle
-                    //dprintf(STDERR_FILENO, "BB: Obstacle repulsion - dist=%.2f\n", distance);
-                    repulsion_sent = true;
-                } 
-            }
-        }            
-
-        // Check for boundary repulsion
-        // Only check boundaries if NO obstacle repulsion was sent
-        if (!repulsion_sent) {
-            // Left boundary
-            if (x_curr < rph_intial) {
-                distance = x_curr;
-                if (distance < 1.0) distance = 1.0;
-                dx = distance;  
-                dy = 0;
-                
-                snprintf(sRepul, sizeof(sRepul), "%.2f,%.2f,%.2f", distance, dx, dy);
-                write(fdRepul, sRepul, strlen(sRepul) + 1);
-                repulsion_sent = true;
-                
-                //dprintf(STDERR_FILENO, "BB: Left boundary repulsion - dist=%.2f\n", distance);
-            }
-            // Right boundary
-            else if (x_curr > (ww - rph_intial)) {
-                distance = ww - x_curr;
-                if (distance < 1.0) distance = 1.0;
-                dx = -distance;  
-                dy = 0;
-                
-                snprintf(sRepul, sizeof(sRepul), "%.2f,%.2f,%.2f", distance, dx, dy);
-                write(fdRepul, sRepul, strlen(sRepul) + 1);
-                repulsion_sent = true;
-                
-                //dprintf(STDERR_FILENO, "BB: Right boundary repulsion - dist=%.2f\n", distance);
-            }
-            
-            // Top boundary
-            if (y_curr < rph_intial && !repulsion_sent) {
-                distance = y_curr;
-                if (distance < 1.0) distance = 1.0;
-                dx = 0;
-                dy = distance;  
-
-                snprintf(sRepul, sizeof(sRepul), "%.2f,%.2f,%.2f", distance, dx, dy);
-                write(fdRepul, sRepul, strlen(sRepul) + 1);
-                repulsion_sent = true;
-                
-                //dprintf(STDERR_FILENO, "BB: Top boundary repulsion - dist=%.2f\n", distance);
-            }
-            // Bottom boundary
-            else if (y_curr > (wh - rph_intial) && !repulsion_sent) {
-                distance = wh - y_curr;
-                if (distance < 1.0) distance = 1.0;
-                dx = 0;
-                dy = -distance;  
-                
-                snprintf(sRepul, sizeof(sRepul), "%.2f,%.2f,%.2f", distance, dx, dy);
-                write(fdRepul, sRepul, strlen(sRepul) + 1);
-                repulsion_sent = true;
-                
-                //dprintf(STDERR_FILENO, "BB: Bottom boundary repulsion - dist=%.2f\n", distance);
-            }
+        // Net repulsion from every obstacle, wall and (SERVER mode only) client
+        // drone in range, sent to the drone as one force vector
+        // Only the obstacles in the cells around the drone are looked at
+        field_clear(&field_sources);
+        int near = grid_query(&obstacles, x_curr, y_curr, field.rho, near_ids, FIELD_MAX_SOURCES);
+        for (int i = 0; i < near; i++) {
+            field_add(&field_sources, obstacles.items[near_ids[i]].x, obstacles.items[near_ids[i]].y);
         }
-        
-        // Draw Targets
-        for(int i=0; i<tar_count; i++) {
-             if (targets[i].x > 0 && targets[i].y > 0) {
-                wattron(win, COLOR_PAIR(2));
-                mvwprintw(win, targets[i].y, targets[i].x, "T");
-                wattroff(win, COLOR_PAIR(2));
-             }
+        // Client drones push from where the dead reckoning predicts them, not
+        // from their last (older) network sample
+        for (int i = 0; mode == 2 && i < remote_count; i++) {
+            float rx, ry;
+            dr_position(&remotes[i].track, &rx, &ry);
+            field_add(&field_sources, rx, ry);
+        }
+        float fx = 0, fy = 0;
+        int in_range = field_sources_force(&field_sources, &field, x_curr, y_curr, &fx, &fy);
+        in_range += field_walls_force(&field, x_curr, y_curr, ww, wh, &fx, &fy);
+        // (the swarm computes its own repulsion per drone)
+        if (in_range > 0 && swarm == NULL) {
+            frame_send_force(&toRepul, fx, fy);
         }
 
-        if (mode != 1 && remote_drone_valid) {
 
-            if (remote_drone.x > 0 && remote_drone.x < ww &&
-                remote_drone.y > 0 && remote_drone.y < wh) {
-            // Remote drone is out of bounds, skip drawing
-            
-                // Draw remote drone as 'C'
-                if (mode ==2){
-                    wattron(win, COLOR_PAIR(3));
-                    mvwprintw(win, remote_drone.y, remote_drone.x, "C");
-                    wattroff(win, COLOR_PAIR(3));
-                }
-                else {
-                    // Client sees server drone (display only, different color)
-                    wattron(win, COLOR_PAIR(1) | A_BOLD);
-                    mvwprintw(win, remote_drone.y, remote_drone.x, "S");
-                    wattroff(win, COLOR_PAIR(1) | A_BOLD);
-                }
+        // Share the current items with other readers of the world state
+        if (items_dirty) {
+            if (world != NULL) publish_items();
+            if (swarm != NULL) {
+                if (resized) swarm_reset_gen++;
+                publish_arena();
             }
-            
+            items_dirty = false;
+        }
+
+        // Hand the frame to the render thread
+        if (!headless) view_publish(mode, x_curr, y_curr, false);
+
+        // Headless: one line of machine-readable state per tick
+        if (headless) {
+            emit_state(x_curr, y_curr);
         }
 
+        bb_tick++;
+        if (session_mode == SESSION_RECORD && session_flush(&session_out) == -1) {
+            LOG_ERRNO("BlackBoard", "Session write failed, recording stopped");
+            session_close(&session_out);
+            session_mode = SESSION_OFF;
+        }
 
-        // Draw the drone , mode 1
-        wattron(win, COLOR_PAIR(1));
-        mvwprintw(win, (int)y_curr, (int)x_curr, "+");
-        wattroff(win, COLOR_PAIR(1));
-        wrefresh(win);
 
 
-        
-        // Checking alive signal
-        if (health_check) {
-            health_check = 0; // Reset flag
-            kill(watchdog_pid, SIGUSR2); // Send signal back to watchdog
+        if (tick_report_due(&sched, 10000)) {
+            char stats[256];
+            tick_format_stats(&sched, stats, sizeof(stats));
+            LOG_INFO("BlackBoard", "Tick stats: %s", stats);
+            log_latency(&lat_drone_bb, "");
         }
-        usleep(10000); 
-        
     }
+
+    char stats[256];
+    tick_format_stats(&sched, stats, sizeof(stats));
+    LOG_INFO("BlackBoard", "Tick stats at exit: %s", stats);
+    log_latency(&lat_drone_bb, " at exit");
+    tick_close(&sched);
+    if (session_mode == SESSION_RECORD) {
+        session_record(&session_out, bb_tick, SESS_END, 0, 0, 0);
+        session_close(&session_out);
+    }
+    if (replaying) session_unload(&session_in);
     
     // Cleanup
     close(fdToBB);
@@ -813,9 +1234,14 @@ int main(int argc, char *argv[]) {
         close(fdComm_ToBB);
         close(fdComm_FromBB);
     }
-
-    delwin(win);
-    endwin();
+    world_detach(world);
+    swarm_detach(swarm);
+    heartbeat_unregister();
+    grid_free(&obstacles);
+    grid_free(&targets);
+
+    view_stop_thread();
+    if (state_out != NULL && state_out != stdout) fclose(state_out);
     logger_close();
     return 0;
 
@@ -13,82 +13,51 @@
 #include <netinet/tcp.h>
 #include "logger.h"
 #include "logger_custom.h"
+#include "net_stream.h"
+#include "conn_buffer.h"
+#include "ipc_frame.h"
+#include "net_udp.h"
+#include "net_delta.h"
+#include "coord_transform.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-// Transformation parameters
-#define VIRTUAL_X0 0.0
-#define VIRTUAL_Y0 0.0
-#define VIRTUAL_ALFA 0.0 
-
 //sig_atomic_t ensures atomic access during signal handling
 volatile sig_atomic_t should_exit = 0;
 
-// Virtual coordinate conversion functions
-typedef struct {
-    float x;
-    float y;
-} Coord;
-
-// Convert local to virtual (standard: top-left origin)
-// Formula:
-// x1 = x0 + x cos(alfa) - y sin(alfa)
-// y1 = y0 + x sin(alfa) + y cos(alfa)
-// TO BE TESTED: alfa = 0, pi/2, pi
-Coord local_to_virtual(Coord local, int window_width, int window_height) {
-    Coord v;
-    float x = local.x;
-    float y = local.y;
-    
-    v.x = VIRTUAL_X0 + x * cos(VIRTUAL_ALFA) - y * sin(VIRTUAL_ALFA);
-    v.y = VIRTUAL_Y0 + x * sin(VIRTUAL_ALFA) + y * cos(VIRTUAL_ALFA);
-    
-    return v;
-}
+// Our window (Parameter_File.txt) and its mapping onto the server's, set
+// once the handshake has told us the server's size
+static int local_width = 0, local_height = 0;
+static CoordTransform xform;
 
-// Convert virtual to local
-// Inverse Formula:
-// x = (x1 - x0) cos(alfa) + (y1 - y0) sin(alfa)
-// y = -(x1 - x0) sin(alfa) + (y1 - y0) cos(alfa)
-Coord virtual_to_local(Coord virt, int window_width, int window_height) {
-    Coord l;
-    float dx = virt.x - VIRTUAL_X0;
-    float dy = virt.y - VIRTUAL_Y0;
-    
-    l.x = dx * cos(VIRTUAL_ALFA) + dy * sin(VIRTUAL_ALFA);
-    l.y = -dx * sin(VIRTUAL_ALFA) + dy * cos(VIRTUAL_ALFA);
-    
-    return l;
+static void setup_transform(int server_width, int server_height) {
+    if (local_width <= 0 || local_height <= 0) {
+        local_width = server_width;
+        local_height = server_height;
+    }
+    transform_init(&xform, local_width, local_height, server_width, server_height,
+                   VIRTUAL_X0, VIRTUAL_Y0, VIRTUAL_ALFA);
+    LOG_INFO("CommClient", "Local window %dx%d mapped onto the server's %dx%d",
+             local_width, local_height, server_width, server_height);
 }
 
 // Helper functions for socket protocol
-int read_line(int sockfd, char *buffer, int max_len) {
-    int i = 0;
-    char c;
-    while (i < max_len - 1) {
-        int n = read(sockfd, &c, 1);
-        if (n < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // Timeout - check if we should exit
-                if (should_exit) return -2;  // Special code for termination
-                continue;  // Otherwise retry
-            }
-            return -1;  // Real error
-        }
-        if (n == 0) return -1;  // Connection closed
-        if (c == '\n') break;
-        buffer[i++] = c;
+// Lines are split out of the connection buffer, which refills with one read()
+// only when no complete line is waiting
+int read_line(ConnBuffer *conn, char *buffer, int max_len) {
+    int len;
+    // A timeout just means the server is quiet; give up only if we are exiting
+    while ((len = conn_read_line(conn, buffer, max_len)) == -2) {
+        if (should_exit) return -2;  // Special code for termination
     }
-    buffer[i] = '\0';
-    return i;
+    if (len < 0) buffer[0] = '\0';
+    return len;
 }
 
-int write_line(int sockfd, const char *message) {
-    char buffer[512];
-    snprintf(buffer, sizeof(buffer), "%s\n", message);
-    return write(sockfd, buffer, strlen(buffer));
+int write_line(ConnBuffer *conn, const char *message) {
+    return conn_write_line(conn, message);
 }
 
 
@@ -99,6 +68,427 @@ void handle_terminate(int signo) {
     }
 }
 
+// Read everything queued on the non-blocking BlackBoard pipe and keep the
+// newest position frame. Returns 1 if a position was received, 0 if nothing
+// was waiting, -1 if the pipe failed.
+static int read_latest_from_bb(FrameReader *fromBB, Coord *pos) {
+    int found = 0;
+    Frame frame;
+    for (;;) {
+        int n = frame_fill(fromBB);
+        if (n == -2) break;
+        if (n == 0 || n == -1) return -1;
+
+        while (frame_next(fromBB, &frame)) {
+            if (frame.hdr.type != FRAME_POSITION) continue;
+            pos->x = frame.u.pos.x;
+            pos->y = frame.u.pos.y;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+// Send one remote drone to the BlackBoard, in local coordinates, with the
+// velocity estimated for it
+static void forward_remote(FrameWriter *toBB, const StreamMotion *m) {
+    Coord remote_virtual = {m->x, m->y};
+    Coord v_virtual = {m->vx, m->vy};
+    Coord remote_local = virtual_to_local(&xform, remote_virtual);
+    Coord v_local = transform_vector(&xform.to_local, v_virtual);
+    frame_send_remote(toBB, m->id, remote_local.x, remote_local.y, v_local.x, v_local.y, m->t_local_us);
+}
+
+// Forward every drone in the snapshot and tell the BlackBoard about the ones
+// that were in the previous snapshot but are gone now. known[] holds the
+// drones of the previous snapshot with their velocity estimates.
+static void forward_snapshot(FrameWriter *toBB, const StreamSnapshot *snap,
+                             StreamMotion *known, int *known_count) {
+    StreamMotion next[STREAM_MAX_ENTITIES];
+    uint64_t now = stream_now_us();
+    const int n = snap->count;
+
+    for (int k = 0; k < *known_count; k++) {
+        bool still_there = false;
+        for (int i = 0; i < n; i++) {
+            if (snap->entities[i].id == known[k].id) { still_there = true; break; }
+        }
+        if (!still_there) frame_send_remote_del(toBB, known[k].id);
+    }
+
+    // Positions and velocities in virtual coordinates, one array per axis
+    float px[STREAM_MAX_ENTITIES], py[STREAM_MAX_ENTITIES];
+    float vx[STREAM_MAX_ENTITIES], vy[STREAM_MAX_ENTITIES];
+    for (int i = 0; i < n; i++) {
+        StreamMotion m;
+        memset(&m, 0, sizeof(m));
+        m.id = snap->entities[i].id;
+        for (int k = 0; k < *known_count; k++) {
+            if (known[k].id == m.id) { m = known[k]; break; }
+        }
+        stream_motion_update(&m, snap->entities[i].x, snap->entities[i].y, snap->t_us, now);
+        next[i] = m;
+        px[i] = m.x;
+        py[i] = m.y;
+        vx[i] = m.vx;
+        vy[i] = m.vy;
+    }
+
+    // The whole snapshot in two batch transforms; velocities skip the offset
+    float lx[STREAM_MAX_ENTITIES], ly[STREAM_MAX_ENTITIES];
+    float lvx[STREAM_MAX_ENTITIES], lvy[STREAM_MAX_ENTITIES];
+    Affine linear = xform.to_local;
+    linear.tx = linear.ty = 0.0f;
+    transform_batch(&xform.to_local, n, px, py, lx, ly);
+    transform_batch(&linear, n, vx, vy, lvx, lvy);
+
+    for (int i = 0; i < n; i++) {
+        frame_send_remote(toBB, next[i].id, lx[i], ly[i], lvx[i], lvy[i], next[i].t_local_us);
+    }
+    memcpy(known, next, sizeof(StreamMotion) * (size_t)n);
+    *known_count = n;
+}
+
+// Full-duplex streaming loop, used when the server accepted "ook stream".
+// Mirrors the server side: our position goes out on change or keepalive, every
+// newer server frame (one drone) or snapshot (all other drones) goes to the
+// BlackBoard, and nothing is acknowledged.
+static void stream_loop(ConnBuffer *conn, FrameReader *fromBB, FrameWriter *toBB, Coord last_local) {
+    StreamRx rx;
+    memset(&rx, 0, sizeof(rx));
+    rx.last_rx_us = stream_now_us();
+
+    StreamFrame out;
+    memset(&out, 0, sizeof(out));
+    uint64_t last_send_us = 0;
+    bool dirty = true;
+    char buffer[STREAM_LINE_MAX];
+
+    // Drones the BlackBoard currently knows about
+    StreamMotion known[STREAM_MAX_ENTITIES];
+    int known_count = 0;
+
+    while (!should_exit) {
+        uint64_t now = stream_now_us();
+
+        if ((dirty && now - last_send_us >= STREAM_SEND_PERIOD_MS * 1000ULL) ||
+            now - last_send_us >= STREAM_KEEPALIVE_MS * 1000ULL) {
+            Coord virtual = local_to_virtual(&xform, last_local);
+            out.seq++;
+            out.t_us = now;
+            out.x = virtual.x;
+            out.y = virtual.y;
+            stream_format(buffer, sizeof(buffer), &out);
+            if (write_line(conn, buffer) < 0) {
+                LOG_ERROR("CommClient", "Write error on state frame");
+                break;
+            }
+            last_send_us = now;
+            dirty = false;
+        }
+
+        if (now - rx.last_rx_us > STREAM_PEER_TIMEOUT_MS * 1000ULL) {
+            LOG_ERROR("CommClient", "No frame from server for %d ms, closing", STREAM_PEER_TIMEOUT_MS);
+            break;
+        }
+
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(conn->fd, &fds);
+        FD_SET(fromBB->conn.fd, &fds);
+        int maxfd = (conn->fd > fromBB->conn.fd) ? conn->fd : fromBB->conn.fd;
+        struct timeval tv = {0, conn_has_line(conn) ? 0 : STREAM_SEND_PERIOD_MS * 1000 / 2};
+
+        int ready = select(maxfd + 1, &fds, NULL, NULL, &tv);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERRNO("CommClient", "Select error");
+            break;
+        }
+
+        if (FD_ISSET(fromBB->conn.fd, &fds)) {
+            Coord pos;
+            int r = read_latest_from_bb(fromBB, &pos);
+            if (r < 0) {
+                LOG_ERROR("CommClient", "Failed to read from BlackBoard");
+                break;
+            }
+            if (r > 0 && (pos.x != last_local.x || pos.y != last_local.y)) {
+                last_local = pos;
+                dirty = true;
+            }
+        }
+
+        // Lines left over from the handshake read count as pending input too
+        bool sock_ready = FD_ISSET(conn->fd, &fds);
+        if (sock_ready || conn_has_line(conn)) {
+            // One read() per wake-up, then every complete frame it brought in
+            int n = sock_ready ? conn_fill(conn) : 1;
+            if (n == 0 || n == -1) {
+                LOG_ERROR("CommClient", "Read error on server stream");
+                break;
+            }
+
+            bool peer_quit = false;
+            bool have_new = false;
+            StreamSnapshot newest;
+            while (conn_next_line(conn, buffer, sizeof(buffer)) >= 0) {
+                if (strcmp(buffer, "q") == 0) {
+                    peer_quit = true;
+                    break;
+                }
+
+                // A multi-client server sends snapshots, a single peer "st" frames
+                StreamSnapshot in;
+                StreamFrame frame;
+                if (stream_parse_snapshot(buffer, &in)) {
+                    if (!stream_accept_seq(&rx, in.seq)) continue;
+                } else if (stream_parse(buffer, &frame)) {
+                    if (!stream_accept(&rx, &frame)) continue;
+                    in.seq = frame.seq;
+                    in.t_us = frame.t_us;
+                    in.count = 1;
+                    in.entities[0].id = 0;
+                    in.entities[0].x = frame.x;
+                    in.entities[0].y = frame.y;
+                } else {
+                    LOG_ERROR("CommClient", "Invalid server frame: '%s'", buffer);
+                    continue;
+                }
+                newest = in;
+                have_new = true;
+            }
+            if (peer_quit) {
+                LOG_INFO("CommClient", "Received quit signal");
+                // Tell the Master Process to die
+                kill(getppid(), SIGTERM);
+                break;
+            }
+
+            // Only the newest state is worth forwarding
+            if (have_new) {
+                forward_snapshot(toBB, &newest, known, &known_count);
+            }
+
+            if (have_new && rx.accepted % 100 == 0) {
+                LOG_INFO("CommClient", "Stream: %lu frames in (%lu stale), %u out",
+                         rx.accepted, rx.stale_dropped, out.seq);
+            }
+        }
+    }
+
+    // Let the server know we are leaving instead of waiting for its timeout
+    if (should_exit) write_line(conn, "q");
+
+    LOG_INFO("CommClient", "Stream ended: %lu frames in (%lu stale), %u out",
+             rx.accepted, rx.stale_dropped, out.seq);
+}
+
+// UDP handshake: HELLO until the server's WELCOME. Returns 1 with the window
+// size filled in, 0 if we were told to exit, -1 if the server never answered.
+static int udp_handshake(int sockfd, int *window_width, int *window_height) {
+    UdpMessage msg;
+    for (int tries = 0; tries < UDP_HELLO_TRIES; tries++) {
+        if (should_exit) return 0;
+        udp_send_hello(sockfd, NULL);
+
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(sockfd, &fds);
+        struct timeval tv = {0, UDP_HELLO_RETRY_MS * 1000};
+        if (select(sockfd + 1, &fds, NULL, NULL, &tv) <= 0) continue;
+
+        int r;
+        while ((r = udp_recv(sockfd, &msg, NULL, NULL)) > 0) {
+            if (msg.type == UDP_WELCOME) {
+                *window_width = msg.width;
+                *window_height = msg.height;
+                LOG_INFO("CommClient", "UDP welcome after %d hello(s): client id %d", tries + 1, msg.id);
+                return 1;
+            }
+        }
+        if (r < 0) {
+            LOG_ERRNO("CommClient", "UDP receive failed during handshake");
+            return -1;
+        }
+    }
+    return -1;
+}
+
+// Worlds decoded from the server, the baselines its deltas refer to
+static DeltaRing received;
+static DeltaWorld decoded;
+
+// UDP counterpart of stream_loop: same send policy, but every datagram stands
+// alone, so a lost snapshot is just replaced by the next and a late one is
+// dropped by its seq instead of holding up the ones behind it. Each STATE
+// acknowledges the newest world decoded, so the server's next delta can build
+// on it. Acks add no datagrams: even an idle client's keepalive comes well
+// within the server's ring of worlds.
+static void udp_loop(int sockfd, FrameReader *fromBB, FrameWriter *toBB, Coord last_local) {
+    StreamRx rx;
+    memset(&rx, 0, sizeof(rx));
+    rx.last_rx_us = stream_now_us();
+
+    uint32_t out_seq = 0;
+    uint64_t last_send_us = 0;
+    bool dirty = true;
+    unsigned long bad = 0;
+    unsigned long no_base = 0;    // Deltas against a world we never decoded
+    uint32_t ack = 0;
+    UdpMessage msg;
+    StreamSnapshot newest;
+    delta_ring_init(&received);
+
+    // Drones the BlackBoard currently knows about
+    StreamMotion known[STREAM_MAX_ENTITIES];
+    int known_count = 0;
+
+    while (!should_exit) {
+        uint64_t now = stream_now_us();
+
+        if ((dirty && now - last_send_us >= STREAM_SEND_PERIOD_MS * 1000ULL) ||
+            now - last_send_us >= STREAM_KEEPALIVE_MS * 1000ULL) {
+            Coord virtual = local_to_virtual(&xform, last_local);
+            // A failed send is a lost datagram; the timeout below catches a dead peer
+            udp_send_state(sockfd, NULL, ++out_seq, virtual.x, virtual.y, ack);
+            last_send_us = now;
+            dirty = false;
+        }
+
+        if (now - rx.last_rx_us > UDP_PEER_TIMEOUT_MS * 1000ULL) {
+            LOG_ERROR("CommClient", "No datagram from server for %d ms, closing", UDP_PEER_TIMEOUT_MS);
+            break;
+        }
+
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(sockfd, &fds);
+        FD_SET(fromBB->conn.fd, &fds);
+        int maxfd = (sockfd > fromBB->conn.fd) ? sockfd : fromBB->conn.fd;
+        struct timeval tv = {0, STREAM_SEND_PERIOD_MS * 1000 / 2};
+
+        int ready = select(maxfd + 1, &fds, NULL, NULL, &tv);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERRNO("CommClient", "Select error");
+            break;
+        }
+
+        if (FD_ISSET(fromBB->conn.fd, &fds)) {
+            Coord pos;
+            int r = read_latest_from_bb(fromBB, &pos);
+            if (r < 0) {
+                LOG_ERROR("CommClient", "Failed to read from BlackBoard");
+                break;
+            }
+            if (r > 0 && (pos.x != last_local.x || pos.y != last_local.y)) {
+                last_local = pos;
+                dirty = true;
+            }
+        }
+
+        if (!FD_ISSET(sockfd, &fds)) continue;
+
+        bool peer_quit = false;
+        bool have_new = false;
+        int r;
+        while ((r = udp_recv(sockfd, &msg, NULL, &bad)) > 0) {
+            if (msg.type == UDP_BYE) {
+                peer_quit = true;
+                break;
+            }
+            // Late WELCOMEs from our retried hellos are ignored here
+            if (msg.type != UDP_DELTA) continue;
+            const DeltaWorld *base = delta_ring_find(&received, msg.base_seq);
+            if (msg.base_seq != 0 && base == NULL) {
+                no_base++;
+                continue;
+            }
+            if (!stream_accept_seq(&rx, msg.seq)) continue;
+            if (!delta_decode(base, msg.delta, msg.delta_len, &decoded)) {
+                bad++;
+                continue;
+            }
+            DeltaWorld *world = delta_ring_slot(&received, msg.seq);
+            memcpy(world->e, decoded.e, sizeof(DeltaEntity) * (size_t)decoded.count);
+            world->count = decoded.count;
+            ack = msg.seq;
+
+            newest.seq = msg.seq;
+            newest.t_us = msg.t_us;
+            newest.count = world->count;
+            for (int i = 0; i < world->count; i++) {
+                newest.entities[i].id = world->e[i].id;
+                newest.entities[i].x = delta_coord(world->e[i].x);
+                newest.entities[i].y = delta_coord(world->e[i].y);
+            }
+            have_new = true;
+        }
+        if (r < 0) {
+            LOG_ERRNO("CommClient", "UDP receive failed");
+            break;
+        }
+        if (peer_quit) {
+            LOG_INFO("CommClient", "Received quit signal");
+            // Tell the Master Process to die
+            kill(getppid(), SIGTERM);
+            break;
+        }
+
+        // Only the newest state is worth forwarding
+        if (have_new) {
+            forward_snapshot(toBB, &newest, known, &known_count);
+            if (rx.accepted % 100 == 0) {
+                LOG_INFO("CommClient", "UDP: %lu snapshots in (%lu stale), %u states out",
+                         rx.accepted, rx.stale_dropped, out_seq);
+            }
+        }
+    }
+
+    // Let the server know we are leaving instead of waiting for its timeout
+    if (should_exit) udp_send_bye(sockfd, NULL);
+
+    LOG_INFO("CommClient", "UDP stream ended: %lu snapshots in (%lu stale, %lu malformed, %lu without baseline), "
+             "%u states out", rx.accepted, rx.stale_dropped, bad, no_base, out_seq);
+}
+
+// Whole client session over UDP, from handshake to shutdown
+static int udp_client(int sockfd, const struct sockaddr_in *serv_addr,
+                      int fdComm_FromBB, int fdComm_ToBB) {
+    // connect() on a datagram socket only fixes the peer: send() needs no
+    // address and datagrams from anyone else are filtered out
+    if (connect(sockfd, (const struct sockaddr *)serv_addr, sizeof(*serv_addr)) < 0) {
+        LOG_ERRNO("CommClient", "ERROR setting the UDP peer");
+        return 1;
+    }
+
+    int window_width, window_height;
+    int r = udp_handshake(sockfd, &window_width, &window_height);
+    if (r == 0) {
+        LOG_INFO("CommClient", "Termination during handshake, exiting.");
+        return 0;
+    }
+    if (r < 0) {
+        LOG_ERROR("CommClient", "Give up: no UDP welcome after %d hellos", UDP_HELLO_TRIES);
+        printf("\n*** No answer from server over UDP. Shutting down... ***\n\n");
+        // Signal parent process to terminate all children
+        kill(getppid(), SIGTERM);
+        return 1;
+    }
+    LOG_INFO("CommClient", "Received window size: %dx%d", window_width, window_height);
+    setup_transform(window_width, window_height);
+
+    FrameReader fromBB;
+    frame_reader_init(&fromBB, fdComm_FromBB);
+    FrameWriter toBB;
+    frame_writer_init(&toBB, fdComm_ToBB);
+
+    Coord last_local = {local_width / 2.0f, local_height / 2.0f};  // Default center
+    udp_loop(sockfd, &fromBB, &toBB, last_local);
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
 
     // Setup signal handling FIRST
@@ -109,11 +499,11 @@ int main(int argc, char *argv[]) {
 
     // Initialize logger and log self
     log_process("CommClient", getpid());
-    logger_init("system.log",0);
+    logger_init_mode("system.log", 0, LOG_MODE_ASYNC);
     
 
-    if (argc != 5) {
-        fprintf(stderr, "Usage: %s <hostname> <port> <fdComm_FromBB> <fdComm_ToBB>\n", argv[0]);
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <hostname> <port> <fdComm_FromBB> <fdComm_ToBB> [stream] [udp] [width height]\n", argv[0]);
         return 1;
     }
     
@@ -121,11 +511,17 @@ int main(int argc, char *argv[]) {
     int portno = atoi(argv[2]);
     int fdComm_FromBB = atoi(argv[3]);  // Read MY drone position from BB
     int fdComm_ToBB = atoi(argv[4]);    // Write SERVER's position to BB
+    bool stream_enabled = (argc > 5) && atoi(argv[5]) == 1;   // Offer the streaming protocol
+    bool udp = (argc > 6) && atoi(argv[6]) == 1;              // Datagram transport instead of TCP
+    if (argc > 8) {                                           // Our window, scaled onto the server's
+        local_width = atoi(argv[7]);
+        local_height = atoi(argv[8]);
+    }
     
-    LOG_INFO("CommClient", "Connecting to %s:%d", hostname, portno);
+    LOG_INFO("CommClient", "Connecting to %s:%d over %s", hostname, portno, udp ? "UDP" : "TCP");
     
     // Setup socket
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    int sockfd = socket(AF_INET, udp ? SOCK_DGRAM : SOCK_STREAM, 0);
     if (sockfd < 0) {
         LOG_ERRNO("CommClient", "ERROR opening socket");
         return 1;
@@ -143,6 +539,15 @@ int main(int argc, char *argv[]) {
     serv_addr.sin_family = AF_INET;
     bcopy(server->h_addr, &serv_addr.sin_addr.s_addr, server->h_length);
     serv_addr.sin_port = htons(portno);
+
+    if (udp) {
+        int rc = udp_client(sockfd, &serv_addr, fdComm_FromBB, fdComm_ToBB);
+        close(sockfd);
+        close(fdComm_FromBB);
+        close(fdComm_ToBB);
+        logger_close();
+        return rc;
+    }
     
    int retries = 0;
     int max_retries = 5;  // 5 retries * 3 seconds = 15 seconds total
@@ -188,11 +593,17 @@ int main(int argc, char *argv[]) {
     
     char buffer[256];
     int window_width, window_height;
+    ConnBuffer conn;
+    conn_init(&conn, sockfd);
+    FrameReader fromBB;
+    frame_reader_init(&fromBB, fdComm_FromBB);
+    FrameWriter toBB;
+    frame_writer_init(&toBB, fdComm_ToBB);
     
     // PROTOCOL: Initial handshake
     // 1. Wait for "ok", send "ook"
     int ret; 
-    while ((ret = read_line(sockfd, buffer, sizeof(buffer))) == -2) {
+    while ((ret = read_line(&conn, buffer, sizeof(buffer))) == -2) {
         // Keep waiting but check for termination
         if (should_exit) {
             LOG_INFO("CommClient", "Termination during handshake, exiting.");
@@ -206,13 +617,13 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     LOG_INFO("CommClient", "Server connected");
-    write_line(sockfd, "ook");
+    write_line(&conn, stream_enabled ? STREAM_OFFER : "ook");
     //write_line(sockfd, "ClientConnected");
     LOG_INFO("CommClient", "Sent connection acknowledgment to server");
     
     // 2. Wait for "size w h", send "sok"
     //now waits for w,h separated by comma because of server changes
-    while ((ret = read_line(sockfd, buffer, sizeof(buffer))) == -2) {
+    while ((ret = read_line(&conn, buffer, sizeof(buffer))) == -2) {
         if (should_exit) {
             LOG_INFO("CommClient", "Termination during handshake, exiting.");
             close(sockfd);
@@ -232,19 +643,31 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     LOG_INFO("CommClient", "Received window size: %dx%d", window_width, window_height);
+    setup_transform(window_width, window_height);
+
+    // The server accepts our streaming offer by tagging the size line
+    bool stream_mode = stream_enabled && strstr(buffer, " " STREAM_SIZE_SUFFIX) != NULL;
     
     //send sok because of server changes
-    write_line(sockfd, "sok");
+    write_line(&conn, "sok");
     LOG_INFO("CommClient", "Sent window size acknowledgment to server");
     
-    LOG_INFO("CommClient", "Handshake complete. Entering main loop...");
+    LOG_INFO("CommClient", "Handshake complete (%s protocol). Entering main loop...",
+             stream_mode ? "streaming" : "lock-step");
     
     // MAIN LOOP
     bool running = true;
     int loop_count = 0;
     
     // Keep track of last known position for non-blocking reads
-    Coord last_local = {window_width / 2.0f, window_height / 2.0f};  // Default center
+    Coord last_local = {local_width / 2.0f, local_height / 2.0f};  // Default center
+    StreamMotion server_motion;   // Lock-step: the server drone's velocity, from our clock
+    memset(&server_motion, 0, sizeof(server_motion));
+
+    if (stream_mode) {
+        stream_loop(&conn, &fromBB, &toBB, last_local);
+        running = false;
+    }
     
     while (running) {
         if (should_exit) {
@@ -255,7 +678,7 @@ int main(int argc, char *argv[]) {
         loop_count++;
         
         // a) Wait for "drone" or "q" command
-        int ret = read_line(sockfd, buffer, sizeof(buffer));
+        int ret = read_line(&conn, buffer, sizeof(buffer));
         if (ret == -2) {
             LOG_INFO("CommClient", "Termination during read, exiting.");
             break;
@@ -281,7 +704,7 @@ int main(int argc, char *argv[]) {
         }
         
         // Wait for server position in virtual coordinates (format: "x.x y.y")
-        ret = read_line(sockfd, buffer, sizeof(buffer));
+        ret = read_line(&conn, buffer, sizeof(buffer));
         if (ret == -2) {
             LOG_INFO("CommClient", "Termination during read, exiting.");
             break;
@@ -296,28 +719,26 @@ int main(int argc, char *argv[]) {
         if (sscanf(buffer, "%f, %f", &server_virtual.x, &server_virtual.y) != 2) {
             LOG_ERROR("CommClient", "Invalid server position format: '%s'", buffer);
             // Send drone_ok anyway to keep protocol in sync
-            write_line(sockfd, "dok");
+            write_line(&conn, "dok");
             continue;
         }
         
-        // Convert to local coordinates
-        Coord server_local = virtual_to_local(server_virtual, window_width, window_height);
-        
         // Send "drone_ok" acknowledgement
         //send dok because of server changes
-        if (write_line(sockfd, "dok") < 0) {
+        if (write_line(&conn, "dok") < 0) {
             LOG_ERROR("CommClient", "Write error on 'drone_ok'");
             break;
         }
         
-        // Write server position to BlackBoard in local coordinates (format: "x.x,y.y")
-        char server_pos_str[50];
-        snprintf(server_pos_str, sizeof(server_pos_str), "%.1f,%.1f", server_local.x, server_local.y);
-        write(fdComm_ToBB, server_pos_str, strlen(server_pos_str) + 1);
+        // Write server position to BlackBoard in local coordinates (format: "0,x.x,y.y")
+        // The lock-step protocol only carries the server's drone, id 0
+        uint64_t now = stream_now_us();
+        stream_motion_update(&server_motion, server_virtual.x, server_virtual.y, now, now);
+        forward_remote(&toBB, &server_motion);
         
         if (loop_count % 20 == 0) {
-            LOG_INFO("CommClient", "Received server: virtual(%.1f,%.1f) -> local(%.1f,%.1f)",
-                   server_virtual.x, server_virtual.y, server_local.x, server_local.y);
+            LOG_INFO("CommClient", "Received server: virtual(%.1f,%.1f)",
+                   server_virtual.x, server_virtual.y);
         }
         
         // Check for quit signal
@@ -330,7 +751,7 @@ int main(int argc, char *argv[]) {
             break;
         }
         // b) Wait for "obstacle_ok" command
-        ret = read_line(sockfd, buffer, sizeof(buffer));
+        ret = read_line(&conn, buffer, sizeof(buffer));
         if (ret == -2) {
             LOG_INFO("CommClient", "Termination during read, exiting.");
             break;
@@ -355,27 +776,19 @@ int main(int argc, char *argv[]) {
             break;
         }
         
-        // Read MY drone position from BlackBoard (format: "x.x,y.y")
-        char my_pos[50];
-        ssize_t bytes = read(fdComm_FromBB, my_pos, sizeof(my_pos) - 1);
-        if (bytes > 0) {
-            my_pos[bytes] = '\0';
-            // Parse local coordinates (format: "x.x,y.y")
-            if (sscanf(my_pos, "%f,%f", &last_local.x, &last_local.y) != 2) {
-                LOG_ERROR("CommClient", "Invalid format from BlackBoard: '%s'", my_pos);
-            }
-        } else if (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        // Read MY drone position from BlackBoard, the newest one queued
+        if (read_latest_from_bb(&fromBB, &last_local) < 0) {
             LOG_ERROR("CommClient", "Failed to read from BlackBoard");
             break;
         }
-        // If EAGAIN, just use last_local
+        // If nothing was waiting, just use last_local
         
         // Convert to virtual coordinates
-        Coord virtual = local_to_virtual(last_local, window_width, window_height);
+        Coord virtual = local_to_virtual(&xform, last_local);
         
         // Send position in virtual coordinates (format: "x.x y.y" - note space, not comma)
         snprintf(buffer, sizeof(buffer), "%.1f, %.1f", virtual.x, virtual.y);
-        if (write_line(sockfd, buffer) < 0) {
+        if (write_line(&conn, buffer) < 0) {
             LOG_ERROR("CommClient", "Write error on position");
             break;
         }
@@ -396,7 +809,7 @@ int main(int argc, char *argv[]) {
         }
         // Wait for "position_ok" some people write pok
         //wait for pok because of server changes
-        ret = read_line(sockfd, buffer, sizeof(buffer));
+        ret = read_line(&conn, buffer, sizeof(buffer));
         if (ret == -2) {
             LOG_INFO("CommClient", "Termination during read, exiting.");
             break;
@@ -411,6 +824,8 @@ int main(int argc, char *argv[]) {
     }
     
     LOG_INFO("CommClient", "Connection closed");
+    LOG_INFO("CommClient", "Socket I/O: %lu reads (%lu bytes, %lu lines), %lu writes (%lu bytes)",
+             conn.read_calls, conn.bytes_in, conn.lines_in, conn.write_calls, conn.bytes_out);
     
     close(sockfd);
     close(fdComm_FromBB);
@@ -12,20 +12,23 @@
 #include <signal.h>
 #include <sys/file.h>
 #include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
 #include "logger.h"
 #include "logger_custom.h"
+#include "net_stream.h"
+#include "net_udp.h"
+#include "net_delta.h"
+#include "conn_buffer.h"
+#include "ipc_frame.h"
+#include "coord_transform.h"
 
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-// Transformation parameters, sets values
-#define VIRTUAL_X0 0.0
-#define VIRTUAL_Y0 0.0
-#define VIRTUAL_ALFA 0.0 // Angle in radians
-
-
 //sig_atomic_t ensures atomic access during signal handling
 volatile sig_atomic_t should_exit = 0;
 
@@ -39,61 +42,513 @@ void handle_terminate(int signo) {
     }
 }
 
-// Virtual coordinate conversion functions
+// Read everything queued on the non-blocking BlackBoard pipe and keep the
+// newest position frame. Returns 1 if a position was received, 0 if nothing
+// was waiting, -1 if the pipe failed.
+static int read_latest_from_bb(FrameReader *fromBB, Coord *pos) {
+    int found = 0;
+    Frame frame;
+    for (;;) {
+        int n = frame_fill(fromBB);
+        if (n == -2) break;
+        if (n == 0 || n == -1) return -1;
+
+        while (frame_next(fromBB, &frame)) {
+            if (frame.hdr.type != FRAME_POSITION) continue;
+            pos->x = frame.u.pos.x;
+            pos->y = frame.u.pos.y;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+// --- Multi-client server ---
+// One epoll loop serves every client. Each connection has its own state in
+// the client table and its own input/output buffers, so a slow or silent peer
+// only ever delays itself: its frames are dropped when its output queue is
+// full, and it is disconnected after CLIENT_TIMEOUT_MS without an answer.
+// Lock-step (legacy) clients are driven as a small state machine, one
+// drone/dok/obst/pos/pok exchange per tick; streaming clients get an
+// aggregated snapshot of every other drone.
+// With the UDP transport (net_udp.h) the listening socket is a datagram
+// socket: clients are told apart by address, have no connection buffer and
+// are always streaming once their HELLO has been answered. Their snapshots
+// are deltas against the newest world they acknowledged (net_delta.h), so
+// each keeps a ring of the worlds it was sent.
+
+#define MAX_CLIENTS 64
+#define CLIENT_TIMEOUT_MS 5000        // Handshake, lock-step reply or stream silence
+#define SERVER_TICK_MS STREAM_SEND_PERIOD_MS
+#define MAX_EVENTS 64
+
+typedef enum {
+    CLIENT_WAIT_OOK,      // Sent "ok"
+    CLIENT_WAIT_SOK,      // Sent "size w,h"
+    CLIENT_LEGACY_IDLE,   // Lock-step, next exchange starts on the next tick
+    CLIENT_LEGACY_DOK,    // Sent "drone" + position, waiting for "dok"
+    CLIENT_LEGACY_POS,    // Sent "obst", waiting for the client position
+    CLIENT_STREAMING
+} ClientState;
+
 typedef struct {
-    float x;
-    float y;
-} Coord;
-
-// Convert local to virtual (standard: top-left origin)
-// Formula:
-// x1 = x0 + x cos(alfa) - y sin(alfa)
-// y1 = y0 + x sin(alfa) + y cos(alfa)
-// TO BE TESTED: alfa = 0, pi/2, pi
-Coord local_to_virtual(Coord local, int window_width, int window_height) {
-    Coord v;
-    float x = local.x;
-    float y = local.y;
-    
-    v.x = VIRTUAL_X0 + x * cos(VIRTUAL_ALFA) - y * sin(VIRTUAL_ALFA);
-    v.y = VIRTUAL_Y0 + x * sin(VIRTUAL_ALFA) + y * cos(VIRTUAL_ALFA);
-    
-    return v;
+    bool used;
+    int id;                   // 1.. in order of arrival, 0 is our own drone
+    bool udp;                 // Datagram client: peer instead of conn
+    ClientState state;
+    bool stream_offered;
+    ConnBuffer *conn;
+    struct sockaddr_in peer;
+    bool want_out;            // EPOLLOUT currently registered
+    char addr[64];
+
+    StreamRx rx;
+    uint32_t tx_seq;
+    DeltaRing *sent;          // UDP: worlds sent, by seq
+    uint32_t acked;           // UDP: newest world the client decoded, 0 = none
+    unsigned long bytes_out;  // UDP: delta payload bytes
+    unsigned long full_out;   // UDP: snapshots sent without a baseline
+    uint64_t deadline_us;     // Next reply must arrive before this
+    uint64_t last_send_us;
+    unsigned long sent_version;
+
+    bool has_position;
+    Coord virtual_pos;        // As received, shared with the other clients
+    Coord local_pos;          // Converted for our BlackBoard
+    StreamMotion motion;      // Velocity estimate sent along to the BlackBoard
+} Client;
+
+static Client clients[MAX_CLIENTS];
+static int client_count = 0;
+static int next_client_id = 1;
+static int epfd = -1;
+
+// Session parameters
+static FrameWriter toBB;
+static int window_width = 0, window_height = 0;
+static CoordTransform xform;              // Our window is the virtual plane: no scaling
+static bool stream_enabled = false;
+static bool udp_mode = false;             // Clients talk UDP on the listening socket
+static int udp_sockfd = -1;
+static unsigned long udp_bad = 0;         // Malformed datagrams ignored
+
+// Our own drone and a version number bumped whenever any drone moves
+static Coord my_local;
+static unsigned long world_version = 1;
+
+// epoll tags for the non-client descriptors
+static int listen_tag, bb_tag;
+
+// Tell the BlackBoard where a client's drone is, and how fast it moves
+static void bb_send_remote(const Client *c) {
+    const StreamMotion *m = &c->motion;
+    Coord v_virtual = {m->vx, m->vy};
+    Coord v = transform_vector(&xform.to_local, v_virtual);
+    frame_send_remote(&toBB, c->id, c->local_pos.x, c->local_pos.y, v.x, v.y, m->t_local_us);
 }
 
-// Convert virtual to local
-// Inverse Formula:
-// x = (x1 - x0) cos(alfa) + (y1 - y0) sin(alfa)
-// y = -(x1 - x0) sin(alfa) + (y1 - y0) cos(alfa)
-Coord virtual_to_local(Coord virt, int window_width, int window_height) {
-    Coord l;
-    float dx = virt.x - VIRTUAL_X0;
-    float dy = virt.y - VIRTUAL_Y0;
-    
-    l.x = dx * cos(VIRTUAL_ALFA) + dy * sin(VIRTUAL_ALFA);
-    l.y = -dx * sin(VIRTUAL_ALFA) + dy * cos(VIRTUAL_ALFA);
-    
-    return l;
+static void bb_remove_remote(int id) {
+    frame_send_remote_del(&toBB, id);
 }
 
-// Helper functions for socket protocol
-int read_line(int sockfd, char *buffer, int max_len) {
-    int i = 0;
-    char c;
-    while (i < max_len - 1) {
-        int n = read(sockfd, &c, 1);
-        if (n <= 0) return -1;
-        if (c == '\n') break;
-        buffer[i++] = c;
+static void client_update_interest(Client *c) {
+    bool want_out = c->conn->out_len > 0;
+    if (want_out == c->want_out) return;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | (want_out ? EPOLLOUT : 0);
+    ev.data.ptr = c;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c->conn->fd, &ev);
+    c->want_out = want_out;
+}
+
+static void client_drop(Client *c, const char *why) {
+    if (c->udp) {
+        LOG_INFO("CommServer", "Client %d (%s) disconnected: %s. %lu states in (%lu stale), "
+                 "%u snapshots out (%lu full), %lu delta bytes",
+                 c->id, c->addr, why, c->rx.accepted, c->rx.stale_dropped, c->tx_seq, c->full_out, c->bytes_out);
+        free(c->sent);
+    } else {
+        LOG_INFO("CommServer", "Client %d (%s) disconnected: %s. I/O: %lu reads, %lu writes, %lu frames dropped",
+                 c->id, c->addr, why, c->conn->read_calls, c->conn->write_calls, c->conn->dropped_out);
+
+        epoll_ctl(epfd, EPOLL_CTL_DEL, c->conn->fd, NULL);
+        close(c->conn->fd);
+        free(c->conn);
     }
-    buffer[i] = '\0';
-    return i;
+
+    if (c->has_position) {
+        bb_remove_remote(c->id);
+        world_version++;
+    }
+    memset(c, 0, sizeof(*c));
+    client_count--;
 }
 
-int write_line(int sockfd, const char *message) {
-    char buffer[512];
-    snprintf(buffer, sizeof(buffer), "%s\n", message);
-    return write(sockfd, buffer, strlen(buffer));
+// Push queued output; returns false if the client had to be dropped
+static bool client_flush(Client *c) {
+    if (c->udp) return true;   // Datagrams are sent as they are made
+    if (conn_flush(c->conn) < 0) {
+        client_drop(c, "write failed");
+        return false;
+    }
+    client_update_interest(c);
+    return true;
+}
+
+static void client_accept(int listen_sockfd) {
+    for (;;) {
+        struct sockaddr_in cli_addr;
+        socklen_t clilen = sizeof(cli_addr);
+        int fd = accept(listen_sockfd, (struct sockaddr *)&cli_addr, &clilen);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_ERRNO("CommServer", "ERROR on accept");
+            }
+            return;
+        }
+
+        Client *c = NULL;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (!clients[i].used) { c = &clients[i]; break; }
+        }
+        ConnBuffer *conn = (c != NULL) ? malloc(sizeof(ConnBuffer)) : NULL;
+        if (conn == NULL) {
+            LOG_WARNING("CommServer", "Client table full (%d), refusing connection", MAX_CLIENTS);
+            write(fd, "q\n", 2);
+            close(fd);
+            continue;
+        }
+
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        memset(c, 0, sizeof(*c));
+        c->used = true;
+        c->id = next_client_id++;
+        c->conn = conn;
+        conn_init(c->conn, fd);
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &cli_addr.sin_addr, ip, sizeof(ip));
+        snprintf(c->addr, sizeof(c->addr), "%s:%d", ip, ntohs(cli_addr.sin_port));
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+        client_count++;
+
+        LOG_INFO("CommServer", "Client %d connected from %s (%d connected). Starting handshake...",
+                 c->id, c->addr, client_count);
+
+        // PROTOCOL: Initial handshake
+        // 1. Send "ok", wait for "ook"
+        conn_queue_line(c->conn, "ok");
+        c->state = CLIENT_WAIT_OOK;
+        c->deadline_us = stream_now_us() + CLIENT_TIMEOUT_MS * 1000ULL;
+        client_flush(c);
+    }
+}
+
+// New position from a client, in virtual coordinates, taken at t_peer_us on
+// the client's clock (ours for lock-step clients)
+static void client_set_position(Client *c, Coord client_virtual, uint64_t t_peer_us) {
+    stream_motion_update(&c->motion, client_virtual.x, client_virtual.y, t_peer_us, stream_now_us());
+    // Keepalives and UDP acks repeat the position: nothing new for the others
+    bool moved = !c->has_position || client_virtual.x != c->virtual_pos.x ||
+                 client_virtual.y != c->virtual_pos.y;
+    c->virtual_pos = client_virtual;
+    c->local_pos = virtual_to_local(&xform, client_virtual);
+    c->has_position = true;
+    bb_send_remote(c);
+    if (moved) world_version++;
+}
+
+// Handle one line from a client. Returns false if the client was dropped.
+static bool client_on_line(Client *c, const char *line) {
+    char buffer[STREAM_LINE_MAX];
+    uint64_t now = stream_now_us();
+
+    switch (c->state) {
+    case CLIENT_WAIT_OOK:
+        //had to change ClientConnected to ook to match client changes
+        if (strcmp(line, "ook") != 0 && strcmp(line, STREAM_OFFER) != 0) {
+            LOG_ERROR("CommServer", "Protocol error: expected 'ClientConnected', got '%s'", line);
+            client_drop(c, "bad handshake");
+            return false;
+        }
+        // A client that offers streaming gets it if we allow it, legacy otherwise
+        c->stream_offered = stream_enabled && strcmp(line, STREAM_OFFER) == 0;
+
+        // 2. Send "size w h", wait for "sok"
+        if (c->stream_offered) {
+            snprintf(buffer, sizeof(buffer), "size %d,%d %s", window_width, window_height, STREAM_SIZE_SUFFIX);
+        } else {
+            snprintf(buffer, sizeof(buffer), "size %d,%d", window_width, window_height);
+        }
+        conn_queue_line(c->conn, buffer);
+        c->state = CLIENT_WAIT_SOK;
+        c->deadline_us = now + CLIENT_TIMEOUT_MS * 1000ULL;
+        return true;
+
+    case CLIENT_WAIT_SOK:
+        if (strcmp(line, "sok") != 0) {
+            LOG_ERROR("CommServer", "Protocol error: expected 'sok', got '%s'", line);
+            client_drop(c, "bad handshake");
+            return false;
+        }
+        c->state = c->stream_offered ? CLIENT_STREAMING : CLIENT_LEGACY_IDLE;
+        c->rx.last_rx_us = now;
+        c->deadline_us = now + CLIENT_TIMEOUT_MS * 1000ULL;
+        LOG_INFO("CommServer", "Client %d handshake complete (%s protocol)",
+                 c->id, c->stream_offered ? "streaming" : "lock-step");
+        return true;
+
+    case CLIENT_LEGACY_DOK:
+        //wait for dok because of client changes
+        if (strcmp(line, "dok") != 0) {
+            LOG_ERROR("CommServer", "Protocol error: expected 'dok', got '%s'", line);
+            client_drop(c, "protocol error");
+            return false;
+        }
+        conn_queue_line(c->conn, "obst");
+        c->state = CLIENT_LEGACY_POS;
+        c->deadline_us = now + CLIENT_TIMEOUT_MS * 1000ULL;
+        return true;
+
+    case CLIENT_LEGACY_POS: {
+        // Client position in virtual coordinates (format: "x.x, y.y")
+        Coord client_virtual;
+        if (sscanf(line, "%f, %f", &client_virtual.x, &client_virtual.y) == 2) {
+            client_set_position(c, client_virtual, now);
+        } else {
+            LOG_ERROR("CommServer", "Invalid client position format: '%s'", line);
+        }
+        // Send pok either way to keep the protocol in sync
+        conn_queue_line(c->conn, "pok");
+        c->state = CLIENT_LEGACY_IDLE;
+        return true;
+    }
+
+    case CLIENT_STREAMING: {
+        if (strcmp(line, "q") == 0) {
+            client_drop(c, "client closed the stream");
+            return false;
+        }
+        StreamFrame in;
+        if (!stream_parse(line, &in)) {
+            LOG_ERROR("CommServer", "Invalid frame from client %d: '%s'", c->id, line);
+            return true;
+        }
+        if (!stream_accept(&c->rx, &in)) return true; // Older than what we already have
+
+        Coord client_virtual = {in.x, in.y};
+        client_set_position(c, client_virtual, in.t_us);
+        return true;
+    }
+
+    default:
+        // Lock-step client talking out of turn
+        LOG_ERROR("CommServer", "Unexpected line from client %d: '%s'", c->id, line);
+        client_drop(c, "protocol error");
+        return false;
+    }
+}
+
+static void client_readable(Client *c) {
+    int n = conn_fill(c->conn);
+    if (n == 0 || n == -1) {
+        client_drop(c, (n == 0) ? "connection closed" : "read error");
+        return;
+    }
+
+    char line[STREAM_LINE_MAX];
+    while (conn_next_line(c->conn, line, sizeof(line)) >= 0) {
+        if (!client_on_line(c, line)) return;
+    }
+    client_flush(c);
+}
+
+// --- UDP clients ---
+
+static Client* udp_find(const struct sockaddr_in *from) {
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        Client *c = &clients[i];
+        if (c->used && c->udp && c->peer.sin_addr.s_addr == from->sin_addr.s_addr &&
+            c->peer.sin_port == from->sin_port) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+// First HELLO from an address: the handshake is just the WELCOME reply
+static Client* udp_accept(const struct sockaddr_in *from) {
+    Client *c = NULL;
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (!clients[i].used) { c = &clients[i]; break; }
+    }
+    DeltaRing *sent = (c != NULL) ? malloc(sizeof(DeltaRing)) : NULL;
+    if (sent == NULL) {
+        LOG_WARNING("CommServer", "Client table full (%d), ignoring UDP hello", MAX_CLIENTS);
+        return NULL;
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->used = true;
+    c->udp = true;
+    c->sent = sent;
+    delta_ring_init(c->sent);
+    c->id = next_client_id++;
+    c->peer = *from;
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &from->sin_addr, ip, sizeof(ip));
+    snprintf(c->addr, sizeof(c->addr), "%s:%d", ip, ntohs(from->sin_port));
+    c->state = CLIENT_STREAMING;
+    c->rx.last_rx_us = stream_now_us();
+    client_count++;
+
+    LOG_INFO("CommServer", "Client %d joined over UDP from %s (%d connected)", c->id, c->addr, client_count);
+    return c;
+}
+
+// Every datagram waiting on the socket, matched to its client by address
+static void udp_readable(int fd) {
+    UdpMessage msg;
+    struct sockaddr_in from;
+    int r;
+    while ((r = udp_recv(fd, &msg, &from, &udp_bad)) > 0) {
+        Client *c = udp_find(&from);
+        if (msg.type == UDP_HELLO) {
+            // A repeated hello means our welcome was lost, or the client
+            // restarted on the same port: answer again and restart its seq
+            if (c == NULL) {
+                c = udp_accept(&from);
+            } else {
+                c->rx.have = false;
+                c->rx.last_rx_us = stream_now_us();
+                c->acked = 0;   // A restarted client has no baseline either
+            }
+            if (c != NULL) udp_send_welcome(fd, &c->peer, window_width, window_height, c->id);
+            continue;
+        }
+        if (c == NULL) continue;   // Never said hello, or already dropped
+
+        if (msg.type == UDP_BYE) {
+            client_drop(c, "client said bye");
+        } else if (msg.type == UDP_STATE && stream_accept_seq(&c->rx, msg.seq)) {
+            // Older or duplicate states were dropped by stream_accept_seq
+            if (msg.ack > c->acked && msg.ack <= c->tx_seq) c->acked = msg.ack;
+            Coord client_virtual = {msg.x, msg.y};
+            client_set_position(c, client_virtual, msg.t_us);
+        }
+    }
+    if (r < 0) LOG_ERRNO("CommServer", "UDP receive failed");
+}
+
+// Everything except <self>, in virtual coordinates
+static void build_snapshot(const Client *self, StreamSnapshot *snap) {
+    snap->count = 0;
+    snap->entities[snap->count].id = 0;
+    Coord my_virtual = local_to_virtual(&xform, my_local);
+    snap->entities[snap->count].x = my_virtual.x;
+    snap->entities[snap->count].y = my_virtual.y;
+    snap->count++;
+
+    for (int i = 0; i < MAX_CLIENTS && snap->count < STREAM_MAX_ENTITIES; i++) {
+        const Client *o = &clients[i];
+        if (!o->used || o == self || !o->has_position) continue;
+        snap->entities[snap->count].id = o->id;
+        snap->entities[snap->count].x = o->virtual_pos.x;
+        snap->entities[snap->count].y = o->virtual_pos.y;
+        snap->count++;
+    }
+}
+
+// Send a UDP client its world, encoded against the newest one it has
+// acknowledged if that is still in the ring, in full otherwise
+static void udp_send_world(Client *c, const StreamSnapshot *snap) {
+    uint32_t seq = c->tx_seq + 1;
+    DeltaWorld *world = delta_ring_slot(c->sent, seq);
+    world->count = 0;
+    for (int i = 0; i < snap->count; i++) {
+        delta_world_add(world, snap->entities[i].id, snap->entities[i].x, snap->entities[i].y);
+    }
+    delta_world_sort(world);
+
+    // If the client fell a whole ring behind, the slot just taken held its
+    // baseline: delta_ring_find misses it and the world goes out in full
+    const DeltaWorld *base = delta_ring_find(c->sent, c->acked);
+    uint8_t bits[UDP_MAX_DELTA];
+    int len = delta_encode(base, world, bits, sizeof(bits));
+    if (len < 0) {
+        LOG_ERROR("CommServer", "World for client %d does not fit a datagram", c->id);
+        world->seq = 0;
+        return;
+    }
+    c->tx_seq = seq;
+    udp_send_delta(udp_sockfd, &c->peer, seq, base ? base->seq : 0, bits, (size_t)len);
+    c->bytes_out += (unsigned long)len;
+    if (base == NULL) c->full_out++;
+}
+
+static void server_tick(void) {
+    uint64_t now = stream_now_us();
+    char buffer[STREAM_LINE_MAX];
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        Client *c = &clients[i];
+        if (!c->used) continue;
+
+        switch (c->state) {
+        case CLIENT_LEGACY_IDLE: {
+            // a) Send "drone" command followed by our position in virtual coordinates
+            Coord virtual = local_to_virtual(&xform, my_local);
+            snprintf(buffer, sizeof(buffer), "%.1f, %.1f", virtual.x, virtual.y);
+            conn_queue_line(c->conn, "drone");
+            conn_queue_line(c->conn, buffer);
+            c->state = CLIENT_LEGACY_DOK;
+            c->deadline_us = now + CLIENT_TIMEOUT_MS * 1000ULL;
+            break;
+        }
+
+        case CLIENT_STREAMING:
+            if (now - c->rx.last_rx_us > (c->udp ? UDP_PEER_TIMEOUT_MS : CLIENT_TIMEOUT_MS) * 1000ULL) {
+                client_drop(c, "stream timed out");
+                continue;
+            }
+            if ((c->sent_version != world_version && now - c->last_send_us >= STREAM_SEND_PERIOD_MS * 1000ULL) ||
+                now - c->last_send_us >= STREAM_KEEPALIVE_MS * 1000ULL) {
+                StreamSnapshot snap;
+                build_snapshot(c, &snap);
+                if (c->udp) {
+                    udp_send_world(c, &snap);
+                } else {
+                    snap.seq = ++c->tx_seq;
+                    snap.t_us = now;
+                    stream_format_snapshot(buffer, sizeof(buffer), &snap);
+                    // A full queue means the peer is slow: skip this frame, a newer one follows
+                    conn_queue_line(c->conn, buffer);
+                }
+                c->sent_version = world_version;
+                c->last_send_us = now;
+            }
+            break;
+
+        default:
+            // Waiting for a handshake or lock-step reply
+            if (now > c->deadline_us) {
+                client_drop(c, "no reply");
+                continue;
+            }
+            break;
+        }
+
+        client_flush(c);
+    }
 }
 
 int main(int argc, char *argv[]) {
@@ -104,260 +559,136 @@ int main(int argc, char *argv[]) {
     sa.sa_handler = handle_terminate;
     sa.sa_flags = 0; // Restart interrupted syscalls
     sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN); // A vanished client must not kill the server
     
     log_process("CommServer", getpid());
-    logger_init("system.log",0);
+    logger_init_mode("system.log", 0, LOG_MODE_ASYNC);
     LOG_INFO("CommServer", "Starting Communication Server Process (PID=%d)", getpid());
           
-    if (argc != 6) {
-        fprintf(stderr, "Usage: %s <sockfd> <fdComm_FromBB> <fdComm_ToBB> <width> <height>\n", argv[0]);
+    if (argc < 6) {
+        fprintf(stderr, "Usage: %s <sockfd> <fdComm_FromBB> <fdComm_ToBB> <width> <height> [stream] [udp]\n", argv[0]);
         return 1;
     }
     
     int listen_sockfd = atoi(argv[1]);
     int fdComm_FromBB = atoi(argv[2]);  // Read MY drone position from BB
-    int fdComm_ToBB = atoi(argv[3]);    // Write CLIENT's position to BB
-    int window_width = atoi(argv[4]);
-    int window_height = atoi(argv[5]);
+    int fdComm_ToBB = atoi(argv[3]);    // Write CLIENTS' positions to BB
+    window_width = atoi(argv[4]);
+    window_height = atoi(argv[5]);
+    stream_enabled = (argc > 6) && atoi(argv[6]) == 1;   // Accept the streaming protocol
+    udp_mode = (argc > 7) && atoi(argv[7]) == 1;         // sockfd is a bound datagram socket
+    if (udp_mode) udp_sockfd = listen_sockfd;
 
     LOG_INFO("CommServer", "Window size: %dx%d", window_width, window_height);
-    LOG_INFO("CommServer", "Waiting for client connection...");
-    //printf("Waiting for client connection...\n");
-    
-    struct sockaddr_in cli_addr;
-    socklen_t clilen = sizeof(cli_addr);
-    int newsockfd = -1;
-
-    // --- Loop that waits for connection OR exit signal ---
-    //Either we want to exit before client accepts or we get a client connection
-    //using a select to check
-    while (!should_exit) {
-        fd_set readfds;
-        struct timeval tv;
-
-        FD_ZERO(&readfds);
-        FD_SET(listen_sockfd, &readfds);
-
-        tv.tv_sec = 0; // Check for 'q' every 1 second
-        tv.tv_usec = 100000; // 100 ms
+    transform_init(&xform, window_width, window_height, window_width, window_height,
+                   VIRTUAL_X0, VIRTUAL_Y0, VIRTUAL_ALFA);
 
-        // Wait to see if a client is knocking
-        int activity = select(listen_sockfd + 1, &readfds, NULL, NULL, &tv);
+    FrameReader fromBB;
+    frame_reader_init(&fromBB, fdComm_FromBB);
+    frame_writer_init(&toBB, fdComm_ToBB);
+    LOG_INFO("CommServer", "Waiting for client connections over %s (up to %d)...",
+             udp_mode ? "UDP" : "TCP", MAX_CLIENTS);
 
-        if (activity > 0) {
-            // A client is waiting! Safe to call accept() now without blocking.
-            newsockfd = accept(listen_sockfd, (struct sockaddr *)&cli_addr, &clilen);
-            break; // Exit the wait loop and proceed to handshake
-        } else if (activity == -1) {
-            // Error (likely interrupted by signal 'q')
-            if (errno != EINTR) LOG_ERRNO("CommServer", "Select error");
-        }
-        // If activity == 0 (Timeout), loop repeats and checks 'should_exit'
-    }
-
-    // --- CHECK: Did we exit the loop because of 'q'? ---
-    if (should_exit) {
-        LOG_INFO("CommServer", "Exiting while waiting for client.");
-        close(listen_sockfd); // Clean up
-        logger_close();
-        return 0; // Terminate immediately
-    }
+    // Keep track of last known position for non-blocking reads
+    my_local.x = window_width / 2.0f;  // Default center
+    my_local.y = window_height / 2.0f;
 
-    if (newsockfd < 0) {
-        LOG_ERRNO("CommServer", "ERROR on accept");
-        close(listen_sockfd); // Clean up
+    epfd = epoll_create1(0);
+    if (epfd < 0) {
+        LOG_ERRNO("CommServer", "epoll_create1 failed");
+        close(listen_sockfd);
         logger_close();
         return 1;
     }
 
-    
-    LOG_INFO("CommServer", "Client connected! Starting handshake...");
-    char buffer[256];
-    // --- SET TIMEOUT ---
-    struct timeval tv;
-    tv.tv_sec = 5;  // 5 Second timeout for internet reliability
-    tv.tv_usec = 0;
-    setsockopt(newsockfd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
- 
-        
-    // PROTOCOL: Initial handshake
-    // 1. Send "ok", wait for "ook"
-    //had to change ClientConnected to ook to match client changes
-    write_line(newsockfd, "ok");
-    if (read_line(newsockfd, buffer, sizeof(buffer)) < 0 || strcmp(buffer, "ook") != 0) {
-        LOG_ERROR("CommServer", "Protocol error: expected 'ClientConnected', got '%s'", buffer);
-        close(newsockfd);
-        return 1;
-    }
-    LOG_INFO("CommServer", "Received connection acknowledgment from client");
-    
-    // 2. Send "size w h", wait for "sok"
-    //instead of sending "size %d %d", sending "%d,%d" to match client changes
-    snprintf(buffer, sizeof(buffer), "size %d,%d", window_width, window_height);
-    write_line(newsockfd, buffer);
-    LOG_INFO("CommServer", "Sent: %s", buffer);
-    
-    if (read_line(newsockfd, buffer, sizeof(buffer)) < 0 || strcmp(buffer, "sok") != 0) {
-        LOG_ERROR("CommServer", "Protocol error: expected 'sok', got '%s'", buffer);
-        close(newsockfd);
-        return 1;
-    }
-    LOG_INFO("CommServer", "Received window size acknowledgment from client");
-    
-    LOG_INFO("CommServer", "Handshake complete. Entering main loop...");
-    
+    fcntl(listen_sockfd, F_SETFL, fcntl(listen_sockfd, F_GETFL) | O_NONBLOCK);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &listen_tag;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listen_sockfd, &ev);
+    ev.data.ptr = &bb_tag;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fdComm_FromBB, &ev);
+
     // MAIN LOOP
-    bool running = true;
-    int loop_count = 0;
-    
-    // Keep track of last known position for non-blocking reads
-    Coord last_local = {window_width / 2.0f, window_height / 2.0f};  // Default center
-    bool has_position = false;
-    
-    while (running) {
+    struct epoll_event events[MAX_EVENTS];
+    uint64_t last_tick_us = 0;
+    unsigned long loop_count = 0;
 
-        // Check for termination signal from master
-        if (should_exit) {
-            LOG_INFO("CommServer", "Termination signal received. Exiting main loop.");
-            break;
-        }
-        loop_count++;
-        
-        // a) Send "drone" command
-        if (write_line(newsockfd, "drone") < 0) {
-            LOG_ERROR("CommServer", "Write error on 'drone'");
+    while (!should_exit) {
+        int n = epoll_wait(epfd, events, MAX_EVENTS, SERVER_TICK_MS);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERRNO("CommServer", "epoll_wait error");
             break;
         }
-        
-        fd_set pipe_fds;
-        FD_ZERO(&pipe_fds);
-        FD_SET(fdComm_FromBB, &pipe_fds);
-        struct timeval pipe_tv ={0 , 0}; // instant check (no wait)
-
-        if (select(fdComm_FromBB + 1, &pipe_fds, NULL, NULL, &pipe_tv) > 0) {
-            // Read MY drone position from BlackBoard (format: "x.x,y.y")
-            char my_pos[50];
-            ssize_t bytes = read(fdComm_FromBB, my_pos, sizeof(my_pos) - 1);
-            if (bytes > 0) {
-                my_pos[bytes] = '\0';
-                // Parse local coordinates (format: "x.x,y.y")
-                if (sscanf(my_pos, "%f, %f", &last_local.x, &last_local.y) == 2) {
-                    has_position = true;
-                } else {
-                    LOG_ERROR("CommServer", "Invalid format from BlackBoard: '%s'", my_pos);
+
+        bool bb_closed = false;
+        for (int i = 0; i < n; i++) {
+            void *tag = events[i].data.ptr;
+            if (tag == &listen_tag) {
+                if (udp_mode) udp_readable(listen_sockfd);
+                else client_accept(listen_sockfd);
+            } else if (tag == &bb_tag) {
+                Coord pos;
+                int r = read_latest_from_bb(&fromBB, &pos);
+                if (r < 0) {
+                    LOG_ERROR("CommServer", "Failed to read from BlackBoard");
+                    bb_closed = true;
+                } else if (r > 0 && (pos.x != my_local.x || pos.y != my_local.y)) {
+                    my_local = pos;
+                    world_version++;
+                }
+            } else {
+                Client *c = (Client *)tag;
+                if (!c->used) continue; // Dropped earlier in this batch
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    client_readable(c);
+                }
+                if (c->used && (events[i].events & EPOLLOUT)) {
+                    client_flush(c);
                 }
-            } else if (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-                LOG_ERROR("CommServer", "Failed to read from BlackBoard");
-                break;
             }
-            // If EAGAIN, just use last_local
         }
-        
-        
-        // Convert to virtual coordinates
-        Coord virtual = local_to_virtual(last_local, window_width, window_height);
-        
-        // Send position in virtual coordinates (format: "x.x y.y" - note space, not comma)
-        snprintf(buffer, sizeof(buffer), "%.1f, %.1f", virtual.x, virtual.y);
-        if (write_line(newsockfd, buffer) < 0) {
-            LOG_ERROR("CommServer", "Write error on position");
-            break;
-        }
-        
-        if (loop_count % 20 == 0) {
-            LOG_INFO("CommServer", "Sent drone pos: local(%.1f,%.1f) -> virtual(%.1f,%.1f)",
-                   last_local.x, last_local.y, virtual.x, virtual.y);
-        }
-        
+        if (bb_closed) break;
 
-        // Wait for "drone_ok"
-        //wait for dok because of client changes
-        if (read_line(newsockfd, buffer, sizeof(buffer)) < 0 || strcmp(buffer, "dok") != 0) {
-            // Check for termination signal from master
-            if (should_exit) {
-                LOG_INFO("COmmServer", "Termination signal received. Exiting main loop.");
-                break;
+        uint64_t now = stream_now_us();
+        if (now - last_tick_us >= SERVER_TICK_MS * 1000ULL) {
+            server_tick();
+            last_tick_us = now;
+
+            if (++loop_count % 250 == 0) {
+                LOG_INFO("CommServer", "%d clients connected, sharing drone at local(%.1f,%.1f)",
+                         client_count, my_local.x, my_local.y);
             }
-            
-            LOG_ERROR("CommServer", "Protocol error: expected 'dok', got '%s'", buffer);
-            break;
         }
-        
-        // b) Send "obstacle_ok" command
-        if (write_line(newsockfd, "obst") < 0) {
-            LOG_ERROR("CommServer", "Write error on 'obstacle_ok'");
-            break;
-        }
-        
-    
-        // Wait for client position in virtual coordinates (format: "x.x y.y")
-        if (read_line(newsockfd, buffer, sizeof(buffer)) < 0) {
-            // Check for termination signal from master
-            if (should_exit) {
-                LOG_INFO("CommServer", "Termination signal received. Exiting main loop.");
-                break;
-            }
-                
-            LOG_ERROR("CommServer", "Read error on client position");
-            break;
-        }
-        
-        // Parse virtual coordinates
-        Coord client_virtual;
-        if (sscanf(buffer, "%f, %f", &client_virtual.x, &client_virtual.y) != 2) {
-            LOG_ERROR("CommServer", "Invalid client position format: '%s'", buffer);
-            // Send pok anyway to keep protocol in sync
-            //was position_ok now pok because of client changes
-            write_line(newsockfd, "pok");
-            continue;
-        }
-        
-        // Convert to local coordinates
-        Coord client_local = virtual_to_local(client_virtual, window_width, window_height);
-        
-        // Send "position_ok" acknowledgement
-        //was position_ok now pok because of client changes
-        if (write_line(newsockfd, "pok") < 0) {
-            LOG_ERROR("CommServer", "Write error on 'position_ok'");
-            break;
-        }
-        
-        // Write client position to BlackBoard in local coordinates (format: "x.x,y.y")
-        char client_pos_str[50];
-        snprintf(client_pos_str, sizeof(client_pos_str), "%.1f,%.1f", client_local.x, client_local.y);
-        write(fdComm_ToBB, client_pos_str, strlen(client_pos_str) + 1);
-        
-        if (loop_count % 20 == 0) {
-            LOG_INFO("CommServer", "Received client: virtual(%.1f,%.1f) -> local(%.1f,%.1f)",
-                   client_virtual.x, client_virtual.y, client_local.x, client_local.y);
-        }
-        
-        // Small delay
-        usleep(10000); // 10ms
-        
-       
     }
 
    // --- [4] CLEANUP HANG FIX ---
-    // If we have a socket, send 'q'.
+    // Send 'q' to every client, best effort.
     // CRITICAL: Do NOT block waiting for 'qok' forever. 
-    // If client is dead, a blocking read here hangs the whole shutdown.
-    //therefore removed the read_line for qok
-    if (newsockfd >= 0) {
-        LOG_INFO("CommServer", "Sending quit signal to client...");
-        write_line(newsockfd, "q");
-        
-        // We do NOT call read_line() here. 
-        // We just assume it worked and close the socket.
-        // This ensures we never hang during shutdown.
-        close(newsockfd);
+    // If a client is dead, a blocking read here hangs the whole shutdown.
+    LOG_INFO("CommServer", "Sending quit signal to %d clients...", client_count);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        Client *c = &clients[i];
+        if (!c->used) continue;
+        if (c->udp) {
+            udp_send_bye(udp_sockfd, &c->peer);
+        } else {
+            conn_queue_line(c->conn, "q");
+            conn_flush(c->conn);
+        }
+        client_drop(c, "server shutting down");
     }
 
-    close(newsockfd);
+    if (udp_mode && udp_bad > 0) {
+        LOG_WARNING("CommServer", "Ignored %lu malformed datagrams", udp_bad);
+    }
+    close(epfd);
     close(listen_sockfd);
     close(fdComm_FromBB);
     close(fdComm_ToBB);
     
     logger_close();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,505 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "drone_dynamics.h"
+#include "force_field.h"
+
+// Batch parameter sweep
+// Runs many seeded scenarios of the standalone game without any process,
+// pipe or terminal: one drone, random obstacles and one target in a
+// window-sized arena. The drone is flown towards the target by a simple
+// autopilot that presses the same 8 direction keys a player would, the
+// dynamics are dyn_step() from the Drone and the repulsion is the
+// BlackBoard's force field. Every combination of the swept parameters is
+// run with --seeds seeds; runs are spread over all cores with a
+// work-stealing pool and each one is written as a CSV row.
+//
+//   ./batch_sim [--mass a:b:step] [--k ...] [--eta ...] [--rho ...] [--t ms:ms:step]
+//               [--seeds N] [--obstacles N] [--max-time s] [--threads N] [--out file.csv]
+//   ./batch_sim --check
+//
+// A range may also be a single value. Unswept parameters come from
+// Parameter_File.txt. --check runs the integrator self-checks instead of a
+// sweep and exits non-zero if one fails.
+
+#define MAX_OBSTACLES   256
+#define TARGET_RADIUS   1.0f      // Same cell as the target
+#define NEAR_TARGET     10.0f     // Boost off inside this distance
+#define REST_STEPS      12000     // --check: 10 minutes at T = 50 ms
+#define REST_TOLERANCE  1e-3f     // --check: allowed drift of a resting drone
+
+// Standardized exit codes
+#define USAGE_ERROR 64
+#define OPEN_FAIL 66
+#define RUNTIME_ERROR 70
+
+int window_width = 120;
+int window_height = 40;
+float rph_intial = 3;
+double eta_intial = 15;
+int force_intial = 1;
+int mass = 1;
+int k_intial = 1;
+int t_intial = 50;
+
+typedef struct {
+    double from, to, step;
+} Range;
+
+typedef struct {
+    float mass, k, eta, rho;
+    int t_ms;
+    unsigned seed;
+} RunSpec;
+
+typedef struct {
+    bool reached;
+    float time_to_target;      // Seconds of simulated time, -1 when not reached
+    float min_obstacle_dist;
+    int wall_hits;             // Steps on which the drone had to be clamped
+    long steps;
+} RunResult;
+
+// Same reader as the game processes
+void Parameter_File() {
+    FILE* file = fopen("Parameter_File.txt", "r");
+    if (file == NULL) {
+        perror("Parameter_File.txt not found, using defaults");
+        return;
+    }
+
+    char line[256];
+    int line_number = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+
+        char* tokens[10];
+        int token_count = 0;
+        char* token = strtok(line, "_");
+
+        while (token != NULL && token_count < 10) {
+            tokens[token_count] = token;
+            token_count++;
+            token = strtok(NULL, "_");
+        }
+
+        switch (line_number) {
+            case 1:
+                if (token_count > 2) window_width = atoi(tokens[2]);
+                break;
+            case 2:
+                if (token_count > 2) window_height = atoi(tokens[2]);
+                break;
+            case 3:
+                if (token_count > 2) rph_intial = atof(tokens[2]);
+                break;
+            case 4:
+                if (token_count > 2) eta_intial = atof(tokens[2]);
+                break;
+            case 5:
+                if (token_count > 2) force_intial = atoi(tokens[2]);
+                break;
+            case 6:
+                if (token_count > 1) mass = atoi(tokens[1]);
+                break;
+            case 7:
+                if (token_count > 2) k_intial = atoi(tokens[2]);
+                break;
+            case 9:
+                if (token_count > 2) t_intial = atoi(tokens[2]);
+                break;
+        }
+    }
+    fclose(file);
+}
+
+// Small deterministic generator so a seed always gives the same scenario
+static uint32_t next_rand(uint64_t *state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(*state >> 33);
+}
+
+static float rand_range(uint64_t *state, float lo, float hi) {
+    return lo + (hi - lo) * (next_rand(state) / 2147483648.0f);
+}
+
+// Thrust the autopilot picks: the key whose direction is closest to the target
+static void autopilot(float dx, float dy, float dist, float *Fx, float *Fy) {
+    static const float dirs[8][2] = {
+        {0, -1}, {0, 1}, {-1, 0}, {1, 0},                         // e c s f
+        {-M_SQRT1_2, -M_SQRT1_2}, {M_SQRT1_2, -M_SQRT1_2},         // w r
+        {-M_SQRT1_2, M_SQRT1_2}, {M_SQRT1_2, M_SQRT1_2}            // x v
+    };
+    int best = 0;
+    float best_dot = -2;
+    for (int i = 0; i < 8; i++) {
+        float dot = (dirs[i][0] * dx + dirs[i][1] * dy) / dist;
+        if (dot > best_dot) { best_dot = dot; best = i; }
+    }
+    int boost_level = (dist > NEAR_TARGET) ? 2 : 0;
+    float force = force_intial * (1.0f + boost_level * 0.2f);
+    *Fx = force * dirs[best][0];
+    *Fy = force * dirs[best][1];
+}
+
+static void run_scenario(const RunSpec *spec, int n_obstacles, float max_time, RunResult *out) {
+    const float w = window_width, h = window_height;
+    uint64_t rng = spec->seed * 0x9E3779B97F4A7C15ULL + 1;
+
+    FieldSources *obstacles = malloc(sizeof(FieldSources));
+    if (obstacles == NULL) {
+        memset(out, 0, sizeof(*out));
+        out->time_to_target = -1;
+        return;
+    }
+    field_clear(obstacles);
+
+    // Drone at the centre like the game, target anywhere inside the border,
+    // obstacles placed like process_Ob does
+    float x = w / 2, y = h / 2;
+    float tx = rand_range(&rng, 1, w - 2), ty = rand_range(&rng, 1, h - 2);
+    for (int i = 0; i < n_obstacles; i++) {
+        float ox = 1 + (int)rand_range(&rng, 0, w - 10);
+        float oy = 1 + (int)rand_range(&rng, 0, h - 10);
+        field_add(obstacles, ox, oy);
+    }
+
+    float T = spec->t_ms / 1000.0f;
+    DynParams dyn;
+    dyn_params_init(&dyn, spec->mass, spec->k, T);
+    FieldParams field;
+    field_params_init(&field, spec->rho, spec->eta);
+
+    float x_old = x, y_old = y;
+    long max_steps = (long)(max_time / T);
+    memset(out, 0, sizeof(*out));
+    out->time_to_target = -1;
+    out->min_obstacle_dist = INFINITY;
+
+    long step;
+    for (step = 0; step < max_steps; step++) {
+        float dx = tx - x, dy = ty - y;
+        float dist = sqrtf(dx * dx + dy * dy);
+        if (dist < TARGET_RADIUS) {
+            out->reached = true;
+            out->time_to_target = step * T;
+            break;
+        }
+
+        for (int i = 0; i < obstacles->count; i++) {
+            float ox = x - obstacles->x[i], oy = y - obstacles->y[i];
+            float d = sqrtf(ox * ox + oy * oy);
+            if (d < out->min_obstacle_dist) out->min_obstacle_dist = d;
+        }
+
+        float fx = 0, fy = 0;
+        autopilot(dx, dy, dist, &fx, &fy);
+        field_sources_force(obstacles, &field, x, y, &fx, &fy);
+        field_walls_force(&field, x, y, w, h, &fx, &fy);
+
+        dyn_step(&dyn, 1, &x, &y, &x_old, &y_old, NULL, NULL, fx, fy);
+
+        // The BlackBoard clamps the drone to the window and stops it there
+        bool hit = false;
+        if (x < 0) { x = x_old = 0; hit = true; }
+        if (x > w - 1) { x = x_old = w - 1; hit = true; }
+        if (y < 0) { y = y_old = 0; hit = true; }
+        if (y > h - 1) { y = y_old = h - 1; hit = true; }
+        if (hit) out->wall_hits++;
+    }
+    out->steps = step;
+    if (obstacles->count == 0) out->min_obstacle_dist = -1;
+    free(obstacles);
+}
+
+// ---- Work-stealing pool ----
+// Each worker owns a contiguous slice of the run indices. It takes runs from
+// the back of its own slice; when that is empty it steals the front half of
+// another worker's slice. Runs differ a lot in length (a target next to the
+// drone ends in a few steps, an unreachable one runs to --max-time), so
+// stealing keeps every core busy until the end.
+
+typedef struct {
+    pthread_mutex_t lock;
+    long head, tail;            // Remaining runs: [head, tail)
+} WorkQueue;
+
+typedef struct {
+    WorkQueue *queues;
+    int n_workers;
+    const RunSpec *specs;
+    RunResult *results;
+    int n_obstacles;
+    float max_time;
+} Pool;
+
+typedef struct {
+    Pool *pool;
+    int id;
+    long done;
+    long stolen;
+} Worker;
+
+static bool pop_own(WorkQueue *q, long *run) {
+    bool ok = false;
+    pthread_mutex_lock(&q->lock);
+    if (q->head < q->tail) {
+        *run = --q->tail;
+        ok = true;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+// Move the front half of victim's slice into ours; false when there was nothing
+static bool steal(WorkQueue *victim, WorkQueue *own) {
+    long from, to;
+    pthread_mutex_lock(&victim->lock);
+    long left = victim->tail - victim->head;
+    if (left <= 0) {
+        pthread_mutex_unlock(&victim->lock);
+        return false;
+    }
+    long take = (left + 1) / 2;
+    from = victim->head;
+    to = from + take;
+    victim->head = to;
+    pthread_mutex_unlock(&victim->lock);
+
+    pthread_mutex_lock(&own->lock);
+    own->head = from;
+    own->tail = to;
+    pthread_mutex_unlock(&own->lock);
+    return true;
+}
+
+static void *worker_main(void *arg) {
+    Worker *wk = arg;
+    Pool *pool = wk->pool;
+    WorkQueue *own = &pool->queues[wk->id];
+    long run;
+
+    for (;;) {
+        while (pop_own(own, &run)) {
+            run_scenario(&pool->specs[run], pool->n_obstacles, pool->max_time, &pool->results[run]);
+            wk->done++;
+        }
+
+        // Own slice empty: look for work elsewhere, starting with our neighbour
+        bool got = false;
+        for (int i = 1; i < pool->n_workers && !got; i++) {
+            got = steal(&pool->queues[(wk->id + i) % pool->n_workers], own);
+        }
+        if (!got) break;   // Every run left is already owned by a busy worker
+        wk->stolen++;
+    }
+    return NULL;
+}
+
+// ---- Command line ----
+
+static bool parse_range(const char *text, Range *r) {
+    char *end;
+    r->from = strtod(text, &end);
+    if (end == text) return false;
+    r->to = r->from;
+    r->step = 1;
+    if (*end == '\0') return true;
+    if (*end != ':') return false;
+    r->to = strtod(end + 1, &end);
+    if (*end == '\0') return r->to >= r->from;
+    if (*end != ':') return false;
+    r->step = strtod(end + 1, &end);
+    return *end == '\0' && r->step > 0 && r->to >= r->from;
+}
+
+static int range_count(const Range *r) {
+    return (int)floor((r->to - r->from) / r->step + 1e-9) + 1;
+}
+
+static double range_value(const Range *r, int i) {
+    return r->from + i * r->step;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [--mass a:b:step] [--k a:b:step] [--eta a:b:step] [--rho a:b:step]\n"
+            "          [--t ms:ms:step] [--seeds N] [--obstacles N] [--max-time s]\n"
+            "          [--threads N] [--out file.csv]\n"
+            "       %s --check\n", prog, prog);
+}
+
+// A drone at rest with no force must stay where it is. The integrator
+// feeds its rounding back every step, so a sloppy step (e.g. multiplying by
+// a reciprocal) shows up here as a slow creep.
+static bool check_rest(float m, float k, int t_ms) {
+    DynParams dyn;
+    dyn_params_init(&dyn, m, k, t_ms / 1000.0f);
+    const float x0 = 60.0f, y0 = 20.0f;
+    float x = x0, y = y0, x_old = x0, y_old = y0;
+    for (int s = 0; s < REST_STEPS; s++) {
+        dyn_step(&dyn, 1, &x, &y, &x_old, &y_old, NULL, NULL, 0.0f, 0.0f);
+    }
+    float drift = fmaxf(fabsf(x - x0), fabsf(y - y0));
+    bool ok = drift <= REST_TOLERANCE && x == x_old && y == y_old;
+    printf("check rest   mass=%g k=%g T=%dms: (%.6f, %.6f) after %d steps, drift %.2g  %s\n",
+           m, k, t_ms, x, y, REST_STEPS, drift, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    Parameter_File();
+
+    Range r_mass = {mass, mass, 1}, r_k = {k_intial, k_intial, 1};
+    Range r_eta = {eta_intial, eta_intial, 1}, r_rho = {rph_intial, rph_intial, 1};
+    Range r_t = {t_intial, t_intial, 1};
+    int seeds = 100;
+    int n_obstacles = 20;
+    float max_time = 120;
+    int n_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *out_path = "batch_results.csv";
+
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        bool ok = check_rest(mass, k_intial, t_intial);
+        ok = check_rest(2.5f, 0.3f, 20) && ok;
+        return ok ? 0 : RUNTIME_ERROR;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        bool ok = (val != NULL);
+        if (ok && strcmp(opt, "--mass") == 0) ok = parse_range(val, &r_mass);
+        else if (ok && strcmp(opt, "--k") == 0) ok = parse_range(val, &r_k);
+        else if (ok && strcmp(opt, "--eta") == 0) ok = parse_range(val, &r_eta);
+        else if (ok && strcmp(opt, "--rho") == 0) ok = parse_range(val, &r_rho);
+        else if (ok && strcmp(opt, "--t") == 0) ok = parse_range(val, &r_t);
+        else if (ok && strcmp(opt, "--seeds") == 0) ok = (seeds = atoi(val)) > 0;
+        else if (ok && strcmp(opt, "--obstacles") == 0) ok = (n_obstacles = atoi(val)) >= 0 && n_obstacles <= MAX_OBSTACLES;
+        else if (ok && strcmp(opt, "--max-time") == 0) ok = (max_time = atof(val)) > 0;
+        else if (ok && strcmp(opt, "--threads") == 0) ok = (n_workers = atoi(val)) > 0;
+        else if (ok && strcmp(opt, "--out") == 0) out_path = val;
+        else ok = false;
+        if (!ok) {
+            usage(argv[0]);
+            return USAGE_ERROR;
+        }
+        i++;
+    }
+    if (r_rho.from <= 0 || r_t.from < 1 || r_mass.from <= 0) {
+        fprintf(stderr, "rho, T and mass must be positive\n");
+        return USAGE_ERROR;
+    }
+    if (n_workers < 1) n_workers = 1;
+
+    // Every parameter combination times every seed
+    long n_runs = (long)range_count(&r_mass) * range_count(&r_k) * range_count(&r_eta) *
+                  range_count(&r_rho) * range_count(&r_t) * seeds;
+    RunSpec *specs = malloc(sizeof(RunSpec) * n_runs);
+    RunResult *results = calloc(n_runs, sizeof(RunResult));
+    if (specs == NULL || results == NULL) {
+        fprintf(stderr, "Out of memory for %ld runs\n", n_runs);
+        return RUNTIME_ERROR;
+    }
+    long n = 0;
+    for (int a = 0; a < range_count(&r_mass); a++)
+    for (int b = 0; b < range_count(&r_k); b++)
+    for (int c = 0; c < range_count(&r_eta); c++)
+    for (int d = 0; d < range_count(&r_rho); d++)
+    for (int e = 0; e < range_count(&r_t); e++)
+    for (int s = 0; s < seeds; s++) {
+        specs[n].mass = range_value(&r_mass, a);
+        specs[n].k = range_value(&r_k, b);
+        specs[n].eta = range_value(&r_eta, c);
+        specs[n].rho = range_value(&r_rho, d);
+        specs[n].t_ms = (int)range_value(&r_t, e);
+        specs[n].seed = (unsigned)s;
+        n++;
+    }
+
+    if (n_workers > n_runs) n_workers = (int)n_runs;
+    Pool pool = {0};
+    pool.queues = calloc(n_workers, sizeof(WorkQueue));
+    Worker *workers = calloc(n_workers, sizeof(Worker));
+    pthread_t *threads = calloc(n_workers, sizeof(pthread_t));
+    if (pool.queues == NULL || workers == NULL || threads == NULL) {
+        fprintf(stderr, "Out of memory for %d workers\n", n_workers);
+        return RUNTIME_ERROR;
+    }
+    pool.n_workers = n_workers;
+    pool.specs = specs;
+    pool.results = results;
+    pool.n_obstacles = n_obstacles;
+    pool.max_time = max_time;
+
+    // Initial slices of (almost) equal size
+    for (int i = 0; i < n_workers; i++) {
+        pthread_mutex_init(&pool.queues[i].lock, NULL);
+        pool.queues[i].head = n_runs * i / n_workers;
+        pool.queues[i].tail = n_runs * (i + 1) / n_workers;
+    }
+
+    fprintf(stderr, "batch_sim: %ld runs on %d threads\n", n_runs, n_workers);
+    double t0 = now_s();
+    for (int i = 0; i < n_workers; i++) {
+        workers[i].pool = &pool;
+        workers[i].id = i;
+        if (pthread_create(&threads[i], NULL, worker_main, &workers[i]) != 0) {
+            perror("pthread_create");
+            return RUNTIME_ERROR;
+        }
+    }
+    long steals = 0;
+    for (int i = 0; i < n_workers; i++) {
+        pthread_join(threads[i], NULL);
+        steals += workers[i].stolen;
+    }
+    double elapsed = now_s() - t0;
+
+    FILE *out = fopen(out_path, "w");
+    if (out == NULL) {
+        perror("Failed to open CSV output");
+        return OPEN_FAIL;
+    }
+    fprintf(out, "run,seed,mass,k,eta,rho,t_ms,reached,time_to_target_s,min_obstacle_dist,wall_hits,steps\n");
+    double sim_time = 0;
+    long reached = 0;
+    for (long i = 0; i < n_runs; i++) {
+        const RunSpec *sp = &specs[i];
+        const RunResult *rr = &results[i];
+        fprintf(out, "%ld,%u,%g,%g,%g,%g,%d,%d,%.3f,%.3f,%d,%ld\n",
+                i, sp->seed, sp->mass, sp->k, sp->eta, sp->rho, sp->t_ms, rr->reached,
+                rr->time_to_target, rr->min_obstacle_dist, rr->wall_hits, rr->steps);
+        sim_time += rr->steps * (sp->t_ms / 1000.0);
+        reached += rr->reached;
+    }
+    fclose(out);
+
+    fprintf(stderr, "batch_sim: %ld/%ld reached the target, %.1f s simulated in %.2f s "
+            "(%.0fx real time), %ld steals, results in %s\n",
+            reached, n_runs, sim_time, elapsed, elapsed > 0 ? sim_time / elapsed : 0.0,
+            steals, out_path);
+
+    for (int i = 0; i < n_workers; i++) pthread_mutex_destroy(&pool.queues[i].lock);
+    free(threads);
+    free(workers);
+    free(pool.queues);
+    free(specs);
+    free(results);
+    return 0;
+}
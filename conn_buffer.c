@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "conn_buffer.h"
+
+void conn_init(ConnBuffer *cb, int fd) {
+    memset(cb, 0, sizeof(*cb));
+    cb->fd = fd;
+}
+
+// Move unread bytes to the front so the free space is contiguous
+static void compact(ConnBuffer *cb) {
+    if (cb->start == 0) return;
+    size_t pending = cb->end - cb->start;
+    if (pending > 0) memmove(cb->buf, cb->buf + cb->start, pending);
+    cb->start = 0;
+    cb->end = pending;
+}
+
+char* conn_space(ConnBuffer *cb, size_t *len) {
+    if (cb->end == sizeof(cb->buf)) compact(cb);
+    if (cb->end == sizeof(cb->buf)) {
+        // A single message bigger than the whole buffer: drop it rather than stall
+        cb->start = cb->end = 0;
+    }
+    *len = sizeof(cb->buf) - cb->end;
+    return cb->buf + cb->end;
+}
+
+void conn_commit(ConnBuffer *cb, size_t n) {
+    cb->end += n;
+    cb->bytes_in += (unsigned long)n;
+}
+
+int conn_fill(ConnBuffer *cb) {
+    size_t space;
+    char *dst = conn_space(cb, &space);
+
+    for (;;) {
+        ssize_t n = read(cb->fd, dst, space);
+        cb->read_calls++;
+        if (n > 0) {
+            conn_commit(cb, (size_t)n);
+            return (int)n;
+        }
+        if (n == 0) return 0;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return -2;
+        return -1;
+    }
+}
+
+bool conn_has_line(const ConnBuffer *cb) {
+    return memchr(cb->buf + cb->start, '\n', cb->end - cb->start) != NULL;
+}
+
+int conn_next_line(ConnBuffer *cb, char *out, int max_len) {
+    char *nl = memchr(cb->buf + cb->start, '\n', cb->end - cb->start);
+    if (nl == NULL) return -1;
+
+    size_t len = (size_t)(nl - (cb->buf + cb->start));
+    size_t copy = (len < (size_t)max_len - 1) ? len : (size_t)max_len - 1;
+    memcpy(out, cb->buf + cb->start, copy);
+    out[copy] = '\0';
+
+    cb->start += len + 1;
+    if (cb->start == cb->end) cb->start = cb->end = 0;
+    cb->lines_in++;
+    return (int)copy;
+}
+
+int conn_read_line(ConnBuffer *cb, char *out, int max_len) {
+    int len;
+    while ((len = conn_next_line(cb, out, max_len)) < 0) {
+        int n = conn_fill(cb);
+        if (n == 0 || n == -1) return -1;
+        if (n == -2) return -2;
+    }
+    return len;
+}
+
+size_t conn_available(const ConnBuffer *cb) {
+    return cb->end - cb->start;
+}
+
+const char* conn_peek(const ConnBuffer *cb) {
+    return cb->buf + cb->start;
+}
+
+void conn_consume(ConnBuffer *cb, size_t n) {
+    if (n > cb->end - cb->start) n = cb->end - cb->start;
+    cb->start += n;
+    if (cb->start == cb->end) cb->start = cb->end = 0;
+}
+
+int conn_write_line(ConnBuffer *cb, const char *message) {
+    char buffer[4096];
+    int len = snprintf(buffer, sizeof(buffer), "%s\n", message);
+    if (len >= (int)sizeof(buffer)) {
+        len = sizeof(buffer) - 1;
+        buffer[len - 1] = '\n';
+    }
+
+    int done = 0;
+    while (done < len) {
+        ssize_t w = write(cb->fd, buffer + done, len - done);
+        cb->write_calls++;
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += (int)w;
+        cb->bytes_out += (unsigned long)w;
+    }
+    return done;
+}
+
+bool conn_queue_line(ConnBuffer *cb, const char *message) {
+    size_t len = strlen(message);
+    if (cb->out_len + len + 1 > sizeof(cb->out)) {
+        cb->dropped_out++;
+        return false;
+    }
+    memcpy(cb->out + cb->out_len, message, len);
+    cb->out[cb->out_len + len] = '\n';
+    cb->out_len += len + 1;
+    return true;
+}
+
+int conn_flush(ConnBuffer *cb) {
+    size_t done = 0;
+    while (done < cb->out_len) {
+        ssize_t w = write(cb->fd, cb->out + done, cb->out_len - done);
+        cb->write_calls++;
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        done += (size_t)w;
+        cb->bytes_out += (unsigned long)w;
+    }
+
+    if (done > 0) {
+        memmove(cb->out, cb->out + done, cb->out_len - done);
+        cb->out_len -= done;
+    }
+    return (int)cb->out_len;
+}
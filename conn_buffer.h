@@ -0,0 +1,70 @@
+// conn_buffer.h
+#ifndef CONN_BUFFER_H
+#define CONN_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Buffered framing for a socket (or any fd)
+// Instead of one read() per byte, conn_fill pulls whatever the kernel has
+// (up to CONN_BUFFER_SIZE) in one syscall, and lines or fixed-size frames are
+// then split out of the same reusable buffer. Partial messages stay buffered
+// until the rest arrives; several messages from one read are all kept.
+
+#define CONN_BUFFER_SIZE 8192
+
+typedef struct {
+    int fd;
+    char buf[CONN_BUFFER_SIZE];
+    size_t start;                  // First unread byte
+    size_t end;                    // One past the last buffered byte
+
+    // Counters
+    unsigned long read_calls;      // read() syscalls issued
+    unsigned long bytes_in;
+    unsigned long lines_in;
+    unsigned long write_calls;     // write() syscalls issued
+    unsigned long bytes_out;
+
+    // Optional output queue for non-blocking sockets
+    char out[CONN_BUFFER_SIZE];
+    size_t out_len;
+    unsigned long dropped_out;     // Messages refused because the queue was full
+} ConnBuffer;
+
+void conn_init(ConnBuffer *cb, int fd);
+
+// One read() into the free space. Returns bytes read, 0 on EOF,
+// -1 on error, -2 on timeout / would block.
+int conn_fill(ConnBuffer *cb);
+
+// Fill from something other than read(): conn_space returns the free space
+// (compacting first), conn_commit adds the n bytes the caller put there
+char* conn_space(ConnBuffer *cb, size_t *len);
+void conn_commit(ConnBuffer *cb, size_t n);
+
+// Take the next complete '\n'-terminated line out of the buffer (no syscall).
+// Returns its length, or -1 if no complete line is buffered yet.
+// Lines longer than max_len - 1 are truncated.
+int conn_next_line(ConnBuffer *cb, char *out, int max_len);
+bool conn_has_line(const ConnBuffer *cb);
+
+// Blocking line read: reads more only when no complete line is buffered.
+// Returns the length, -1 on EOF/error, -2 on timeout (SO_RCVTIMEO / EAGAIN).
+int conn_read_line(ConnBuffer *cb, char *out, int max_len);
+
+// Raw access for length-prefixed frames
+size_t conn_available(const ConnBuffer *cb);
+const char* conn_peek(const ConnBuffer *cb);
+void conn_consume(ConnBuffer *cb, size_t n);
+
+// Write message + '\n' in a single write(). Returns bytes written or -1.
+int conn_write_line(ConnBuffer *cb, const char *message);
+
+// Non-blocking output: queue a line (all or nothing, counted in dropped_out
+// when it does not fit) and push as much of the queue as the socket takes.
+// conn_flush returns the bytes still queued, or -1 if the peer is gone.
+bool conn_queue_line(ConnBuffer *cb, const char *message);
+int conn_flush(ConnBuffer *cb);
+
+#endif
@@ -0,0 +1,65 @@
+#include <math.h>
+#include "coord_transform.h"
+
+// Inverse of a 2x3 affine matrix (the scale factors are never 0)
+static Affine affine_invert(const Affine *m) {
+    Affine r;
+    float inv_det = 1.0f / (m->a * m->d - m->b * m->c);
+    r.a = m->d * inv_det;
+    r.b = -m->b * inv_det;
+    r.c = -m->c * inv_det;
+    r.d = m->a * inv_det;
+    r.tx = -(r.a * m->tx + r.b * m->ty);
+    r.ty = -(r.c * m->tx + r.d * m->ty);
+    return r;
+}
+
+void transform_init(CoordTransform *t, int local_w, int local_h,
+                    int virtual_w, int virtual_h,
+                    float x0, float y0, float alfa) {
+    float sx = (local_w > 0 && virtual_w > 0) ? (float)virtual_w / (float)local_w : 1.0f;
+    float sy = (local_h > 0 && virtual_h > 0) ? (float)virtual_h / (float)local_h : 1.0f;
+    float cs = cosf(alfa), sn = sinf(alfa);
+
+    // R(alfa) * S, then the offset
+    t->to_virtual.a = cs * sx;
+    t->to_virtual.b = -sn * sy;
+    t->to_virtual.tx = x0;
+    t->to_virtual.c = sn * sx;
+    t->to_virtual.d = cs * sy;
+    t->to_virtual.ty = y0;
+    t->to_local = affine_invert(&t->to_virtual);
+}
+
+Coord transform_point(const Affine *m, Coord p) {
+    Coord r;
+    r.x = m->a * p.x + m->b * p.y + m->tx;
+    r.y = m->c * p.x + m->d * p.y + m->ty;
+    return r;
+}
+
+Coord transform_vector(const Affine *m, Coord v) {
+    Coord r;
+    r.x = m->a * v.x + m->b * v.y;
+    r.y = m->c * v.x + m->d * v.y;
+    return r;
+}
+
+void transform_batch(const Affine *m, int n, const float *restrict x, const float *restrict y,
+                     float *restrict out_x, float *restrict out_y) {
+    // Copied to locals so the compiler knows they do not change in the loop
+    const float a = m->a, b = m->b, tx = m->tx;
+    const float c = m->c, d = m->d, ty = m->ty;
+    for (int i = 0; i < n; i++) {
+        out_x[i] = a * x[i] + b * y[i] + tx;
+        out_y[i] = c * x[i] + d * y[i] + ty;
+    }
+}
+
+Coord local_to_virtual(const CoordTransform *t, Coord local) {
+    return transform_point(&t->to_virtual, local);
+}
+
+Coord virtual_to_local(const CoordTransform *t, Coord virt) {
+    return transform_point(&t->to_local, virt);
+}
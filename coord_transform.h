@@ -0,0 +1,60 @@
+// coord_transform.h
+#ifndef COORD_TRANSFORM_H
+#define COORD_TRANSFORM_H
+
+// Local <-> virtual coordinates for the networked modes
+// The virtual plane is the server's window: the server sends its size in the
+// "size w,h" handshake and each peer scales its own window onto it, so
+// drones keep their relative place when the two windows differ. On top of
+// the scale come the session rotation and offset:
+//     virtual = R(alfa) * S * local + (x0, y0)
+// The whole chain is one 2x3 affine matrix, built once per session with
+// cos()/sin() evaluated there; the inverse is the matrix inverted, not a
+// second formula that could drift from the first.
+//
+// Batches are two float arrays (x[], y[]) and the loop has no branches, so
+// with -O3 -ffast-math GCC turns it into SIMD code: converting a whole
+// snapshot costs about what one point did before.
+
+// Transformation parameters shared by both peers
+#define VIRTUAL_X0   0.0f
+#define VIRTUAL_Y0   0.0f
+#define VIRTUAL_ALFA 0.0f    // Angle in radians
+
+typedef struct {
+    float x;
+    float y;
+} Coord;
+
+// x' = a*x + b*y + tx
+// y' = c*x + d*y + ty
+typedef struct {
+    float a, b, tx;
+    float c, d, ty;
+} Affine;
+
+typedef struct {
+    Affine to_virtual;
+    Affine to_local;
+} CoordTransform;
+
+// local_w x local_h is our window, virtual_w x virtual_h the server's. A
+// size that is not positive counts as equal to the other one (no scaling).
+void transform_init(CoordTransform *t, int local_w, int local_h,
+                    int virtual_w, int virtual_h,
+                    float x0, float y0, float alfa);
+
+Coord transform_point(const Affine *m, Coord p);
+// A displacement or velocity: the linear part only
+Coord transform_vector(const Affine *m, Coord v);
+
+// Transform the n points (x[i], y[i]) into (out_x[i], out_y[i]). The
+// output arrays must not overlap the input ones.
+void transform_batch(const Affine *m, int n, const float *x, const float *y,
+                     float *out_x, float *out_y);
+
+// One point with the session transform
+Coord local_to_virtual(const CoordTransform *t, Coord local);
+Coord virtual_to_local(const CoordTransform *t, Coord virt);
+
+#endif
@@ -0,0 +1,51 @@
+#include <math.h>
+#include <stddef.h>
+#include "dead_reckoning.h"
+
+void dr_params_init(DrParams *p, float mass, float k, float T) {
+    dyn_params_init(&p->dyn, mass, k, T);
+    p->blend = expf(-T * 1000.0f / DR_BLEND_MS);
+    p->max_steps = (int)(DR_MAX_EXTRAPOLATE_MS / (T * 1000.0f) + 0.5f);
+}
+
+void dr_sample(DrTrack *t, const DrParams *p, float x, float y, float vx, float vy, float age_s) {
+    float shown_x, shown_y;
+    dr_position(t, &shown_x, &shown_y);
+
+    // A sample older than the extrapolation limit says where the drone stopped
+    float max_age = p->max_steps * p->dyn.T;
+    if (age_s < 0) age_s = 0;
+    if (age_s > max_age) age_s = max_age;
+
+    // The age is at most a tick or two, a straight line is close enough
+    t->x = x + vx * age_s;
+    t->y = y + vy * age_s;
+    t->x_old = t->x - vx * p->dyn.T;
+    t->y_old = t->y - vy * p->dyn.T;
+    t->steps_left = p->max_steps - (int)(age_s / p->dyn.T);
+
+    float ex = shown_x - t->x, ey = shown_y - t->y;
+    if (!t->have || ex * ex + ey * ey > DR_SNAP_DISTANCE * DR_SNAP_DISTANCE) {
+        ex = ey = 0;
+    }
+    t->err_x = ex;
+    t->err_y = ey;
+    t->have = true;
+}
+
+void dr_step(DrTrack *t, const DrParams *p) {
+    if (t->steps_left > 0) {
+        dyn_step(&p->dyn, 1, &t->x, &t->y, &t->x_old, &t->y_old, NULL, NULL, 0, 0);
+        t->steps_left--;
+    } else {
+        t->x_old = t->x;
+        t->y_old = t->y;
+    }
+    t->err_x *= p->blend;
+    t->err_y *= p->blend;
+}
+
+void dr_position(const DrTrack *t, float *x, float *y) {
+    *x = t->x + t->err_x;
+    *y = t->y + t->err_y;
+}
@@ -0,0 +1,48 @@
+// dead_reckoning.h
+#ifndef DEAD_RECKONING_H
+#define DEAD_RECKONING_H
+
+#include <stdbool.h>
+#include "drone_dynamics.h"
+
+// Dead reckoning of the remote drones on the BlackBoard
+// Network updates arrive less often than we draw, so between two samples a
+// remote drone is moved with the Drone's own equation of motion
+// (drone_dynamics.h) and no command force: it keeps the velocity the Comm
+// process estimated and slows down under the damping K, as a drone does when
+// its keys are released. A new sample restarts the model from the sample
+// (advanced by its age), and the gap between where the drone was drawn and
+// where it really is fades out over about DR_BLEND_MS instead of showing as a
+// jump. After DR_MAX_EXTRAPOLATE_MS with no news the drone is held in place.
+
+#define DR_BLEND_MS           150
+#define DR_MAX_EXTRAPOLATE_MS 500
+#define DR_SNAP_DISTANCE      10.0f   // Cells; a longer jump (reset, respawn) is taken at once
+
+typedef struct {
+    DynParams dyn;
+    float blend;          // Share of the correction left after one step
+    int max_steps;        // Extrapolation steps after a sample
+} DrParams;
+
+typedef struct {
+    bool have;
+    float x, y;           // Model position
+    float x_old, y_old;   // One step ago, so the model carries the velocity
+    float err_x, err_y;   // Drawn minus model, decays to zero
+    int steps_left;       // Extrapolation steps before the drone is held
+} DrTrack;
+
+// mass, k: Parameter file values; T: BlackBoard tick in seconds
+void dr_params_init(DrParams *p, float mass, float k, float T);
+
+// New sample: position and velocity (cells/s) age_s seconds ago
+void dr_sample(DrTrack *t, const DrParams *p, float x, float y, float vx, float vy, float age_s);
+
+// Advance one BlackBoard tick
+void dr_step(DrTrack *t, const DrParams *p);
+
+// Where to draw the drone (and where it repels ours)
+void dr_position(const DrTrack *t, float *x, float *y);
+
+#endif
@@ -0,0 +1,100 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "drone_dynamics.h"
+
+void dyn_params_init(DynParams *p, float mass, float k, float T) {
+    p->mass = mass;
+    p->k = k;
+    p->T = T;
+    p->denom = mass + k * T;
+    p->history = 2.0f * mass + k * T;
+}
+
+void dyn_step(const DynParams *p, int n,
+              float *restrict x, float *restrict y,
+              float *restrict x_old, float *restrict y_old,
+              const float *restrict fx, const float *restrict fy,
+              float cmd_fx, float cmd_fy) {
+    const float T2 = p->T * p->T;
+    const float denom = p->denom;
+    const float history = p->history;
+    const float mass = p->mass;
+
+    // A true division, not a multiply by 1/denom: the recurrence feeds its
+    // rounding back every step, and a drone at rest would creep away
+    if (fx == NULL || fy == NULL) {
+        // F*T*T in the order the single drone always used
+        const float bx = cmd_fx * p->T * p->T, by = cmd_fy * p->T * p->T;
+        for (int i = 0; i < n; i++) {
+            float x_new = (bx + x[i] * history - mass * x_old[i]) / denom;
+            float y_new = (by + y[i] * history - mass * y_old[i]) / denom;
+            x_old[i] = x[i]; x[i] = x_new;
+            y_old[i] = y[i]; y[i] = y_new;
+        }
+        return;
+    }
+
+    for (int i = 0; i < n; i++) {
+        float x_new = ((fx[i] + cmd_fx) * T2 + x[i] * history - mass * x_old[i]) / denom;
+        float y_new = ((fy[i] + cmd_fy) * T2 + y[i] * history - mass * y_old[i]) / denom;
+        x_old[i] = x[i]; x[i] = x_new;
+        y_old[i] = y[i]; y[i] = y_new;
+    }
+}
+
+int swarm_alloc(Swarm *s, int count) {
+    memset(s, 0, sizeof(*s));
+    size_t bytes = sizeof(float) * (size_t)(count > 0 ? count : 1);
+    // 32-byte aligned rows, one AVX vector
+    bytes = (bytes + 31) & ~(size_t)31;
+    float **rows[] = {&s->x, &s->y, &s->x_old, &s->y_old, &s->fx, &s->fy};
+    for (size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++) {
+        *rows[i] = aligned_alloc(32, bytes);
+        if (*rows[i] == NULL) {
+            swarm_free(s);
+            return -1;
+        }
+        memset(*rows[i], 0, bytes);
+    }
+    s->count = count;
+    return 0;
+}
+
+void swarm_free(Swarm *s) {
+    free(s->x); free(s->y);
+    free(s->x_old); free(s->y_old);
+    free(s->fx); free(s->fy);
+    memset(s, 0, sizeof(*s));
+}
+
+void swarm_formation(Swarm *s, float cx, float cy, float spacing) {
+    int side = (int)ceilf(sqrtf((float)s->count));
+    if (side < 1) side = 1;
+    float half = (side - 1) * spacing / 2.0f;
+    for (int i = 0; i < s->count; i++) {
+        float x = cx - half + (i % side) * spacing;
+        float y = cy - half + (i / side) * spacing;
+        s->x[i] = s->x_old[i] = x;
+        s->y[i] = s->y_old[i] = y;
+    }
+}
+
+void swarm_clamp(Swarm *s, float w, float h) {
+    const float max_x = w - 1.0f, max_y = h - 1.0f;
+    float *restrict x = s->x, *restrict y = s->y;
+    float *restrict x_old = s->x_old, *restrict y_old = s->y_old;
+    for (int i = 0; i < s->count; i++) {
+        float cx = fminf(fmaxf(x[i], 0.0f), max_x);
+        float cy = fminf(fmaxf(y[i], 0.0f), max_y);
+        // Clamped drones stop: old position = new position
+        x_old[i] = (cx != x[i]) ? cx : x_old[i];
+        y_old[i] = (cy != y[i]) ? cy : y_old[i];
+        x[i] = cx;
+        y[i] = cy;
+    }
+}
+
+void swarm_step(Swarm *s, const DynParams *p, float cmd_fx, float cmd_fy) {
+    dyn_step(p, s->count, s->x, s->y, s->x_old, s->y_old, s->fx, s->fy, cmd_fx, cmd_fy);
+}
@@ -0,0 +1,55 @@
+// drone_dynamics.h
+#ifndef DRONE_DYNAMICS_H
+#define DRONE_DYNAMICS_H
+
+// Drone equation of motion, discretised with backward differences:
+//     M (x_new - 2x + x_old)/T^2 + K (x_new - x)/T = F
+//     x_new = (F T^2 + x (2M + KT) - M x_old) / (M + KT)
+// The same step is used for the single drone and for every swarm member.
+//
+// A swarm is stored as structure-of-arrays: one float array per coordinate,
+// so the step is a straight loop over contiguous memory that GCC turns into
+// SIMD code with -O3 -ffast-math. The file is built without the unsafe math
+// optimizations: the step divides in source order and rounds exactly like
+// the original single-drone formula, so a drone at rest stays put.
+
+typedef struct {
+    float mass;
+    float k;
+    float T;          // Seconds per step
+    float denom;      // M + KT
+    float history;    // 2M + KT
+} DynParams;
+
+typedef struct {
+    int count;
+    float *x, *y;           // Position now
+    float *x_old, *y_old;   // Position one step ago
+    float *fx, *fy;         // Per-drone external force (repulsion) for the next step
+} Swarm;
+
+void dyn_params_init(DynParams *p, float mass, float k, float T);
+
+// Advance n drones one step. Each drone feels fx[i] + cmd_fx (same for y);
+// fx/fy may be NULL when there is no per-drone force.
+void dyn_step(const DynParams *p, int n,
+              float *restrict x, float *restrict y,
+              float *restrict x_old, float *restrict y_old,
+              const float *restrict fx, const float *restrict fy,
+              float cmd_fx, float cmd_fy);
+
+// Swarm storage; -1 on allocation failure
+int swarm_alloc(Swarm *s, int count);
+void swarm_free(Swarm *s);
+
+// Place the drones at rest on a square lattice centred on (cx, cy)
+void swarm_formation(Swarm *s, float cx, float cy, float spacing);
+
+// Keep every drone inside [0, w-1] x [0, h-1]; a drone that hits the
+// border loses its velocity, like the single drone reset by the BlackBoard
+void swarm_clamp(Swarm *s, float w, float h);
+
+// Step the whole swarm with its fx/fy plus the shared command force
+void swarm_step(Swarm *s, const DynParams *p, float cmd_fx, float cmd_fy);
+
+#endif
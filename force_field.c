@@ -0,0 +1,122 @@
+#include <math.h>
+#include "force_field.h"
+
+void field_params_init(FieldParams *p, float rho, float eta) {
+    p->rho = rho;
+    p->eta = eta;
+    p->scale = FIELD_SCALE;
+    p->max_force = FIELD_MAX_FORCE;
+}
+
+void field_clear(FieldSources *s) {
+    s->count = 0;
+}
+
+bool field_add(FieldSources *s, float x, float y) {
+    if (s->count >= FIELD_MAX_SOURCES) return false;
+    s->x[s->count] = x;
+    s->y[s->count] = y;
+    s->count++;
+    return true;
+}
+
+int field_sources_force(const FieldSources *s, const FieldParams *p,
+                        float px, float py, float *fx, float *fy) {
+    const float rho2 = p->rho * p->rho;
+    const float inv_rho = 1.0f / p->rho;
+    const float gain = p->scale * p->eta;
+    const float max_force = p->max_force;
+    const float *xs = s->x;
+    const float *ys = s->y;
+    const int n = s->count;
+
+    float sum_x = 0.0f, sum_y = 0.0f, hits = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float dx = px - xs[i];
+        float dy = py - ys[i];
+        float d2 = dx * dx + dy * dy;
+
+        // 1 inside the influence radius, 0 outside
+        float in = (d2 < rho2) ? 1.0f : 0.0f;
+
+        float dc2 = fmaxf(d2, 1.0f);
+        float inv_d = 1.0f / sqrtf(dc2);
+        float f = fminf(gain / dc2 * (inv_d - inv_rho), max_force) * in;
+
+        sum_x += f * dx * inv_d;
+        sum_y += f * dy * inv_d;
+        hits += in;
+    }
+
+    *fx += sum_x;
+    *fy += sum_y;
+    return (int)hits;
+}
+
+// Force from one wall at distance d, pushing along (nx, ny)
+static int wall_force(const FieldParams *p, float d, float nx, float ny, float *fx, float *fy) {
+    if (d >= p->rho) return 0;
+    if (d < 1.0f) d = 1.0f;
+    float f = p->scale * p->eta / (d * d) * (1.0f / d - 1.0f / p->rho);
+    if (f > p->max_force) f = p->max_force;
+    *fx += f * nx;
+    *fy += f * ny;
+    return 1;
+}
+
+int field_walls_force(const FieldParams *p, float px, float py,
+                      float w, float h, float *fx, float *fy) {
+    int hits = 0;
+    hits += wall_force(p, px, 1.0f, 0.0f, fx, fy);         // Left
+    hits += wall_force(p, w - px, -1.0f, 0.0f, fx, fy);    // Right
+    hits += wall_force(p, py, 0.0f, 1.0f, fx, fy);         // Top
+    hits += wall_force(p, h - py, 0.0f, -1.0f, fx, fy);    // Bottom
+    return hits;
+}
+
+void field_swarm_force(const FieldSources *s, const FieldParams *p, int n,
+                       const float *restrict x, const float *restrict y,
+                       float *restrict fx, float *restrict fy) {
+    const float rho2 = p->rho * p->rho;
+    const float inv_rho = 1.0f / p->rho;
+    const float gain = p->scale * p->eta;
+    const float max_force = p->max_force;
+
+    // One source at a time against every point, the inner loop is the long one
+    for (int j = 0; j < s->count; j++) {
+        const float sx = s->x[j], sy = s->y[j];
+        for (int i = 0; i < n; i++) {
+            float dx = x[i] - sx;
+            float dy = y[i] - sy;
+            float d2 = dx * dx + dy * dy;
+            float in = (d2 < rho2) ? 1.0f : 0.0f;
+            float dc2 = fmaxf(d2, 1.0f);
+            float inv_d = 1.0f / sqrtf(dc2);
+            float f = fminf(gain / dc2 * (inv_d - inv_rho), max_force) * in;
+            fx[i] += f * dx * inv_d;
+            fy[i] += f * dy * inv_d;
+        }
+    }
+}
+
+// Branchless wall_force for the swarm loop
+static inline float wall_push(float d, float rho, float inv_rho, float gain, float max_force) {
+    float in = (d < rho) ? 1.0f : 0.0f;
+    float dc = fmaxf(d, 1.0f);
+    return fminf(gain / (dc * dc) * (1.0f / dc - inv_rho), max_force) * in;
+}
+
+void field_swarm_walls(const FieldParams *p, int n,
+                       const float *restrict x, const float *restrict y,
+                       float w, float h, float *restrict fx, float *restrict fy) {
+    const float rho = p->rho;
+    const float inv_rho = 1.0f / p->rho;
+    const float gain = p->scale * p->eta;
+    const float max_force = p->max_force;
+    for (int i = 0; i < n; i++) {
+        fx[i] += wall_push(x[i], rho, inv_rho, gain, max_force)
+               - wall_push(w - x[i], rho, inv_rho, gain, max_force);
+        fy[i] += wall_push(y[i], rho, inv_rho, gain, max_force)
+               - wall_push(h - y[i], rho, inv_rho, gain, max_force);
+    }
+}
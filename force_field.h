@@ -0,0 +1,57 @@
+// force_field.h
+#ifndef FORCE_FIELD_H
+#define FORCE_FIELD_H
+
+#include <stdbool.h>
+
+// Net repulsive force on the drone
+// Every obstacle, remote drone and wall closer than rho pushes the drone away
+// with the Khatib-style law used by the Drone so far:
+//     F = scale * eta * (1/d - 1/rho) / d^2      (d clamped to >= 1)
+// capped at max_force per source. The contributions are summed into one
+// vector per tick instead of keeping only the first source in range.
+//
+// Source positions are kept as two separate float arrays (x[], y[]) and the
+// range test compares squared distances, so the inner loop has no branches,
+// no pow() and only one sqrtf() per source; with -O3 -ffast-math GCC turns it
+// into SIMD code.
+
+#define FIELD_MAX_SOURCES 4096
+#define FIELD_SCALE       400.0f   // Bridge between physics and pixels
+#define FIELD_MAX_FORCE   40.0f    // Per-source cap, drones running towards each other
+
+typedef struct {
+    float rho;           // Influence radius
+    float eta;           // Repulsion gain
+    float scale;
+    float max_force;
+} FieldParams;
+
+typedef struct {
+    int count;
+    float x[FIELD_MAX_SOURCES] __attribute__((aligned(32)));
+    float y[FIELD_MAX_SOURCES] __attribute__((aligned(32)));
+} FieldSources;
+
+void field_params_init(FieldParams *p, float rho, float eta);
+
+void field_clear(FieldSources *s);
+bool field_add(FieldSources *s, float x, float y);    // false when full
+
+// Add the repulsion at (px, py) from every source within rho to *fx, *fy.
+// Returns the number of sources in range.
+int field_sources_force(const FieldSources *s, const FieldParams *p,
+                        float px, float py, float *fx, float *fy);
+
+// Same for the four walls of a w x h map
+int field_walls_force(const FieldParams *p, float px, float py,
+                      float w, float h, float *fx, float *fy);
+
+// Swarm versions: add the force at each of the n points (x[i], y[i]) to
+// fx[i], fy[i]. Loops run over the points so they vectorize like the above.
+void field_swarm_force(const FieldSources *s, const FieldParams *p, int n,
+                       const float *x, const float *y, float *fx, float *fy);
+void field_swarm_walls(const FieldParams *p, int n, const float *x, const float *y,
+                       float w, float h, float *fx, float *fy);
+
+#endif
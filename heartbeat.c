@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "heartbeat.h"
+
+static HeartbeatTable *own_table = NULL;   // This process's mapping and slot
+static HeartbeatSlot *own_slot = NULL;
+
+uint64_t heartbeat_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static HeartbeatTable* heartbeat_map(int flags) {
+    int fd = shm_open(HEARTBEAT_SHM_NAME, flags, 0666);
+    if (fd == -1) {
+        perror("shm_open heartbeat table");
+        return NULL;
+    }
+
+    if ((flags & O_CREAT) && ftruncate(fd, sizeof(HeartbeatTable)) == -1) {
+        perror("ftruncate heartbeat table");
+        close(fd);
+        return NULL;
+    }
+
+    void *p = mmap(NULL, sizeof(HeartbeatTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the segment alive
+    if (p == MAP_FAILED) {
+        perror("mmap heartbeat table");
+        return NULL;
+    }
+    return (HeartbeatTable *)p;
+}
+
+HeartbeatTable* heartbeat_create(void) {
+    // Drop any table left over from a crashed run
+    shm_unlink(HEARTBEAT_SHM_NAME);
+    HeartbeatTable *table = heartbeat_map(O_CREAT | O_RDWR | O_TRUNC);
+    if (table != NULL) {
+        memset(table, 0, sizeof(*table));
+    }
+    return table;
+}
+
+HeartbeatTable* heartbeat_attach(void) {
+    return heartbeat_map(O_RDWR);
+}
+
+void heartbeat_detach(HeartbeatTable *table) {
+    if (table != NULL) munmap(table, sizeof(HeartbeatTable));
+}
+
+void heartbeat_unlink(void) {
+    shm_unlink(HEARTBEAT_SHM_NAME);
+}
+
+int heartbeat_register(const char *name, unsigned budget_ms) {
+    if (own_slot != NULL) return 0;
+    own_table = heartbeat_attach();
+    if (own_table == NULL) return -1;
+
+    int pid = (int)getpid();
+    for (int i = 0; i < HEARTBEAT_MAX_SLOTS; i++) {
+        HeartbeatSlot *slot = &own_table->slots[i];
+        int expected = 0;
+        if (!atomic_compare_exchange_strong(&slot->pid, &expected, pid)) continue;
+
+        // Ours now; it stays idle (unchecked) until the first beat
+        atomic_store(&slot->state, HEARTBEAT_IDLE);
+        snprintf(slot->name, sizeof(slot->name), "%s", name);
+        slot->budget_ms = budget_ms;
+        atomic_store(&slot->beats, 0);
+        atomic_store(&slot->gap_sum_ns, 0);
+        atomic_store(&slot->gap_max_ns, 0);
+        atomic_store(&slot->last_ns, heartbeat_now_ns());
+        own_slot = slot;
+        return 0;
+    }
+    heartbeat_detach(own_table);
+    own_table = NULL;
+    return -1;
+}
+
+void heartbeat_beat(void) {
+    HeartbeatSlot *slot = own_slot;
+    if (slot == NULL) return;
+
+    uint64_t now = heartbeat_now_ns();
+    if (atomic_load_explicit(&slot->state, memory_order_relaxed) == HEARTBEAT_ACTIVE) {
+        // Loop time since the previous beat; only the watchdog ever lowers the max
+        uint64_t gap = now - atomic_load_explicit(&slot->last_ns, memory_order_relaxed);
+        atomic_fetch_add_explicit(&slot->gap_sum_ns, gap, memory_order_relaxed);
+        if (gap > atomic_load_explicit(&slot->gap_max_ns, memory_order_relaxed)) {
+            atomic_store_explicit(&slot->gap_max_ns, gap, memory_order_relaxed);
+        }
+        atomic_fetch_add_explicit(&slot->beats, 1, memory_order_relaxed);
+        atomic_store_explicit(&slot->last_ns, now, memory_order_release);
+    } else {
+        // First beat, or back from an idle wait: the gap is not a loop time
+        atomic_store_explicit(&slot->last_ns, now, memory_order_release);
+        atomic_store_explicit(&slot->state, HEARTBEAT_ACTIVE, memory_order_release);
+    }
+}
+
+void heartbeat_idle(void) {
+    if (own_slot != NULL) atomic_store_explicit(&own_slot->state, HEARTBEAT_IDLE, memory_order_release);
+}
+
+void heartbeat_unregister(void) {
+    if (own_slot == NULL) return;
+    atomic_store(&own_slot->state, HEARTBEAT_IDLE);
+    atomic_store(&own_slot->pid, 0);
+    own_slot = NULL;
+    heartbeat_detach(own_table);
+    own_table = NULL;
+}
@@ -0,0 +1,57 @@
+// heartbeat.h
+#ifndef HEARTBEAT_H
+#define HEARTBEAT_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Shared-memory heartbeat table
+// Master creates one segment with a slot per monitored process. A process
+// claims a slot once (heartbeat_register) and then stamps it from its main
+// loop (heartbeat_beat): a CLOCK_MONOTONIC timestamp, a beat counter and the
+// loop time since the previous beat. That is a vDSO clock read and a few
+// atomic stores, no syscalls and no signals. The watchdog scans every slot
+// every HEARTBEAT_SCAN_MS and flags a process whose last beat is older than
+// its budget, so a hang is seen within budget + scan interval and one stuck
+// process never delays the checks of the others.
+
+#define HEARTBEAT_SHM_NAME  "/arp_heartbeat"
+#define HEARTBEAT_MAX_SLOTS 16
+#define HEARTBEAT_SCAN_MS   20       // Watchdog scan period
+
+enum { HEARTBEAT_IDLE, HEARTBEAT_ACTIVE };
+
+typedef struct {
+    atomic_int pid;                  // 0 = free slot
+    atomic_int state;                // HEARTBEAT_IDLE: blocked on purpose, not checked
+    char name[32];
+    uint32_t budget_ms;              // Longest acceptable gap between beats
+    atomic_uint_least64_t beats;
+    atomic_uint_least64_t last_ns;   // CLOCK_MONOTONIC of the newest beat
+    atomic_uint_least64_t gap_sum_ns;
+    atomic_uint_least64_t gap_max_ns;   // Reset by the watchdog when it reports
+} HeartbeatSlot;
+
+typedef struct {
+    HeartbeatSlot slots[HEARTBEAT_MAX_SLOTS];
+} HeartbeatTable;
+
+// Segment lifetime: Master creates/unlinks, the watchdog attaches
+HeartbeatTable* heartbeat_create(void);
+HeartbeatTable* heartbeat_attach(void);
+void heartbeat_detach(HeartbeatTable *table);
+void heartbeat_unlink(void);
+
+// Monitored processes: one slot per process; -1 if the table is unavailable
+// or full (the beats are then no-ops)
+int heartbeat_register(const char *name, unsigned budget_ms);
+void heartbeat_beat(void);
+// About to block on purpose (e.g. paused); the next beat re-arms the checks
+void heartbeat_idle(void);
+// Free the slot on a normal exit
+void heartbeat_unregister(void);
+
+uint64_t heartbeat_now_ns(void);
+
+#endif
@@ -0,0 +1,131 @@
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "ipc_frame.h"
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+// Payload size for each type, 0 = unknown type
+static size_t payload_size(uint8_t type) {
+    switch (type) {
+    case FRAME_KEY:        return sizeof(FrameKey);
+    case FRAME_POSITION:   return sizeof(FramePosition);
+    case FRAME_ITEM:       return sizeof(FrameItem);
+    case FRAME_FORCE:      return sizeof(FrameForce);
+    case FRAME_REMOTE:     return sizeof(FrameRemote);
+    case FRAME_REMOTE_DEL: return sizeof(FrameRemoteDel);
+    default:               return 0;
+    }
+}
+
+void frame_writer_init(FrameWriter *w, int fd) {
+    memset(w, 0, sizeof(*w));
+    w->fd = fd;
+    w->chan = chan_claim(fd);
+}
+
+ssize_t frame_send(FrameWriter *w, FrameType type, const void *payload, size_t len) {
+    Frame f;
+    f.hdr.magic = FRAME_MAGIC;
+    f.hdr.version = FRAME_VERSION;
+    f.hdr.type = (uint8_t)type;
+    f.hdr.length = (uint8_t)len;
+    f.hdr.seq = ++w->seq;
+    f.hdr.t_us = now_us();
+    memcpy(&f.u, payload, len);
+
+    ssize_t n;
+    do {
+        n = (w->chan != NULL) ? chan_write(w->chan, &f, sizeof(f.hdr) + len)
+                              : write(w->fd, &f, sizeof(f.hdr) + len);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) w->failed++;
+    else w->sent++;
+    return n;
+}
+
+ssize_t frame_send_key(FrameWriter *w, char key, uint64_t t_in_us) {
+    FrameKey p = {key, t_in_us};
+    return frame_send(w, FRAME_KEY, &p, sizeof(p));
+}
+
+ssize_t frame_send_position(FrameWriter *w, float x, float y, uint64_t t_in_us) {
+    FramePosition p = {x, y, t_in_us};
+    return frame_send(w, FRAME_POSITION, &p, sizeof(p));
+}
+
+ssize_t frame_send_item(FrameWriter *w, int x, int y) {
+    FrameItem p = {x, y};
+    return frame_send(w, FRAME_ITEM, &p, sizeof(p));
+}
+
+ssize_t frame_send_force(FrameWriter *w, float fx, float fy) {
+    FrameForce p = {fx, fy};
+    return frame_send(w, FRAME_FORCE, &p, sizeof(p));
+}
+
+ssize_t frame_send_remote(FrameWriter *w, int id, float x, float y, float vx, float vy, uint64_t t_us) {
+    FrameRemote p = {id, x, y, vx, vy, t_us};
+    return frame_send(w, FRAME_REMOTE, &p, sizeof(p));
+}
+
+ssize_t frame_send_remote_del(FrameWriter *w, int id) {
+    FrameRemoteDel p = {id};
+    return frame_send(w, FRAME_REMOTE_DEL, &p, sizeof(p));
+}
+
+void frame_reader_init(FrameReader *r, int fd) {
+    memset(r, 0, sizeof(*r));
+    conn_init(&r->conn, fd);
+    r->chan = chan_claim(fd);
+}
+
+int frame_fill(FrameReader *r) {
+    if (r->chan == NULL) return conn_fill(&r->conn);
+
+    size_t space;
+    char *dst = conn_space(&r->conn, &space);
+    ssize_t n = chan_read(r->chan, dst, space);
+    r->conn.read_calls++;
+    if (n > 0) conn_commit(&r->conn, (size_t)n);
+    if (n >= 0) return (int)n;
+    return (errno == EAGAIN) ? -2 : -1;
+}
+
+bool frame_next(FrameReader *r, Frame *out) {
+    for (;;) {
+        size_t avail = conn_available(&r->conn);
+        if (avail < sizeof(FrameHeader)) return false;
+
+        FrameHeader hdr;
+        memcpy(&hdr, conn_peek(&r->conn), sizeof(hdr));
+
+        // Not a header we understand: skip a byte and look again
+        if (hdr.magic != FRAME_MAGIC || hdr.version != FRAME_VERSION ||
+            payload_size(hdr.type) == 0 || hdr.length != payload_size(hdr.type)) {
+            conn_consume(&r->conn, 1);
+            r->bad_bytes++;
+            continue;
+        }
+
+        if (avail < sizeof(hdr) + hdr.length) return false;   // Rest still in the pipe
+
+        out->hdr = hdr;
+        memcpy(&out->u, conn_peek(&r->conn) + sizeof(hdr), hdr.length);
+        conn_consume(&r->conn, sizeof(hdr) + hdr.length);
+
+        if (r->have_seq && hdr.seq != r->last_seq + 1) {
+            r->gaps += (uint32_t)(hdr.seq - r->last_seq - 1);
+        }
+        r->have_seq = true;
+        r->last_seq = hdr.seq;
+        r->frames++;
+        return true;
+    }
+}
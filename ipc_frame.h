@@ -0,0 +1,106 @@
+// ipc_frame.h
+#ifndef IPC_FRAME_H
+#define IPC_FRAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "conn_buffer.h"
+#include "spsc_chan.h"
+
+// Binary frames for every pipe created by main.c
+// Each message is a 16-byte header followed by a packed payload whose size is
+// fixed by its type:
+//     magic(1) version(1) type(1) length(1) seq(4) t_us(8) payload(length)
+// A writer sends header + payload with one write(); frames are far below
+// PIPE_BUF so they are never split or interleaved by the kernel. Readers pull
+// whatever the pipe holds into a ConnBuffer and take out complete frames,
+// keeping a partial one for the next read, so several messages arriving
+// together are all delivered and nothing is parsed as text.
+// In the threaded runtime the same fds name in-process channels
+// (spsc_chan.h); both ends find theirs at init and the frames go through the
+// channel's ring instead of read()/write(), with the same return values.
+
+#define FRAME_MAGIC   0xA5
+#define FRAME_VERSION 3
+
+typedef enum {
+    FRAME_KEY = 1,        // FrameKey        Input -> Drone, Input -> BlackBoard
+    FRAME_POSITION,       // FramePosition   Drone <-> BlackBoard, BlackBoard -> Comm
+    FRAME_ITEM,           // FrameItem       Obstacles/Targets -> BlackBoard
+    FRAME_FORCE,          // FrameForce      BlackBoard -> Drone, net repulsion
+    FRAME_REMOTE,         // FrameRemote     Comm -> BlackBoard, remote drone moved
+    FRAME_REMOTE_DEL      // FrameRemoteDel  Comm -> BlackBoard, remote drone left
+} FrameType;
+
+typedef struct __attribute__((packed)) {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint8_t length;       // Payload bytes
+    uint32_t seq;         // Per-writer, +1 per frame
+    uint64_t t_us;        // Writer's CLOCK_MONOTONIC in microseconds
+} FrameHeader;
+
+// t_in_us: Input's CLOCK_MONOTONIC (us) when it read the key, carried on to
+// the positions that reflect it (0 = none), see latency_hist.h
+typedef struct __attribute__((packed)) { char key; uint64_t t_in_us; } FrameKey;
+typedef struct __attribute__((packed)) { float x, y; uint64_t t_in_us; } FramePosition;
+typedef struct __attribute__((packed)) { int32_t x, y; } FrameItem;
+typedef struct __attribute__((packed)) { float fx, fy; } FrameForce;
+// vx, vy in cells per second; t_us: the Comm process's CLOCK_MONOTONIC when
+// the drone was at (x, y), for the BlackBoard's dead reckoning
+typedef struct __attribute__((packed)) { int32_t id; float x, y, vx, vy; uint64_t t_us; } FrameRemote;
+typedef struct __attribute__((packed)) { int32_t id; } FrameRemoteDel;
+
+typedef struct {
+    FrameHeader hdr;
+    union {
+        FrameKey key;
+        FramePosition pos;
+        FrameItem item;
+        FrameForce force;
+        FrameRemote remote;
+        FrameRemoteDel del;
+    } u;
+} Frame;
+
+typedef struct {
+    int fd;
+    ChanEnd *chan;                 // Threaded runtime: the channel behind fd
+    uint32_t seq;
+    unsigned long sent;
+    unsigned long failed;          // write() errors, including a full non-blocking pipe
+} FrameWriter;
+
+typedef struct {
+    ConnBuffer conn;
+    ChanEnd *chan;                 // Threaded runtime: the channel behind conn.fd
+    bool have_seq;
+    uint32_t last_seq;
+    unsigned long frames;
+    unsigned long gaps;            // Frames the writer sent but we never saw
+    unsigned long bad_bytes;       // Bytes skipped to find the next header
+} FrameReader;
+
+void frame_writer_init(FrameWriter *w, int fd);
+
+// Send one frame; returns the write() result
+ssize_t frame_send(FrameWriter *w, FrameType type, const void *payload, size_t len);
+ssize_t frame_send_key(FrameWriter *w, char key, uint64_t t_in_us);
+ssize_t frame_send_position(FrameWriter *w, float x, float y, uint64_t t_in_us);
+ssize_t frame_send_item(FrameWriter *w, int x, int y);
+ssize_t frame_send_force(FrameWriter *w, float fx, float fy);
+ssize_t frame_send_remote(FrameWriter *w, int id, float x, float y, float vx, float vy, uint64_t t_us);
+ssize_t frame_send_remote_del(FrameWriter *w, int id);
+
+void frame_reader_init(FrameReader *r, int fd);
+
+// One read() from the pipe, same return values as conn_fill
+int frame_fill(FrameReader *r);
+
+// Take the next complete frame out of the buffer (no syscall).
+// Returns false when no complete frame is buffered.
+bool frame_next(FrameReader *r, Frame *out);
+
+#endif
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "latency_hist.h"
+
+uint64_t lat_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+// Values below LAT_SUB have a bucket each; above, each power of two is split
+// into LAT_SUB buckets
+static int bucket_of(uint64_t us) {
+    if (us < LAT_SUB) return (int)us;
+    int msb = 63 - __builtin_clzll(us);
+    int shift = msb - LAT_SUB_BITS;
+    int idx = (shift + 1) * LAT_SUB + (int)((us >> shift) - LAT_SUB);
+    return (idx < LAT_BUCKETS) ? idx : LAT_BUCKETS - 1;
+}
+
+// Largest value that falls into bucket idx
+static uint64_t bucket_top(int idx) {
+    if (idx < LAT_SUB) return (uint64_t)idx;
+    int shift = idx / LAT_SUB - 1;
+    uint64_t base = (uint64_t)(LAT_SUB + idx % LAT_SUB) << shift;
+    return base + ((1ULL << shift) - 1);
+}
+
+void lat_init(LatencyHist *h, const char *name) {
+    memset(h, 0, sizeof(*h));
+    h->name = name;
+}
+
+void lat_record(LatencyHist *h, uint64_t us) {
+    h->buckets[bucket_of(us)]++;
+    h->count++;
+    h->sum_us += us;
+    if (us > h->max_us) h->max_us = us;
+}
+
+uint64_t lat_percentile(const LatencyHist *h, double p) {
+    if (h->count == 0) return 0;
+    uint64_t rank = (uint64_t)(p * (double)h->count);
+    if (rank >= h->count) rank = h->count - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < LAT_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen > rank) {
+            uint64_t top = bucket_top(i);
+            return (top < h->max_us) ? top : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+void lat_format(const LatencyHist *h, char *buf, size_t len) {
+    if (h->count == 0) {
+        snprintf(buf, len, "%s: no samples", h->name);
+        return;
+    }
+    snprintf(buf, len, "%s: n=%llu p50=%lluus p99=%lluus max=%lluus mean=%lluus", h->name,
+             (unsigned long long)h->count,
+             (unsigned long long)lat_percentile(h, 0.50),
+             (unsigned long long)lat_percentile(h, 0.99),
+             (unsigned long long)h->max_us,
+             (unsigned long long)(h->sum_us / h->count));
+}
@@ -0,0 +1,42 @@
+// latency_hist.h
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Latency histograms for the key press -> drawn frame path
+// Input stamps every key with CLOCK_MONOTONIC when read() returns it. The
+// stamp travels in the key frame to the Drone, and in the position frames
+// (or the shared drone snapshot) to the BlackBoard, whose render thread
+// finally puts it on screen. Each process records the stage it ends:
+//     input->drone   key read        -> applied by the Drone integrator
+//     drone->BB      position sent   -> consumed by the BlackBoard tick
+//     BB->frame      position taken  -> frame written to the terminal
+//     key->frame     key read        -> frame written to the terminal
+// Buckets are log-linear (32 per power of two), so a percentile is within
+// about 3% of the true value with a fixed 9 KB per histogram and O(1) record.
+
+#define LAT_SUB_BITS 5
+#define LAT_SUB      (1 << LAT_SUB_BITS)
+#define LAT_BUCKETS  (36 * LAT_SUB)        // Up to 2^40 us, larger values go in the last one
+
+typedef struct {
+    const char *name;
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+    uint64_t buckets[LAT_BUCKETS];
+} LatencyHist;
+
+void lat_init(LatencyHist *h, const char *name);
+void lat_record(LatencyHist *h, uint64_t us);
+// Upper edge of the bucket holding the p-th fraction of the samples (0..1)
+uint64_t lat_percentile(const LatencyHist *h, double p);
+// "name: n=.. p50=..us p99=..us max=..us mean=..us"
+void lat_format(const LatencyHist *h, char *buf, size_t len);
+
+// CLOCK_MONOTONIC in microseconds, the unit of every stamp
+uint64_t lat_now_us(void);
+
+#endif
@@ -15,8 +15,20 @@ typedef enum {
     LOG_CRITICAL
 } LogLevel;
 
+// Logging backends
+// SYNC:  every record opens, locks, writes and closes the log file (default)
+// ASYNC: records go into a per-process ring buffer and a background thread
+//        writes them in batches; when the ring is full new records are dropped
+//        and counted instead of blocking the caller
+typedef enum {
+    LOG_MODE_SYNC,
+    LOG_MODE_ASYNC
+} LogMode;
+
 // Function prototypes
 int logger_init(const char* log_file_path, int should_wipe);
+int logger_init_mode(const char* log_file_path, int should_wipe, LogMode mode);
+unsigned long logger_dropped_count(void);
 void logger_close(void);
 void logger_log(LogLevel level, const char* process_name, const char* file, 
                 int line, const char* function, const char* format, ...);
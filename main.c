@@ -7,6 +7,7 @@
 #include <sys/types.h> 
 #include <unistd.h> 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <sys/wait.h>
 #include <curses.h>
 #include <sys/time.h>
@@ -14,6 +15,12 @@
 #include <sys/file.h>
 #include "logger.h" 
 #include "logger_custom.h"
+#include "world_state.h"
+#include "swarm_state.h"
+#include "session_record.h"
+#include "heartbeat.h"
+#include "process_registry.h"
+#include "threaded_runtime.h"
 #include <sys/types.h>   // Required for system data types
 #include <sys/socket.h>  // Required for socket(), bind(), listen()
 #include <netinet/in.h>  // Required for sockaddr_in, AF_INET, INADDR_ANY
@@ -22,6 +29,14 @@
 // Global variables and parameters
 int window_width ;
 int window_height;
+int ipc_shm = 0;     // 1 = Drone/BlackBoard share the world state in shared memory
+int net_stream = 0;  // 1 = offer/accept the streaming network protocol
+int net_udp = 0;     // 1 = server and client talk UDP (net_udp.h) instead of TCP
+int swarm_size = 0;  // >0 = the Drone process simulates a swarm (standalone only)
+int force_intial;    // Dynamics, stored in recorded sessions
+int mass;
+int k_intial;
+int t_intial;
 
 // Function to read parameter file
 void Parameter_File() {
@@ -58,12 +73,53 @@ void Parameter_File() {
             case 2:
                 if (token_count > 2) window_height = atoi(tokens[2]);
                 break;
-            
+            case 5:
+                if (token_count > 2) force_intial = atoi(tokens[2]);
+                break;
+            case 6:
+                if (token_count > 1) mass = atoi(tokens[1]);
+                break;
+            case 7:
+                if (token_count > 2) k_intial = atoi(tokens[2]);
+                break;
+            case 9:
+                if (token_count > 2) t_intial = atoi(tokens[2]);
+                break;
+            case 12:
+                if (token_count > 2) ipc_shm = atoi(tokens[2]);
+                break;
+            case 13:
+                if (token_count > 2) net_stream = atoi(tokens[2]);
+                break;
+            case 14:
+                if (token_count > 2) swarm_size = atoi(tokens[2]);
+                break;
+            case 16:
+                if (token_count > 2) net_udp = atoi(tokens[2]);
+                break;
         }
     }
     fclose(file);
 }
 
+// Remove the shared segments created for this run
+static void release_shared(WorldState *world, HeartbeatTable *heartbeats, SwarmState *swarm) {
+    if (world != NULL) {
+        world_detach(world);
+        world_unlink();
+    }
+    if (heartbeats != NULL) {
+        heartbeat_detach(heartbeats);
+        heartbeat_unlink();
+    }
+    if (swarm != NULL) {
+        swarm_detach(swarm);
+        swarm_unlink();
+    }
+    registry_unlink();
+    logger_close();
+}
+
 // Global flag for signal handling
 volatile sig_atomic_t terminate_all = 0;
 
@@ -77,7 +133,7 @@ void handle_terminate(int signo) {
     }
 }
 
-int main()
+int main(int argc, char *argv[])
 {
     // Setup SIGTERM handler to receive termination from children
     struct sigaction sa;
@@ -87,9 +143,90 @@ int main()
     
     int mode;
     int sockfd = -1;  // For client/server socket
-    int portno;
-    char *hostname;
-
+    int portno = 0;
+    char *hostname = NULL;
+
+    // Session recording / replay (see session_record.h):
+    //   ./main --record <session_file> [--headless ...]   record a live or headless run
+    //   ./main --replay <session_file> [--fast] [state_output]
+    // A replay is headless, in the recorded mode, without the Input, obstacle,
+    // target or communication processes; --fast runs it unpaced.
+    const char *session_path = NULL;
+    int session_mode = SESSION_OFF;
+    SessionHeader session_hdr;
+    memset(&session_hdr, 0, sizeof(session_hdr));
+    const char *state_path = "headless_state.jsonl";
+    int arg = 1;
+    if (argc > 1 && (strcmp(argv[1], "--record") == 0 || strcmp(argv[1], "--replay") == 0)) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: %s --record <session_file> [--headless <input_script> [state_output]]\n"
+                            "       %s --replay <session_file> [--fast] [state_output]\n", argv[0], argv[0]);
+            return 1;
+        }
+        session_path = argv[2];
+        session_mode = (strcmp(argv[1], "--record") == 0) ? SESSION_RECORD : SESSION_REPLAY;
+        arg = 3;
+        if (session_mode == SESSION_REPLAY) {
+            if (argc > arg && strcmp(argv[arg], "--fast") == 0) {
+                session_mode = SESSION_REPLAY_FAST;
+                arg++;
+            }
+            if (argc > arg) state_path = argv[arg++];
+            if (session_read_header(session_path, &session_hdr) == -1) {
+                fprintf(stderr, "%s: not a session file\n", session_path);
+                return 1;
+            }
+        }
+    }
+    bool replaying = (session_mode == SESSION_REPLAY || session_mode == SESSION_REPLAY_FAST);
+
+    // Headless run: ./main --headless <input_script> [state_output]
+    // Standalone mode without konsole or ncurses; keys are read from the script
+    // and the BlackBoard writes the world state to state_output (JSON lines).
+    const char *script_path = NULL;
+    if (!replaying && argc > arg && strcmp(argv[arg], "--headless") == 0) {
+        if (argc < arg + 2) {
+            fprintf(stderr, "Usage: %s [--headless <input_script> [state_output]]\n", argv[0]);
+            return 1;
+        }
+        script_path = argv[arg + 1];
+        if (argc > arg + 2) state_path = argv[arg + 2];
+    }
+    // Single-process run: ./main --threaded [--server <port> | --client <host> <port>]
+    //                                        <input_script> [state_output]
+    // Every component is a thread of this process (see threaded_runtime.h),
+    // headless like --headless, in standalone mode unless a network role is given.
+    bool threaded = false;
+    int threaded_mode = 1;
+    if (!replaying && session_mode == SESSION_OFF && argc > 1 && strcmp(argv[1], "--threaded") == 0) {
+        threaded = true;
+        arg = 2;
+        if (argc > arg + 1 && strcmp(argv[arg], "--server") == 0) {
+            threaded_mode = 2;
+            portno = atoi(argv[arg + 1]);
+            arg += 2;
+        } else if (argc > arg + 2 && strcmp(argv[arg], "--client") == 0) {
+            threaded_mode = 3;
+            hostname = argv[arg + 1];
+            portno = atoi(argv[arg + 2]);
+            arg += 3;
+        }
+        if (argc <= arg) {
+            fprintf(stderr, "Usage: %s --threaded [--server <port> | --client <host> <port>] <input_script> [state_output]\n", argv[0]);
+            return 1;
+        }
+        script_path = argv[arg];
+        if (argc > arg + 1) state_path = argv[arg + 1];
+    }
+    bool headless = (script_path != NULL) || replaying;
+
+    if (replaying) {
+        mode = session_hdr.mode;
+    } else if (threaded) {
+        mode = threaded_mode;
+    } else if (headless) {
+        mode = 1;
+    } else {
         // ASK MODE BEFORE FORKING
         printf("Select mode:\n");
         printf("1. Standalone (normal assignment 2)\n");
@@ -97,6 +234,7 @@ int main()
         printf("3. Client\n");
         printf("Enter choice: ");
         scanf("%d", &mode);
+    }
 
         if (mode < 1 || mode > 3) {
             printf("Invalid choice. Exiting.\n");
@@ -105,14 +243,33 @@ int main()
    
     
     Parameter_File();
+
+    char session_mode_str[10];
+    snprintf(session_mode_str, sizeof(session_mode_str), "%d", session_mode);
+    if (session_mode == SESSION_RECORD) {
+        session_hdr.mode = mode;
+        session_hdr.tick_ms = t_intial;
+        session_hdr.force = force_intial;
+        session_hdr.mass = mass;
+        session_hdr.k = k_intial;
+        if (session_create(session_path, &session_hdr) == -1) {
+            perror(session_path);
+            return 1;
+        }
+    }
+    if (session_path == NULL) session_path = "";
     
-    if (mode == 2) {
+    if (replaying) {
+        // No network: the remote drones come from the session
+    } else if (mode == 2) {
         // SERVER MODE - get port number
-        printf("Enter port number (2000-65535): ");
-        scanf("%d", &portno);
+        if (!threaded) {
+            printf("Enter port number (2000-65535): ");
+            scanf("%d", &portno);
+        }
         
-        // Setup server socket (but don't accept yet)
-        sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        // Setup server socket (but don't accept yet); a UDP socket is only bound
+        sockfd = socket(AF_INET, net_udp ? SOCK_DGRAM : SOCK_STREAM, 0);
         struct sockaddr_in serv_addr;
         memset(&serv_addr, 0, sizeof(serv_addr));
         serv_addr.sin_family = AF_INET;
@@ -120,26 +277,74 @@ int main()
         serv_addr.sin_port = htons(portno);
         
         bind(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr));
-        listen(sockfd, 5);
+        if (!net_udp) listen(sockfd, SOMAXCONN);
         
     } else if (mode == 3) {
         // CLIENT MODE - get hostname and port
-        hostname = malloc(256);
-        printf("Enter server hostname: ");
-        scanf("%s", hostname);
-        printf("Enter port number: ");
-        scanf("%d", &portno);
+        if (!threaded) {
+            hostname = malloc(256);
+            printf("Enter server hostname: ");
+            scanf("%s", hostname);
+            printf("Enter port number: ");
+            scanf("%d", &portno);
+        }
     }
 
-    // Clear the log file at start of Master so we don't keep old runs
-    // "w" mode truncates the file if it exists and creates it if it doesn't
-    FILE *f = fopen("process_log.log", "w");
-    fclose(f);
+    // Fresh process registry for this run; every process publishes its PID here
+    if (registry_create() == NULL) {
+        fprintf(stderr, "Failed to create the process registry\n");
+        return 1;
+    }
 
     // 2. LOG the Master process
     log_process("Master", getpid());
     logger_init("system.log",1);  // 
     LOG_INFO("Master", "Starting Master Process (PID=%d)", getpid());
+
+    // Shared-memory world state for Drone <-> BlackBoard, pipes are the fallback
+    WorldState *world = NULL;
+    if (ipc_shm) {
+        world = world_create();
+        if (world == NULL) {
+            LOG_WARNING("Master", "Shared-memory world state unavailable, falling back to pipes");
+            ipc_shm = 0;
+        } else {
+            LOG_INFO("Master", "Drone/BlackBoard transport: shared memory (%s)", WORLD_SHM_NAME);
+        }
+    }
+    // Heartbeat table scanned by the watchdog
+    HeartbeatTable *heartbeats = heartbeat_create();
+    if (heartbeats == NULL) {
+        LOG_WARNING("Master", "Heartbeat table unavailable, the watchdog will not monitor anything");
+    }
+    // Swarm positions and arena, shared by the Drone and the BlackBoard
+    SwarmState *swarm = NULL;
+    if (swarm_size > 0 && session_mode != SESSION_OFF) {
+        LOG_WARNING("Master", "Sessions are recorded and replayed with a single drone, swarm disabled");
+    } else if (swarm_size > 0 && threaded) {
+        LOG_WARNING("Master", "Swarm mode is not available in the threaded runtime, running a single drone");
+    } else if (swarm_size > 0 && mode == 1) {
+        swarm = swarm_create();
+        if (swarm == NULL) {
+            LOG_WARNING("Master", "Swarm state unavailable, running a single drone");
+        } else {
+            LOG_INFO("Master", "Swarm mode: %d drones (%s)", swarm_size, SWARM_SHM_NAME);
+        }
+    } else if (swarm_size > 0) {
+        LOG_WARNING("Master", "Swarm mode is only available in standalone mode");
+    }
+    char transport_str[10];
+    snprintf(transport_str, sizeof(transport_str), "%d", ipc_shm);
+
+    if (threaded) {
+        // No fork, no pipes and no watchdog: the components are threads
+        ThreadedConfig cfg = { mode, ipc_shm, net_stream, window_width, window_height,
+                               sockfd, hostname, portno, script_path, state_path, net_udp };
+        int ret = threaded_run(&cfg);
+        if (sockfd != -1) close(sockfd);
+        release_shared(world, heartbeats, swarm);
+        return ret;
+    }
     
     int fdIn[2], fdOb[2], fdTa[2],fdToBB[2], fdFromBB[2],fdRepul[2], fdComm_ToBB[2], fdComm_FromBB[2];
 
@@ -203,8 +408,6 @@ int main()
     fcntl(fdComm_FromBB[0], F_SETFL, O_NONBLOCK);
     fcntl(fdComm_FromBB[1], F_SETFL, O_NONBLOCK);
 
-    sleep(2);
-
     //.....BlackBoard.....
     pid_t BB=fork();
     if (BB < 0)
@@ -262,7 +465,11 @@ int main()
         char operation[10];
         snprintf(operation, sizeof(operation), "%d", mode);
         
-        execlp("konsole", "konsole", "-e", "./BlackBoard",fdToBB_str,fdFromBB_str,fdOb_str,fdTa_str,"./pipe_blackboard_input",fdRepul_str,fdComm_FromBB_str ,fdComm_ToBB_str,operation, (char *)NULL); // launch another process if condition met
+        if (headless) {
+            execlp("./BlackBoard", "./BlackBoard",fdToBB_str,fdFromBB_str,fdOb_str,fdTa_str,"./pipe_blackboard_input",fdRepul_str,fdComm_FromBB_str ,fdComm_ToBB_str,operation,transport_str,state_path,session_mode_str,session_path, (char *)NULL);
+        } else {
+            execlp("konsole", "konsole", "-e", "./BlackBoard",fdToBB_str,fdFromBB_str,fdOb_str,fdTa_str,"./pipe_blackboard_input",fdRepul_str,fdComm_FromBB_str ,fdComm_ToBB_str,operation,transport_str,"",session_mode_str,session_path, (char *)NULL); // launch another process if condition met
+        }
        
         // If exec fails
         LOG_ERRNO("Master,BB fork","exec failed");
@@ -272,7 +479,8 @@ int main()
     }
 
     //.....Input.....
-    pid_t In=fork();
+    // (not started for a replay, its keys are in the session)
+    pid_t In = replaying ? 0 : fork();
 
         if (In < 0)
    {
@@ -280,7 +488,7 @@ int main()
     return 1;
     }
 
-    if (In == 0)
+    if (In == 0 && !replaying)
     {
        
         printf("Process In: PID = %d\n", getpid()); 
@@ -295,7 +503,11 @@ int main()
 
         // Execute process_P with fd[1] as a command-line argument
         
-        execlp("konsole", "konsole", "-e", "./process_In", fd_str, "./pipe_blackboard_input",(char *)NULL); // launch another process if condition met
+        if (headless) {
+            execlp("./process_In", "./process_In", fd_str, "./pipe_blackboard_input", script_path, (char *)NULL);
+        } else {
+            execlp("konsole", "konsole", "-e", "./process_In", fd_str, "./pipe_blackboard_input",(char *)NULL); // launch another process if condition met
+        }
        
         LOG_ERRNO("Master,In fork","exec failed");
         exit(1);
@@ -347,7 +559,7 @@ int main()
         char operation[10];
         snprintf(operation, sizeof(operation), "%d", mode);
         
-        execlp("./process_Drone", "./process_Drone",fdIn_str,fdFromBB_str,fdtoBB_str,fdRepul_str,operation, (char *)NULL); // launch another process if condition met
+        execlp("./process_Drone", "./process_Drone",fdIn_str,fdFromBB_str,fdtoBB_str,fdRepul_str,operation,transport_str,session_mode_str,session_path, (char *)NULL); // launch another process if condition met
        
         // If exec fails
         LOG_ERRNO("Master,Dr fork","exec failed");
@@ -379,7 +591,12 @@ int main()
     pid_t Ta = 0;
     pid_t Comm = 0;
 
-    if (mode == 1){
+    if (replaying) {
+        // Obstacles, targets and remote drones are replayed by the BlackBoard
+        LOG_INFO("Master", "Replaying session %s%s", session_path,
+                 session_mode == SESSION_REPLAY_FAST ? " unpaced" : "");
+    }
+    else if (mode == 1){
         
         //.....Obstacle.....
         Ob=fork();
@@ -480,8 +697,14 @@ int main()
             char sockfd_str[10];
             snprintf(sockfd_str, sizeof(sockfd_str), "%d", sockfd);
             
-            // Corrected arguments: sockfd, FromBB (Read), ToBB (Write), width, height
-            execlp("./Communication_Server", "./Communication_Server", sockfd_str, fdComm_FromBB_str, fdComm_ToBB_str, width_str, height_str, (char*)NULL);
+            char stream_str[10];
+            snprintf(stream_str, sizeof(stream_str), "%d", net_stream);
+
+            char udp_str[10];
+            snprintf(udp_str, sizeof(udp_str), "%d", net_udp);
+
+            // Corrected arguments: sockfd, FromBB (Read), ToBB (Write), width, height, streaming, udp
+            execlp("./Communication_Server", "./Communication_Server", sockfd_str, fdComm_FromBB_str, fdComm_ToBB_str, width_str, height_str, stream_str, udp_str, (char*)NULL);
         
             // If exec fails
             LOG_ERRNO("Master,Dr fork","exec failed");
@@ -522,8 +745,20 @@ int main()
             char portno_str[10];
             snprintf(portno_str, sizeof(portno_str), "%d", portno);
 
-            // Corrected arguments: hostname, port, FromBB (Read), ToBB (Write)
-            execlp("./Communication_Client", "./Communication_Client", hostname, portno_str, fdComm_FromBB_str, fdComm_ToBB_str, (char *)NULL);
+            char stream_str[10];
+            snprintf(stream_str, sizeof(stream_str), "%d", net_stream);
+
+            char udp_str[10];
+            snprintf(udp_str, sizeof(udp_str), "%d", net_udp);
+
+            char width_str[10];
+            snprintf(width_str, sizeof(width_str), "%d", window_width);
+
+            char height_str[10];
+            snprintf(height_str, sizeof(height_str), "%d", window_height);
+
+            // Corrected arguments: hostname, port, FromBB (Read), ToBB (Write), streaming, udp, our window size
+            execlp("./Communication_Client", "./Communication_Client", hostname, portno_str, fdComm_FromBB_str, fdComm_ToBB_str, stream_str, udp_str, width_str, height_str, (char *)NULL);
         
             // If exec fails
             LOG_ERRNO("Master,Dr fork","exec failed");
@@ -532,27 +767,11 @@ int main()
         }
     }
 
-    pid_t input_pid = -1;
-    pid_t blackboard_pid = -1;
-    int retries = 0;
-
-    while (input_pid == -1 && blackboard_pid == -1 && retries < 10) {
-        sleep(1);
-        input_pid = get_pid_by_name("Input");
-        blackboard_pid = get_pid_by_name("BlackBoard");
-        // --- CORRECT PRINTF SYNTAX ---
-        //printf("[DEBUG] Retry %d: Input PID = %d, BlackBoard PID = %d\n", 
-          //     retries, (int)input_pid, (int)blackboard_pid);
-        // -----------------------------
-
-        retries++;
-    }
+    // Input and BlackBoard run inside konsole, so their PIDs are not the forked
+    // ones: block until they register themselves (10 s at most each)
+    pid_t input_pid = replaying ? 0 : registry_wait("Input", REGISTRY_TIMEOUT_MS);   // 0 = no Input process
+    pid_t blackboard_pid = registry_wait("BlackBoard", REGISTRY_TIMEOUT_MS);
     
-    if (input_pid == -1 || blackboard_pid == -1) {
-        LOG_WARNING("Input or Blackboard","Could not find konsoled process! Exiting.\n");
-        return 1;
-    }
-
     //closing all pipes
     // Close Input Pipes
     close(fdIn[0]); close(fdIn[1]);
@@ -574,6 +793,36 @@ int main()
     close(fdComm_ToBB[0]); close(fdComm_ToBB[1]);
     close(fdComm_FromBB[0]); close(fdComm_FromBB[1]);
 
+    if (input_pid == -1 || blackboard_pid == -1) {
+        LOG_WARNING("Input or Blackboard","Could not find konsoled process! Exiting.\n");
+
+        // Stop the children already started, as on a terminate signal, so
+        // none of them outlives the segments removed below
+        if (WD > 0) kill(WD, SIGTERM);
+        if (input_pid > 0) kill(input_pid, SIGTERM);
+        if (blackboard_pid > 0) kill(blackboard_pid, SIGTERM);
+        if (Comm > 0) kill(Comm, SIGTERM);
+        if (Ob > 0) kill(Ob, SIGTERM);
+        if (Ta > 0) kill(Ta, SIGTERM);
+        if (Dr > 0) kill(Dr, SIGTERM);
+
+        usleep(500000);
+
+        if (BB > 0) kill(BB, SIGTERM);
+        if (In > 0) kill(In, SIGTERM);
+
+        sleep(1);
+
+        if (BB > 0) kill(BB, SIGKILL);
+        if (In > 0) kill(In, SIGKILL);
+
+        while (wait(NULL) > 0);
+
+        unlink(pipe_path);
+        release_shared(world, heartbeats, swarm);
+        return 1;
+    }
+
     // Wait for all child processes with status checking
     int status;
     int failures = 0;
@@ -623,6 +872,9 @@ int main()
         // We check this FIRST, before caring about how it died.
         if (wpid == Dr) {
             fprintf(stderr, "MASTER: Drone (PID %d) has stopped. Shutting down system...\n", wpid);
+
+            // An unpaced replay lets the BlackBoard finish its own events
+            if (replaying && BB > 0) waitpid(BB, NULL, 0);
             
             
             // 1. Terminate everyone including Watchdog
@@ -677,6 +929,7 @@ int main()
 
     //unlink the named pipe
     unlink(pipe_path);
-    logger_close();
+
+    release_shared(world, heartbeats, swarm);
     return 0;
 }
\ No newline at end of file
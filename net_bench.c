@@ -0,0 +1,972 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "ipc_frame.h"
+#include "latency_hist.h"
+#include "process_registry.h"
+#include "net_udp.h"
+#include "net_delta.h"
+#include "coord_transform.h"
+
+// Network loopback benchmark
+// Starts ./Communication_Server and ./Communication_Client on localhost with
+// the arguments main.c gives them, but with pipes of our own in place of the
+// two BlackBoards. --rate times per second the server drone is moved to a
+// new position that encodes a sequence number. When the client hands that
+// position to its BlackBoard (us), the server->client time is recorded and
+// the position is echoed straight back as the client's drone; when the
+// server hands it to its BlackBoard the round trip is complete. Positions
+// overtaken by a newer one before they were sent count as coalesced, since
+// both protocols only ever send the newest state.
+//
+// With --delay, --jitter or --loss the client connects to a shaping proxy in
+// this process instead, which holds every chunk (TCP) or datagram (UDP) for
+// delay +- jitter ms in each direction and drops --loss % of the datagrams.
+// Over TCP loss is not simulated: the kernel would hide it behind a
+// retransmission, use tc netem on lo for that. When all PROXY_SLOTS are
+// taken, a TCP proxy stops reading and lets the kernel push back on the
+// sender; a UDP proxy drops the datagram and reports it as over capacity.
+//
+//   ./net_bench [--rate hz] [--duration s] [--port p] [--stream 0|1] [--udp 0|1]
+//               [--delay ms] [--jitter ms] [--loss %] [--seed n] [--csv file.csv]
+//   ./net_bench --check
+//
+// --stream and --udp default to Parameter_File.txt (lines 13 and 16). The
+// results are printed, and appended as one CSV row with --csv so protocol
+// changes can be compared run by run. Run it from the directory holding the
+// two programs; it creates the process registry like main, so do not run it
+// next to a game. --check only runs the self-checks of the UDP datagram
+// decoder (on a loopback socket pair), the delta codec and the virtual
+// coordinate transform, and exits non-zero if one fails.
+
+#define SEQ_RING     300000     // Sequence numbers a position can encode
+#define JOIN_MS      20000      // The client must have joined by then (TCP retries every 3 s)
+#define DRAIN_MS     1000       // Wait for late updates after the last send
+#define PROXY_SLOTS  1024       // Chunks/datagrams in flight through the proxy
+#define PROXY_CHUNK  2048
+#define CODEC_RUNS   20000      // --check: random worlds encoded and decoded
+#define XFORM_POINTS 67         // --check: points per transform, not a multiple of the SIMD width
+#define XFORM_TOL    1e-3f      // --check: allowed error, in cells
+
+// Standardized exit codes
+#define USAGE_ERROR 64
+#define RUNTIME_ERROR 70
+
+int window_width = 120;
+int window_height = 40;
+int net_stream = 0;
+int net_udp = 0;
+
+// Same reader as the game processes
+void Parameter_File() {
+    FILE* file = fopen("Parameter_File.txt", "r");
+    if (file == NULL) {
+        perror("Parameter_File.txt not found, using defaults");
+        return;
+    }
+
+    char line[256];
+    int line_number = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+
+        char* tokens[10];
+        int token_count = 0;
+        char* token = strtok(line, "_");
+
+        while (token != NULL && token_count < 10) {
+            tokens[token_count] = token;
+            token_count++;
+            token = strtok(NULL, "_");
+        }
+
+        switch (line_number) {
+            case 1:
+                if (token_count > 2) window_width = atoi(tokens[2]);
+                break;
+            case 2:
+                if (token_count > 2) window_height = atoi(tokens[2]);
+                break;
+            case 13:
+                if (token_count > 2) net_stream = atoi(tokens[2]);
+                break;
+            case 16:
+                if (token_count > 2) net_udp = atoi(tokens[2]);
+                break;
+        }
+    }
+    fclose(file);
+}
+
+static volatile sig_atomic_t stop = 0;
+
+// A Communication process that loses its peer signals its parent: us
+static void handle_stop(int signo) {
+    (void)signo;
+    stop = 1;
+}
+
+// Small deterministic generator for the proxy's jitter and loss
+static uint32_t next_rand(uint64_t *state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(*state >> 33);
+}
+
+// Sequence number <-> position, exact through the "%.1f" text protocols:
+// x = 1.0 .. 100.9 and y = 1.0 .. 30.9 in steps of 0.1
+static void seq_to_pos(uint32_t seq, float *x, float *y) {
+    uint32_t s = seq % SEQ_RING;
+    *x = 1.0f + (float)(s % 1000) * 0.1f;
+    *y = 1.0f + (float)(s / 1000) * 0.1f;
+}
+
+static long pos_to_seq(float x, float y) {
+    long a = lroundf((x - 1.0f) * 10.0f);
+    long b = lroundf((y - 1.0f) * 10.0f);
+    if (a < 0 || a >= 1000 || b < 0 || b >= SEQ_RING / 1000) return -1;
+    return b * 1000 + a;
+}
+
+// --- Shaping proxy ---
+
+typedef struct {
+    bool used;
+    int dir;                   // 0 client -> server, 1 server -> client
+    uint64_t due_us;
+    uint64_t order;            // Arrival order, breaks ties
+    size_t len;
+    unsigned char data[PROXY_CHUNK];
+} ProxySlot;
+
+typedef struct {
+    bool udp;
+    int server_port;
+    int listen_fd;             // TCP: accepting socket; UDP: the client-facing socket
+    int delay_ms, jitter_ms;
+    double loss;               // 0..1, UDP only
+    uint64_t rng;
+    atomic_bool stop;
+    unsigned long forwarded, dropped, overflow;
+    int queued;                // Slots in use
+    uint64_t order;
+    uint64_t last_due[2];      // TCP: a direction's chunks leave in order
+    ProxySlot slots[PROXY_SLOTS];
+} Proxy;
+
+static void proxy_queue(Proxy *p, int dir, const unsigned char *data, size_t len) {
+    if (p->udp && p->loss > 0 && next_rand(&p->rng) < p->loss * 4294967296.0) {
+        p->dropped++;
+        return;
+    }
+
+    int64_t delay_us = p->delay_ms * 1000LL;
+    if (p->jitter_ms > 0) {
+        delay_us += (int64_t)(next_rand(&p->rng) % (uint32_t)(2 * p->jitter_ms * 1000 + 1)) - p->jitter_ms * 1000LL;
+    }
+    if (delay_us < 0) delay_us = 0;
+    uint64_t due = lat_now_us() + (uint64_t)delay_us;
+    if (!p->udp) {
+        // Jitter may not reorder a byte stream
+        if (due < p->last_due[dir]) due = p->last_due[dir];
+        p->last_due[dir] = due;
+    }
+
+    for (int i = 0; i < PROXY_SLOTS; i++) {
+        ProxySlot *s = &p->slots[i];
+        if (s->used) continue;
+        s->used = true;
+        s->dir = dir;
+        s->due_us = due;
+        s->order = p->order++;
+        s->len = len;
+        memcpy(s->data, data, len);
+        p->queued++;
+        return;
+    }
+    p->overflow++;   // UDP only: a TCP proxy stops reading before this
+}
+
+static void send_all(int fd, const unsigned char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+// Send everything that is due, oldest first. Returns us until the next one
+// is due (-1 when nothing is queued).
+static int64_t proxy_release(Proxy *p, int down, int up, const struct sockaddr_in *client_addr) {
+    for (;;) {
+        uint64_t now = lat_now_us();
+        ProxySlot *next = NULL;
+        for (int i = 0; i < PROXY_SLOTS; i++) {
+            ProxySlot *s = &p->slots[i];
+            if (!s->used) continue;
+            if (next == NULL || s->due_us < next->due_us ||
+                (s->due_us == next->due_us && s->order < next->order)) {
+                next = s;
+            }
+        }
+        if (next == NULL) return -1;
+        if (next->due_us > now) return (int64_t)(next->due_us - now);
+
+        if (next->dir == 0) {
+            if (up >= 0) send_all(up, next->data, next->len);
+        } else if (p->udp) {
+            sendto(down, next->data, next->len, MSG_DONTWAIT,
+                   (const struct sockaddr *)client_addr, sizeof(*client_addr));
+        } else if (down >= 0) {
+            send_all(down, next->data, next->len);
+        }
+        next->used = false;
+        p->queued--;
+        p->forwarded++;
+    }
+}
+
+static int connect_server(bool udp, int port) {
+    int fd = socket(AF_INET, udp ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    if (!udp) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+static void* proxy_main(void *arg) {
+    Proxy *p = arg;
+    int down = p->udp ? p->listen_fd : -1;    // Towards the client
+    int up = p->udp ? connect_server(true, p->server_port) : -1;
+    struct sockaddr_in client_addr;
+    memset(&client_addr, 0, sizeof(client_addr));
+    unsigned char buf[PROXY_CHUNK];
+
+    while (!atomic_load(&p->stop)) {
+        int64_t wait_us = proxy_release(p, down, up, &client_addr);
+        int timeout_ms = (wait_us < 0 || wait_us > 50000) ? 50 : (int)((wait_us + 999) / 1000);
+
+        // TCP with every slot taken: leave the bytes in the sockets until a
+        // chunk goes out, so the kernel pushes back on the sender
+        bool hold = !p->udp && down >= 0 && p->queued >= PROXY_SLOTS;
+        short events = hold ? 0 : POLLIN;
+
+        struct pollfd fds[2];
+        int nfds = 0;
+        fds[nfds++] = (struct pollfd){ (down >= 0) ? down : p->listen_fd, events, 0 };
+        if (up >= 0) fds[nfds++] = (struct pollfd){ up, events, 0 };
+        if (poll(fds, nfds, timeout_ms) <= 0 || hold) continue;
+
+        if (down < 0) {
+            // TCP client arrived: open our own connection to the server for it
+            down = accept(p->listen_fd, NULL, NULL);
+            if (down < 0) continue;
+            int one = 1;
+            setsockopt(down, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            up = connect_server(false, p->server_port);
+            if (up < 0) {
+                close(down);
+                down = -1;
+            }
+            continue;
+        }
+
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            socklen_t addrlen = sizeof(client_addr);
+            ssize_t n = p->udp ? recvfrom(down, buf, sizeof(buf), 0, (struct sockaddr *)&client_addr, &addrlen)
+                               : recv(down, buf, sizeof(buf), 0);
+            if (n > 0) {
+                proxy_queue(p, 0, buf, (size_t)n);
+            } else if (!p->udp && n == 0) {
+                break;
+            }
+        }
+        // The read above may have taken the last slot
+        hold = !p->udp && p->queued >= PROXY_SLOTS;
+        if (nfds > 1 && !hold && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t n = recv(up, buf, sizeof(buf), 0);
+            if (n > 0) {
+                proxy_queue(p, 1, buf, (size_t)n);
+            } else if (!p->udp && n == 0) {
+                break;
+            }
+        }
+    }
+
+    if (!p->udp && down >= 0) close(down);
+    if (up >= 0) close(up);
+    return NULL;
+}
+
+// --- Benchmark ---
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [--rate hz] [--duration s] [--port p] [--stream 0|1] [--udp 0|1]\n"
+            "          [--delay ms] [--jitter ms] [--loss %%] [--seed n] [--csv file.csv]\n"
+            "       %s --check\n", prog, prog);
+}
+
+// --- Datagram checks ---
+
+// Send len bytes of a DELTA datagram (header, base seq 0, zero bitstream)
+// and report what udp_recv() makes of it: 1 decoded, 0 dropped
+static int check_delta(int tx, int rx, size_t len, UdpMessage *msg, unsigned long *bad) {
+    static unsigned char buf[UDP_MAX_DATAGRAM + 64];
+    memset(buf, 0, sizeof(buf));
+    buf[0] = UDP_MAGIC;
+    buf[1] = UDP_VERSION;
+    buf[2] = UDP_DELTA;
+    buf[7] = 1;   // seq 1
+    if (send(tx, buf, len, 0) != (ssize_t)len) return -1;
+
+    struct pollfd pfd = { rx, POLLIN, 0 };
+    if (poll(&pfd, 1, 1000) <= 0) return -1;
+    return udp_recv(rx, msg, NULL, bad);
+}
+
+// A DELTA whose bitstream fills UdpMessage.delta exactly is accepted; one
+// byte more, or a datagram far over the limit, is counted as malformed
+static bool check_datagrams(void) {
+    int rx = socket(AF_INET, SOCK_DGRAM, 0);
+    int tx = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (rx < 0 || tx < 0 || bind(rx, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(rx, (struct sockaddr *)&addr, &addrlen) < 0 ||
+        connect(tx, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("net_bench: loopback sockets");
+        return false;
+    }
+
+    static UdpMessage msg;
+    unsigned long bad = 0;
+    bool ok = true;
+    int r = check_delta(tx, rx, UDP_MAX_DATAGRAM, &msg, &bad);
+    bool pass = (r == 1 && msg.type == UDP_DELTA && msg.delta_len == UDP_MAX_DELTA && bad == 0);
+    printf("check delta  %4d bytes: %s\n", UDP_MAX_DATAGRAM, pass ? "accepted, ok" : "FAILED");
+    ok = ok && pass;
+
+    size_t oversized[] = { UDP_MAX_DATAGRAM + 1, UDP_MAX_DATAGRAM + 64 };
+    for (size_t i = 0; i < sizeof(oversized) / sizeof(oversized[0]); i++) {
+        unsigned long before = bad;
+        r = check_delta(tx, rx, oversized[i], &msg, &bad);
+        pass = (r == 0 && bad == before + 1);
+        printf("check delta  %4zu bytes: %s\n", oversized[i], pass ? "dropped as malformed, ok" : "FAILED");
+        ok = ok && pass;
+    }
+    close(rx);
+    close(tx);
+    return ok;
+}
+
+// --- Delta codec checks ---
+
+// A base world and the next one: ids with gaps, some drones moved (a few a
+// long way), some removed, some added, coordinates on both sides of 0
+static void random_worlds(uint64_t *rng, DeltaWorld *base, DeltaWorld *cur) {
+    delta_world_clear(base);
+    delta_world_clear(cur);
+    int id = (int)(next_rand(rng) % 4);
+    for (int i = 0; i < 2 * DELTA_MAX_ENTITIES; i++, id += 1 + (int)(next_rand(rng) % 3)) {
+        uint32_t r = next_rand(rng);
+        float x = (float)(next_rand(rng) % 4000) / 10.0f - 100.0f;
+        float y = (float)(next_rand(rng) % 1600) / 10.0f - 40.0f;
+        if (r & 1) delta_world_add(base, id, x, y);
+        if (r & 2) {
+            if (r & 4) x += (float)((int)(next_rand(rng) % 61) - 30) / 10.0f;
+            if ((r & 0xf0) == 0) x = -x * 1000.0f;
+            delta_world_add(cur, id, x, y);
+        }
+    }
+}
+
+static bool same_world(const DeltaWorld *a, const DeltaWorld *b) {
+    if (a->count != b->count) return false;
+    for (int i = 0; i < a->count; i++) {
+        if (a->e[i].id != b->e[i].id || a->e[i].x != b->e[i].x || a->e[i].y != b->e[i].y) return false;
+    }
+    return true;
+}
+
+// True when the delta from base to cur moves or removes a drone of base
+static bool refers_to_base(const DeltaWorld *base, const DeltaWorld *cur) {
+    int j = 0;
+    for (int k = 0; k < base->count; k++) {
+        while (j < cur->count && cur->e[j].id < base->e[k].id) j++;
+        if (j == cur->count || cur->e[j].id != base->e[k].id) return true;
+        if (cur->e[j].x != base->e[k].x || cur->e[j].y != base->e[k].y) return true;
+    }
+    return false;
+}
+
+// Encode against a base or against nothing (a full world): every decode
+// must give the world back, and every shorter prefix, every delta decoded
+// without the base it refers to and every int32 overflow must be refused.
+// Garbage must decode to a sane world or not at all.
+static bool check_codec(void) {
+    static DeltaWorld base, cur, out;
+    static DeltaRing ring;
+    uint8_t buf[UDP_MAX_DELTA];
+    uint64_t rng = 1;
+    bool ok = true;
+
+    unsigned long trips = 0, failed = 0, prefixes = 0, wrong_base = 0;
+    for (int i = 0; i < CODEC_RUNS; i++) {
+        random_worlds(&rng, &base, &cur);
+        const DeltaWorld *b = (i % 4 == 0) ? NULL : &base;
+        int n = delta_encode(b, &cur, buf, sizeof(buf));
+        trips++;
+        if (n <= 0 || !delta_decode(b, buf, (size_t)n, &out) || !same_world(&out, &cur)) {
+            failed++;
+            continue;
+        }
+        if (i % 16 == 0) {
+            for (int len = 0; len < n; len++) {
+                prefixes++;
+                if (delta_decode(b, buf, (size_t)len, &out)) failed++;
+            }
+        }
+        // A client whose ring lost the base decodes against nothing
+        if (b != NULL && refers_to_base(&base, &cur)) {
+            wrong_base++;
+            if (delta_decode(NULL, buf, (size_t)n, &out)) failed++;
+        }
+    }
+    printf("check codec  %lu round trips, %lu truncated, %lu without their base: %s\n",
+           trips, prefixes, wrong_base, failed ? "FAILED" : "ok");
+    ok = ok && failed == 0;
+
+    // Bit flips and random bytes: refused, or a world with ascending ids
+    unsigned long accepted = 0;
+    failed = 0;
+    for (int i = 0; i < CODEC_RUNS; i++) {
+        random_worlds(&rng, &base, &cur);
+        size_t len = next_rand(&rng) % 64;
+        if (i % 2 == 0) {
+            int n = delta_encode(&base, &cur, buf, sizeof(buf));
+            len = (size_t)n;
+            buf[next_rand(&rng) % len] ^= (uint8_t)(1u << (next_rand(&rng) % 8));
+        } else {
+            for (size_t k = 0; k < len; k++) buf[k] = (uint8_t)next_rand(&rng);
+        }
+        if (!delta_decode(&base, buf, len, &out)) continue;
+        accepted++;
+        if (out.count > DELTA_MAX_ENTITIES) failed++;
+        for (int k = 1; k < out.count; k++) {
+            if (out.e[k].id <= out.e[k - 1].id) failed++;
+        }
+    }
+    printf("check codec  %d corrupted inputs, %lu decoded to a valid world: %s\n",
+           CODEC_RUNS, accepted, failed ? "FAILED" : "ok");
+    ok = ok && failed == 0;
+
+    // A move that would carry x or y past the int32 range
+    DeltaWorld from, to;
+    delta_world_clear(&from);
+    delta_world_clear(&to);
+    delta_world_add(&from, 7, 0.0f, 0.0f);
+    delta_world_add(&to, 7, 100.0f, -100.0f);
+    int n = delta_encode(&from, &to, buf, sizeof(buf));
+    bool pass = n > 0;
+    from.e[0].x = INT32_MAX - 5;
+    pass = pass && !delta_decode(&from, buf, (size_t)n, &out);
+    from.e[0].x = 0;
+    from.e[0].y = INT32_MIN + 5;
+    pass = pass && !delta_decode(&from, buf, (size_t)n, &out);
+    from.e[0].x = INT32_MAX - 1000;
+    from.e[0].y = INT32_MIN + 1000;
+    pass = pass && delta_decode(&from, buf, (size_t)n, &out) &&
+           out.e[0].x == INT32_MAX && out.e[0].y == INT32_MIN;
+    // Positions far outside any window, or not numbers, are clamped
+    delta_world_clear(&to);
+    delta_world_add(&to, 1, 1e30f, NAN);
+    pass = pass && to.e[0].x == (int32_t)(DELTA_COORD_MAX * DELTA_QUANT) &&
+           to.e[0].y == -(int32_t)(DELTA_COORD_MAX * DELTA_QUANT);
+    printf("check codec  coordinates at the int32 limits: %s\n", pass ? "refused past them, ok" : "FAILED");
+    ok = ok && pass;
+
+    // The ring only finds what it still holds
+    delta_ring_init(&ring);
+    for (uint32_t seq = 1; seq <= DELTA_RING + 3; seq++) delta_ring_slot(&ring, seq)->count = (int)seq;
+    pass = delta_ring_find(&ring, 0) == NULL &&
+           delta_ring_find(&ring, DELTA_RING + 10) == NULL;
+    for (uint32_t seq = 1; seq <= DELTA_RING + 3; seq++) {
+        const DeltaWorld *w = delta_ring_find(&ring, seq);
+        if (seq <= 3) pass = pass && w == NULL;
+        else pass = pass && w != NULL && w->seq == seq && w->count == (int)seq;
+    }
+    printf("check codec  base not in the ring: %s\n", pass ? "not found, ok" : "FAILED");
+    ok = ok && pass;
+    return ok;
+}
+
+// --- Transform checks ---
+
+// For each window pair and angle, a snapshot converted in one batch must
+// match the single-point path and the formula virtual = R(alfa) * S * local
+// + (x0, y0) worked out in double; the inverse, batched or not, must give
+// the local points back
+static bool check_transform(void) {
+    const int windows[][4] = {
+        { 120, 40, 120, 40 },     // Same window, no scaling
+        { 80, 30, 120, 40 },      // Smaller client
+        { 200, 60, 120, 40 },     // Larger client
+        { 0, 0, 120, 40 },        // Size unknown: no scaling
+    };
+    const float angles[] = { 0.0f, 0.3f, (float)M_PI_2, (float)M_PI, -2.0f };
+    const float x0 = 5.0f, y0 = -3.0f;
+    float x[XFORM_POINTS], y[XFORM_POINTS];
+    float vx[XFORM_POINTS], vy[XFORM_POINTS], lx[XFORM_POINTS], ly[XFORM_POINTS];
+    uint64_t rng = 7;
+    int cases = 0, failed = 0;
+
+    for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+        const int *win = windows[w];
+        double sx = (win[0] > 0) ? (double)win[2] / win[0] : 1.0;
+        double sy = (win[1] > 0) ? (double)win[3] / win[1] : 1.0;
+        for (size_t k = 0; k < sizeof(angles) / sizeof(angles[0]); k++) {
+            CoordTransform t;
+            transform_init(&t, win[0], win[1], win[2], win[3], x0, y0, angles[k]);
+            for (int i = 0; i < XFORM_POINTS; i++) {
+                x[i] = (float)(next_rand(&rng) % 2000) / 10.0f;
+                y[i] = (float)(next_rand(&rng) % 600) / 10.0f;
+            }
+            transform_batch(&t.to_virtual, XFORM_POINTS, x, y, vx, vy);
+            transform_batch(&t.to_local, XFORM_POINTS, vx, vy, lx, ly);
+
+            double cs = cos(angles[k]), sn = sin(angles[k]);
+            bool pass = true;
+            for (int i = 0; i < XFORM_POINTS; i++) {
+                double ex = cs * sx * x[i] - sn * sy * y[i] + x0;
+                double ey = sn * sx * x[i] + cs * sy * y[i] + y0;
+                Coord v = local_to_virtual(&t, (Coord){ x[i], y[i] });
+                Coord l = virtual_to_local(&t, v);
+                pass = pass &&
+                       fabs(vx[i] - ex) <= XFORM_TOL && fabs(vy[i] - ey) <= XFORM_TOL &&
+                       fabsf(v.x - vx[i]) <= XFORM_TOL && fabsf(v.y - vy[i]) <= XFORM_TOL &&
+                       fabsf(lx[i] - x[i]) <= XFORM_TOL && fabsf(ly[i] - y[i]) <= XFORM_TOL &&
+                       fabsf(l.x - x[i]) <= XFORM_TOL && fabsf(l.y - y[i]) <= XFORM_TOL;
+            }
+            cases++;
+            if (!pass) {
+                failed++;
+                printf("check xform  %dx%d -> %dx%d at %.2f rad: FAILED\n",
+                       win[0], win[1], win[2], win[3], angles[k]);
+            }
+        }
+    }
+    printf("check xform  %d window/angle pairs, %d points each, batch = point = formula, inverse: %s\n",
+           cases, XFORM_POINTS, failed ? "FAILED" : "ok");
+    return failed == 0;
+}
+
+// Bound (and for TCP listening) socket on 127.0.0.1:port
+static int open_listener(bool udp, int port) {
+    int fd = socket(AF_INET, udp ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        (!udp && listen(fd, SOMAXCONN) < 0)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Pipe with both ends non-blocking, like main.c's communication pipes
+static int open_pipe(int fds[2]) {
+    if (pipe(fds) < 0) return -1;
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    return 0;
+}
+
+// fork + exec with stdout silenced; keep lists the fds the child needs
+static pid_t spawn(char *const argv[], const int *keep, int n_keep, const int *all, int n_all) {
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    for (int i = 0; i < n_all; i++) {
+        bool needed = false;
+        for (int k = 0; k < n_keep; k++) needed |= (all[i] == keep[k]);
+        if (!needed) close(all[i]);
+    }
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+    execv(argv[0], argv);
+    perror("exec failed");
+    _exit(RUNTIME_ERROR);
+}
+
+static double cpu_us(const struct rusage *ru) {
+    return (ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) * 1e6 + ru->ru_utime.tv_usec + ru->ru_stime.tv_usec;
+}
+
+static void stop_child(pid_t pid, struct rusage *ru) {
+    memset(ru, 0, sizeof(*ru));
+    if (pid <= 0) return;
+    kill(pid, SIGTERM);
+    for (int i = 0; i < 500; i++) {
+        int status;
+        pid_t r = wait4(pid, &status, WNOHANG, ru);
+        if (r == pid || (r < 0 && errno != EINTR)) return;
+        usleep(10000);
+    }
+    kill(pid, SIGKILL);
+    wait4(pid, NULL, 0, ru);
+}
+
+// Read every frame waiting on a Communication process's "BlackBoard" pipe
+// and hand each remote drone position to on_remote. Returns false at EOF.
+static bool drain_frames(FrameReader *r, void (*on_remote)(const FrameRemote *, uint64_t)) {
+    Frame frame;
+    for (;;) {
+        int n = frame_fill(r);
+        if (n == -2) return true;
+        if (n == 0 || n == -1) return false;
+        uint64_t now = lat_now_us();
+        while (frame_next(r, &frame)) {
+            if (frame.hdr.type == FRAME_REMOTE) on_remote(&frame.u.remote, now);
+        }
+    }
+}
+
+// Per sequence number: when it was sent and how far it got
+static uint64_t t_sent[SEQ_RING];
+static uint8_t reached[SEQ_RING];           // 1 = client, 2 = back at the server
+static LatencyHist lat_s2c, lat_rtt;
+static unsigned long at_client = 0, round_trips = 0;
+static FrameWriter client_in;               // Our stand-in for the client's BlackBoard
+static bool server_joined = false;          // The client's drone reached the server
+
+// Client side: the server drone (id 0) arrived, echo it as our own drone
+static void on_client_remote(const FrameRemote *r, uint64_t now) {
+    if (r->id != 0) return;
+    long s = pos_to_seq(r->x, r->y);
+    if (s < 0 || t_sent[s] == 0 || reached[s] != 0) return;
+    reached[s] = 1;
+    lat_record(&lat_s2c, now - t_sent[s]);
+    at_client++;
+    frame_send_position(&client_in, r->x, r->y, 0);
+}
+
+// Server side: a client's drone arrived
+static void on_server_remote(const FrameRemote *r, uint64_t now) {
+    if (r->id < 1) return;
+    server_joined = true;
+    long s = pos_to_seq(r->x, r->y);
+    if (s < 0 || reached[s] != 1) return;
+    reached[s] = 2;
+    lat_record(&lat_rtt, now - t_sent[s]);
+    round_trips++;
+}
+
+static void print_hist(const char *label, const LatencyHist *h) {
+    if (h->count == 0) {
+        printf("%-16s no samples\n", label);
+        return;
+    }
+    printf("%-16s p50=%lluus p90=%lluus p99=%lluus p99.9=%lluus max=%lluus mean=%.0fus\n", label,
+           (unsigned long long)lat_percentile(h, 0.50), (unsigned long long)lat_percentile(h, 0.90),
+           (unsigned long long)lat_percentile(h, 0.99), (unsigned long long)lat_percentile(h, 0.999),
+           (unsigned long long)h->max_us, (double)h->sum_us / h->count);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        bool ok = check_datagrams();
+        ok = check_codec() && ok;
+        ok = check_transform() && ok;
+        return ok ? 0 : RUNTIME_ERROR;
+    }
+    Parameter_File();
+
+    double rate = 50;
+    double duration = 10;
+    int port = 5600;
+    int delay_ms = 0, jitter_ms = 0;
+    double loss_pct = 0;
+    unsigned seed = 1;
+    const char *csv_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        bool ok = (val != NULL);
+        if (ok && strcmp(opt, "--rate") == 0) ok = (rate = atof(val)) > 0 && rate <= 100000;
+        else if (ok && strcmp(opt, "--duration") == 0) ok = (duration = atof(val)) > 0;
+        else if (ok && strcmp(opt, "--port") == 0) ok = (port = atoi(val)) > 0 && port < 65535;
+        else if (ok && strcmp(opt, "--stream") == 0) net_stream = atoi(val);
+        else if (ok && strcmp(opt, "--udp") == 0) net_udp = atoi(val);
+        else if (ok && strcmp(opt, "--delay") == 0) ok = (delay_ms = atoi(val)) >= 0;
+        else if (ok && strcmp(opt, "--jitter") == 0) ok = (jitter_ms = atoi(val)) >= 0;
+        else if (ok && strcmp(opt, "--loss") == 0) ok = (loss_pct = atof(val)) >= 0 && loss_pct <= 100;
+        else if (ok && strcmp(opt, "--seed") == 0) seed = (unsigned)atoi(val);
+        else if (ok && strcmp(opt, "--csv") == 0) csv_path = val;
+        else ok = false;
+        if (!ok) {
+            usage(argv[0]);
+            return USAGE_ERROR;
+        }
+        i++;
+    }
+    bool udp = (net_udp == 1);
+    bool shaping = delay_ms > 0 || jitter_ms > 0 || loss_pct > 0;
+    if (shaping && !udp && loss_pct > 0) {
+        fprintf(stderr, "net_bench: --loss only applies to UDP, ignored over TCP\n");
+        loss_pct = 0;
+    }
+    const char *protocol = udp ? "udp" : (net_stream == 1 ? "tcp-stream" : "tcp-lockstep");
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (registry_create() == NULL) {
+        fprintf(stderr, "net_bench: failed to create the process registry\n");
+        return RUNTIME_ERROR;
+    }
+
+    // Server FromBB/ToBB and client FromBB/ToBB, as main.c creates them
+    int srv_from[2], srv_to[2], cli_from[2], cli_to[2];
+    int listen_fd = open_listener(udp, port);
+    if (listen_fd < 0) {
+        perror("net_bench: cannot bind the server port");
+        registry_unlink();
+        return RUNTIME_ERROR;
+    }
+    if (open_pipe(srv_from) < 0 || open_pipe(srv_to) < 0 || open_pipe(cli_from) < 0 || open_pipe(cli_to) < 0) {
+        perror("net_bench: pipe");
+        registry_unlink();
+        return RUNTIME_ERROR;
+    }
+
+    static Proxy proxy;
+    pthread_t proxy_thread;
+    int client_port = port;
+    if (shaping) {
+        proxy.udp = udp;
+        proxy.server_port = port;
+        proxy.delay_ms = delay_ms;
+        proxy.jitter_ms = jitter_ms;
+        proxy.loss = loss_pct / 100.0;
+        proxy.rng = seed;
+        client_port = port + 1;
+        proxy.listen_fd = open_listener(udp, client_port);
+        if (proxy.listen_fd < 0 || pthread_create(&proxy_thread, NULL, proxy_main, &proxy) != 0) {
+            perror("net_bench: cannot start the shaping proxy");
+            registry_unlink();
+            return RUNTIME_ERROR;
+        }
+    }
+
+    int all_fds[] = { listen_fd, srv_from[0], srv_from[1], srv_to[0], srv_to[1],
+                      cli_from[0], cli_from[1], cli_to[0], cli_to[1], shaping ? proxy.listen_fd : -1 };
+    int n_all = shaping ? 10 : 9;
+    char a_sock[16], a_from[16], a_to[16], a_w[16], a_h[16], a_stream[16], a_udp[16], a_port[16];
+    snprintf(a_stream, sizeof(a_stream), "%d", net_stream);
+    snprintf(a_udp, sizeof(a_udp), "%d", net_udp);
+
+    // Server: sockfd FromBB ToBB width height stream udp
+    snprintf(a_sock, sizeof(a_sock), "%d", listen_fd);
+    snprintf(a_from, sizeof(a_from), "%d", srv_from[0]);
+    snprintf(a_to, sizeof(a_to), "%d", srv_to[1]);
+    snprintf(a_w, sizeof(a_w), "%d", window_width);
+    snprintf(a_h, sizeof(a_h), "%d", window_height);
+    char *srv_argv[] = { "./Communication_Server", a_sock, a_from, a_to, a_w, a_h, a_stream, a_udp, NULL };
+    int srv_keep[] = { listen_fd, srv_from[0], srv_to[1] };
+    pid_t server = spawn(srv_argv, srv_keep, 3, all_fds, n_all);
+
+    // Client: host port FromBB ToBB stream udp
+    char c_from[16], c_to[16];
+    snprintf(a_port, sizeof(a_port), "%d", client_port);
+    snprintf(c_from, sizeof(c_from), "%d", cli_from[0]);
+    snprintf(c_to, sizeof(c_to), "%d", cli_to[1]);
+    char *cli_argv[] = { "./Communication_Client", "127.0.0.1", a_port, c_from, c_to, a_stream, a_udp, NULL };
+    int cli_keep[] = { cli_from[0], cli_to[1] };
+    pid_t client = spawn(cli_argv, cli_keep, 2, all_fds, n_all);
+
+    if (server < 0 || client < 0) {
+        perror("net_bench: fork");
+        stop = 1;
+    }
+    close(listen_fd);
+    close(srv_from[0]);
+    close(srv_to[1]);
+    close(cli_from[0]);
+    close(cli_to[1]);
+
+    FrameWriter server_in;
+    frame_writer_init(&server_in, srv_from[1]);
+    frame_writer_init(&client_in, cli_from[1]);
+    FrameReader server_out, client_out;
+    frame_reader_init(&server_out, srv_to[0]);
+    frame_reader_init(&client_out, cli_to[0]);
+    lat_init(&lat_s2c, "server->client");
+    lat_init(&lat_rtt, "round trip");
+
+    printf("net_bench: %s, %.0f Hz for %.0f s", protocol, rate, duration);
+    if (shaping) printf(", proxy delay %d+-%d ms, loss %.1f%%", delay_ms, jitter_ms, loss_pct);
+    printf("\n");
+
+    // Wait for the client's drone to show up at the server
+    uint64_t t_join = lat_now_us();
+    while (!stop && !server_joined) {
+        if (lat_now_us() - t_join > JOIN_MS * 1000ULL) {
+            fprintf(stderr, "net_bench: the client did not join within %d ms\n", JOIN_MS);
+            stop = 1;
+            break;
+        }
+        struct pollfd pfd = { srv_to[0], POLLIN, 0 };
+        if (poll(&pfd, 1, 50) > 0 && !drain_frames(&server_out, on_server_remote)) stop = 1;
+        if (client_out.conn.fd >= 0) drain_frames(&client_out, on_client_remote);
+    }
+    bool joined = !stop;
+
+    // Measured run
+    uint64_t period_us = (uint64_t)(1e6 / rate);
+    if (period_us == 0) period_us = 1;
+    uint64_t t_start = lat_now_us();
+    uint64_t t_end = t_start + (uint64_t)(duration * 1e6);
+    uint64_t next_send = t_start;
+    uint32_t seq = 0;
+    unsigned long sent = 0;
+
+    while (!stop) {
+        uint64_t now = lat_now_us();
+        if (now < t_end) {
+            while (next_send <= now) {
+                seq = (seq + 1) % SEQ_RING;
+                t_sent[seq] = now;
+                reached[seq] = 0;
+                float x, y;
+                seq_to_pos(seq, &x, &y);
+                frame_send_position(&server_in, x, y, 0);
+                sent++;
+                next_send += period_us;
+            }
+        } else if (now >= t_end + DRAIN_MS * 1000ULL) {
+            break;
+        }
+
+        uint64_t wake = (now < t_end) ? next_send : t_end + DRAIN_MS * 1000ULL;
+        int timeout_ms = (wake > now) ? (int)((wake - now + 999) / 1000) : 0;
+        struct pollfd fds[2] = { { srv_to[0], POLLIN, 0 }, { cli_to[0], POLLIN, 0 } };
+        if (poll(fds, 2, timeout_ms) < 0 && errno != EINTR) break;
+        if ((fds[1].revents && !drain_frames(&client_out, on_client_remote)) ||
+            (fds[0].revents && !drain_frames(&server_out, on_server_remote))) {
+            fprintf(stderr, "net_bench: a Communication process closed its pipe\n");
+            break;
+        }
+    }
+    double elapsed = (lat_now_us() - t_start) / 1e6;
+    bool interrupted = stop;
+
+    // Client first, so the server does not send it a quit that it would
+    // pass on to us as SIGTERM
+    struct rusage ru_client, ru_server;
+    stop_child(client, &ru_client);
+    stop_child(server, &ru_server);
+    if (shaping) {
+        atomic_store(&proxy.stop, true);
+        pthread_join(proxy_thread, NULL);
+        close(proxy.listen_fd);
+    }
+    registry_unlink();
+
+    if (!joined) return RUNTIME_ERROR;
+
+    double run_s = duration < elapsed ? duration : elapsed;
+    double client_rate = at_client / run_s;
+    double rtt_rate = round_trips / run_s;
+    double srv_cpu = round_trips ? cpu_us(&ru_server) / round_trips : 0;
+    double cli_cpu = round_trips ? cpu_us(&ru_client) / round_trips : 0;
+
+    printf("sent %lu positions: %lu reached the client (%lu coalesced), %lu came back\n",
+           sent, at_client, sent - at_client, round_trips);
+    printf("updates/s        %.1f at the client, %.1f round trips\n", client_rate, rtt_rate);
+    print_hist("server->client", &lat_s2c);
+    print_hist("round trip", &lat_rtt);
+    printf("CPU per update   server %.1fus, client %.1fus (%.0f ms / %.0f ms in total)\n",
+           srv_cpu, cli_cpu, cpu_us(&ru_server) / 1000, cpu_us(&ru_client) / 1000);
+    if (shaping) {
+        printf("proxy            %lu forwarded, %lu dropped, %lu over capacity\n",
+               proxy.forwarded, proxy.dropped, proxy.overflow);
+    }
+    if (server_in.failed || client_in.failed) {
+        printf("pipe writes lost: %lu to the server, %lu to the client\n", server_in.failed, client_in.failed);
+    }
+
+    if (csv_path != NULL) {
+        struct stat st;
+        bool fresh = stat(csv_path, &st) != 0 || st.st_size == 0;
+        FILE *out = fopen(csv_path, "a");
+        if (out == NULL) {
+            perror("Failed to open CSV output");
+            return RUNTIME_ERROR;
+        }
+        if (fresh) {
+            fprintf(out, "protocol,rate_hz,duration_s,delay_ms,jitter_ms,loss_pct,sent,at_client,round_trips,"
+                         "client_updates_per_s,round_trips_per_s,s2c_p50_us,s2c_p99_us,"
+                         "rtt_p50_us,rtt_p90_us,rtt_p99_us,rtt_max_us,server_cpu_us,client_cpu_us\n");
+        }
+        fprintf(out, "%s,%g,%g,%d,%d,%g,%lu,%lu,%lu,%.1f,%.1f,%llu,%llu,%llu,%llu,%llu,%llu,%.1f,%.1f\n",
+                protocol, rate, duration, delay_ms, jitter_ms, loss_pct, sent, at_client, round_trips,
+                client_rate, rtt_rate,
+                (unsigned long long)lat_percentile(&lat_s2c, 0.50), (unsigned long long)lat_percentile(&lat_s2c, 0.99),
+                (unsigned long long)lat_percentile(&lat_rtt, 0.50), (unsigned long long)lat_percentile(&lat_rtt, 0.90),
+                (unsigned long long)lat_percentile(&lat_rtt, 0.99), (unsigned long long)lat_rtt.max_us,
+                srv_cpu, cli_cpu);
+        fclose(out);
+    }
+    return interrupted ? RUNTIME_ERROR : 0;
+}
@@ -0,0 +1,234 @@
+#include <math.h>
+#include <stdlib.h>
+#include "net_delta.h"
+
+enum { OP_MOVED, OP_ADDED, OP_REMOVED };
+
+// --- Bit packing, most significant bit first ---
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t bits;
+    bool overflow;
+} BitWriter;
+
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t bits;
+    bool underrun;
+} BitReader;
+
+static void put_bits(BitWriter *w, uint32_t v, int n) {
+    for (int i = n - 1; i >= 0; i--) {
+        size_t byte = w->bits >> 3;
+        if (byte >= w->cap) {
+            w->overflow = true;
+            return;
+        }
+        if ((w->bits & 7) == 0) w->buf[byte] = 0;
+        if ((v >> i) & 1) w->buf[byte] |= (uint8_t)(0x80 >> (w->bits & 7));
+        w->bits++;
+    }
+}
+
+static uint32_t get_bits(BitReader *r, int n) {
+    uint32_t v = 0;
+    for (int i = 0; i < n; i++) {
+        size_t byte = r->bits >> 3;
+        if (byte >= r->len) {
+            r->underrun = true;
+            return 0;
+        }
+        v = (v << 1) | ((r->buf[byte] >> (7 - (r->bits & 7))) & 1);
+        r->bits++;
+    }
+    return v;
+}
+
+static void put_varint(BitWriter *w, uint32_t v) {
+    do {
+        uint32_t group = v & 15;
+        v >>= 4;
+        put_bits(w, group | (v ? 16 : 0), 5);
+    } while (v != 0 && !w->overflow);
+}
+
+static uint32_t get_varint(BitReader *r) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 32; shift += 4) {
+        uint32_t group = get_bits(r, 5);
+        v |= (group & 15) << shift;
+        if (!(group & 16) || r->underrun) return v;
+    }
+    r->underrun = true;   // More than 32 bits: not ours
+    return 0;
+}
+
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// --- Worlds ---
+
+void delta_world_clear(DeltaWorld *w) {
+    w->seq = 0;
+    w->count = 0;
+}
+
+// Positions come from the peers: keep them where lroundf() is defined and
+// the encoder's differences fit in 32 bits
+static int32_t quantize(float v) {
+    if (!(v >= -DELTA_COORD_MAX)) v = -DELTA_COORD_MAX;   // NaN too
+    if (v > DELTA_COORD_MAX) v = DELTA_COORD_MAX;
+    return (int32_t)lroundf(v * DELTA_QUANT);
+}
+
+bool delta_world_add(DeltaWorld *w, int id, float x, float y) {
+    if (w->count >= DELTA_MAX_ENTITIES) return false;
+    DeltaEntity *e = &w->e[w->count++];
+    e->id = id;
+    e->x = quantize(x);
+    e->y = quantize(y);
+    return true;
+}
+
+static int entity_cmp(const void *a, const void *b) {
+    const DeltaEntity *ea = a, *eb = b;
+    return (ea->id > eb->id) - (ea->id < eb->id);
+}
+
+void delta_world_sort(DeltaWorld *w) {
+    qsort(w->e, (size_t)w->count, sizeof(DeltaEntity), entity_cmp);
+}
+
+float delta_coord(int32_t q) {
+    return (float)q / DELTA_QUANT;
+}
+
+// Walk base and cur side by side. With w == NULL only count the changes,
+// otherwise write them.
+static int diff_worlds(const DeltaWorld *base, const DeltaWorld *cur, BitWriter *w) {
+    int bi = 0, be = (base != NULL) ? base->count : 0;
+    int ci = 0, ce = cur->count;
+    int changes = 0;
+    int64_t prev_id = -1;
+
+    while (bi < be || ci < ce) {
+        const DeltaEntity *b = (bi < be) ? &base->e[bi] : NULL;
+        const DeltaEntity *c = (ci < ce) ? &cur->e[ci] : NULL;
+        int op;
+        int32_t id, vx = 0, vy = 0;
+
+        if (c != NULL && (b == NULL || c->id < b->id)) {
+            op = OP_ADDED;
+            id = c->id;
+            vx = c->x;
+            vy = c->y;
+            ci++;
+        } else if (b != NULL && (c == NULL || b->id < c->id)) {
+            op = OP_REMOVED;
+            id = b->id;
+            bi++;
+        } else {
+            bi++;
+            ci++;
+            if (b->x == c->x && b->y == c->y) continue;   // Unchanged: nothing to send
+            op = OP_MOVED;
+            id = c->id;
+            vx = c->x - b->x;
+            vy = c->y - b->y;
+        }
+
+        changes++;
+        if (w == NULL) continue;
+        put_varint(w, (uint32_t)(id - prev_id - 1));
+        put_bits(w, (uint32_t)op, 2);
+        if (op != OP_REMOVED) {
+            put_varint(w, zigzag(vx));
+            put_varint(w, zigzag(vy));
+        }
+        prev_id = id;
+    }
+    return changes;
+}
+
+int delta_encode(const DeltaWorld *base, const DeltaWorld *cur, uint8_t *buf, size_t cap) {
+    BitWriter w = { buf, cap, 0, false };
+    put_varint(&w, (uint32_t)diff_worlds(base, cur, NULL));
+    diff_worlds(base, cur, &w);
+    if (w.overflow) return -1;
+    return (int)((w.bits + 7) >> 3);
+}
+
+bool delta_decode(const DeltaWorld *base, const uint8_t *buf, size_t len, DeltaWorld *out) {
+    BitReader r = { buf, len, 0, false };
+    int bi = 0, be = (base != NULL) ? base->count : 0;
+    uint32_t changes = get_varint(&r);
+    int64_t prev_id = -1;
+    out->count = 0;
+
+    for (uint32_t n = 0; n < changes && !r.underrun; n++) {
+        int64_t id = prev_id + 1 + get_varint(&r);
+        int op = (int)get_bits(&r, 2);
+        if (r.underrun || id > INT32_MAX) return false;
+        prev_id = id;
+
+        // Base entities before this id are unchanged
+        while (bi < be && base->e[bi].id < id) {
+            if (out->count >= DELTA_MAX_ENTITIES) return false;
+            out->e[out->count++] = base->e[bi++];
+        }
+        const DeltaEntity *b = (bi < be && base->e[bi].id == id) ? &base->e[bi] : NULL;
+
+        if (op == OP_REMOVED || op == OP_MOVED) {
+            if (b == NULL) return false;   // Delta against a world we do not have
+            bi++;
+            if (op == OP_REMOVED) continue;
+        } else if (op != OP_ADDED || b != NULL) {
+            return false;
+        }
+
+        // Added in 64 bits: a hostile dx could push x past INT32_MAX
+        int64_t x = unzigzag(get_varint(&r));
+        int64_t y = unzigzag(get_varint(&r));
+        if (op == OP_MOVED) {
+            x += b->x;
+            y += b->y;
+        }
+        if (x < INT32_MIN || x > INT32_MAX || y < INT32_MIN || y > INT32_MAX) return false;
+        if (out->count >= DELTA_MAX_ENTITIES) return false;
+        DeltaEntity *e = &out->e[out->count++];
+        e->id = (int32_t)id;
+        e->x = (int32_t)x;
+        e->y = (int32_t)y;
+    }
+    while (bi < be) {
+        if (out->count >= DELTA_MAX_ENTITIES) return false;
+        out->e[out->count++] = base->e[bi++];
+    }
+    return !r.underrun;
+}
+
+// --- Baseline ring ---
+
+void delta_ring_init(DeltaRing *r) {
+    for (int i = 0; i < DELTA_RING; i++) delta_world_clear(&r->worlds[i]);
+}
+
+DeltaWorld* delta_ring_slot(DeltaRing *r, uint32_t seq) {
+    DeltaWorld *w = &r->worlds[seq % DELTA_RING];
+    w->seq = seq;
+    return w;
+}
+
+const DeltaWorld* delta_ring_find(const DeltaRing *r, uint32_t seq) {
+    if (seq == 0) return NULL;
+    const DeltaWorld *w = &r->worlds[seq % DELTA_RING];
+    return (w->seq == seq) ? w : NULL;
+}
@@ -0,0 +1,69 @@
+// net_delta.h
+#ifndef NET_DELTA_H
+#define NET_DELTA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "net_stream.h"
+
+// Delta-compressed world snapshots for the UDP transport (net_udp.h)
+// A world is everything one client should see: the other drones, id 0 being
+// the server's (networked BlackBoards share no obstacles or targets).
+// Coordinates are quantized to 1/DELTA_QUANT of a virtual unit, the
+// precision of the text protocol, and the entities are kept sorted by id.
+// The server keeps the last DELTA_RING worlds it sent to each client. The
+// client acknowledges the newest world it decoded in every STATE datagram,
+// and the next snapshot only says how the world differs from that one:
+//     header:         number of changes                     varint
+//     per change:     id - previous id - 1                  varint
+//                     op: moved / added / removed           2 bits
+//                     moved: dx, dy / added: x, y           zigzag varints
+// Everything is bit-packed; a varint is 4-bit groups, each followed by a
+// continuation bit. An entity that did not change costs nothing, so the
+// size of a snapshot follows what moved, not how big the world is. Without
+// a usable baseline (the first snapshot, or the acknowledged world has left
+// the ring) the world is encoded against the empty one, i.e. in full.
+
+#define DELTA_QUANT        10        // Steps per virtual unit
+#define DELTA_COORD_MAX    1e6f      // Virtual units; farther positions are clamped
+#define DELTA_MAX_ENTITIES STREAM_MAX_ENTITIES
+#define DELTA_RING         16        // Worlds kept per peer: 320 ms at 50 Hz, past a keepalive
+
+typedef struct {
+    int32_t id;
+    int32_t x, y;                  // Quantized
+} DeltaEntity;
+
+typedef struct {
+    uint32_t seq;                  // 0 = empty slot / no baseline
+    int count;
+    DeltaEntity e[DELTA_MAX_ENTITIES];
+} DeltaWorld;
+
+// Worlds sent to (server) or decoded from (client) one peer
+typedef struct {
+    DeltaWorld worlds[DELTA_RING];
+} DeltaRing;
+
+void delta_world_clear(DeltaWorld *w);
+// Add an entity in virtual coordinates (clamped to +-DELTA_COORD_MAX);
+// false when the world is full. Call delta_world_sort() once everything is in.
+bool delta_world_add(DeltaWorld *w, int id, float x, float y);
+void delta_world_sort(DeltaWorld *w);
+float delta_coord(int32_t q);
+
+// Encode cur against base (NULL = the empty world). Returns the bytes
+// written, -1 if buf is too small.
+int delta_encode(const DeltaWorld *base, const DeltaWorld *cur, uint8_t *buf, size_t cap);
+// Apply a delta to base (NULL = the empty world). False if the data is
+// malformed or does not fit base.
+bool delta_decode(const DeltaWorld *base, const uint8_t *buf, size_t len, DeltaWorld *out);
+
+void delta_ring_init(DeltaRing *r);
+// The slot for seq, which it overwrites (seq stored, entities left to the caller)
+DeltaWorld* delta_ring_slot(DeltaRing *r, uint32_t seq);
+// The world stored under seq, NULL if it was never stored or was overwritten
+const DeltaWorld* delta_ring_find(const DeltaRing *r, uint32_t seq);
+
+#endif
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <time.h>
+#include "net_stream.h"
+
+uint64_t stream_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+int stream_format(char *buf, size_t size, const StreamFrame *f) {
+    return snprintf(buf, size, "st %u %llu %.1f, %.1f",
+                    f->seq, (unsigned long long)f->t_us, f->x, f->y);
+}
+
+bool stream_parse(const char *line, StreamFrame *f) {
+    unsigned long long t_us;
+    if (sscanf(line, "st %u %llu %f, %f", &f->seq, &t_us, &f->x, &f->y) != 4) {
+        return false;
+    }
+    f->t_us = t_us;
+    return true;
+}
+
+// Accept a sequence number only if it is newer than the last one (wraparound safe)
+bool stream_accept_seq(StreamRx *rx, uint32_t seq) {
+    if (rx->have && (int32_t)(seq - rx->last_seq) <= 0) {
+        rx->stale_dropped++;
+        return false;
+    }
+    rx->have = true;
+    rx->last_seq = seq;
+    rx->last_rx_us = stream_now_us();
+    rx->accepted++;
+    return true;
+}
+
+bool stream_accept(StreamRx *rx, const StreamFrame *f) {
+    return stream_accept_seq(rx, f->seq);
+}
+
+int stream_format_snapshot(char *buf, size_t size, const StreamSnapshot *snap) {
+    int used = snprintf(buf, size, "sn %u %llu %d",
+                        snap->seq, (unsigned long long)snap->t_us, snap->count);
+    for (int i = 0; i < snap->count && used > 0 && (size_t)used < size; i++) {
+        used += snprintf(buf + used, size - used, " %d %.1f, %.1f",
+                         snap->entities[i].id, snap->entities[i].x, snap->entities[i].y);
+    }
+    return used;
+}
+
+bool stream_parse_snapshot(const char *line, StreamSnapshot *snap) {
+    unsigned long long t_us;
+    int consumed = 0;
+    if (sscanf(line, "sn %u %llu %d%n", &snap->seq, &t_us, &snap->count, &consumed) != 3) {
+        return false;
+    }
+    if (snap->count < 0 || snap->count > STREAM_MAX_ENTITIES) return false;
+    snap->t_us = t_us;
+
+    const char *p = line + consumed;
+    for (int i = 0; i < snap->count; i++) {
+        StreamEntity *e = &snap->entities[i];
+        int n = 0;
+        if (sscanf(p, " %d %f, %f%n", &e->id, &e->x, &e->y, &n) != 3) return false;
+        p += n;
+    }
+    return true;
+}
+
+void stream_motion_update(StreamMotion *m, float x, float y, uint64_t t_peer_us, uint64_t t_local_us) {
+    if (m->have && x == m->x && y == m->y) {
+        // Same position again: a keepalive, or a snapshot sent for another
+        // drone. Keep the estimate until it has clearly stopped.
+        if (t_peer_us - m->t_peer_us > STREAM_STILL_MS * 1000ULL) {
+            m->vx = m->vy = 0;
+            m->t_peer_us = t_peer_us;
+            m->t_local_us = t_local_us;
+        }
+        return;
+    }
+
+    uint64_t dt_us = t_peer_us - m->t_peer_us;
+    if (m->have && t_peer_us > m->t_peer_us && dt_us <= STREAM_STILL_MS * 1000ULL) {
+        m->vx = (x - m->x) * 1e6f / (float)dt_us;
+        m->vy = (y - m->y) * 1e6f / (float)dt_us;
+    } else {
+        // First sample, or moving again after a stop: no speed to go on yet
+        m->vx = m->vy = 0;
+    }
+    m->have = true;
+    m->x = x;
+    m->y = y;
+    m->t_peer_us = t_peer_us;
+    m->t_local_us = t_local_us;
+}
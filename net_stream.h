@@ -0,0 +1,94 @@
+// net_stream.h
+#ifndef NET_STREAM_H
+#define NET_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming protocol
+// Negotiated during the handshake: the client answers "ok" with "ook stream"
+// instead of "ook", and a server that agrees appends " stream" to its size
+// line ("size w,h stream"). Legacy peers never offer it, so they keep the
+// lock-step drone/dok/obst/pok exchange.
+//
+// Once streaming, both peers push state frames whenever they like, full
+// duplex, with no acknowledgements:
+//     st <seq> <t_us> <x>, <y>
+// seq increases by one per frame and t_us is the sender's monotonic clock in
+// microseconds. Receivers keep only frames newer than the last one accepted.
+// "q" still ends the session.
+//
+// A server with several clients sends each streaming client an aggregated
+// snapshot of every other drone instead of a single "st" frame:
+//     sn <seq> <t_us> <count> <id> <x>, <y> <id> <x>, <y> ...
+// id 0 is the server's own drone, clients are numbered from 1 in order of
+// arrival. Entities missing from a snapshot have left the game.
+
+#define STREAM_OFFER       "ook stream"
+#define STREAM_SIZE_SUFFIX "stream"
+
+#define STREAM_SEND_PERIOD_MS  20    // Max frame rate when the position changes
+#define STREAM_KEEPALIVE_MS    200   // Resend the last state this often when idle
+#define STREAM_PEER_TIMEOUT_MS 5000  // Peer considered gone after this much silence
+
+typedef struct {
+    uint32_t seq;
+    uint64_t t_us;
+    float x;
+    float y;
+} StreamFrame;
+
+#define STREAM_MAX_ENTITIES 64       // Drones per snapshot
+#define STREAM_LINE_MAX     2048     // Longest frame line (a full snapshot)
+
+typedef struct {
+    int id;
+    float x;
+    float y;
+} StreamEntity;
+
+typedef struct {
+    uint32_t seq;
+    uint64_t t_us;
+    int count;
+    StreamEntity entities[STREAM_MAX_ENTITIES];
+} StreamSnapshot;
+
+// Receiver-side ordering state
+typedef struct {
+    bool have;                     // At least one frame accepted
+    uint32_t last_seq;
+    uint64_t last_rx_us;           // Local time of the last accepted frame
+    unsigned long accepted;
+    unsigned long stale_dropped;   // Out-of-order or duplicate frames
+} StreamRx;
+
+// Velocity of one remote drone, estimated from successive positions for the
+// BlackBoard's dead reckoning (dead_reckoning.h). Speeds come from the
+// sender's timestamps (t_us of frames and snapshots) so network jitter does
+// not look like acceleration; t_local_us is our clock at the same sample and
+// is what the BlackBoard extrapolates from. A position repeated for longer
+// than STREAM_STILL_MS (keepalives) means the drone has stopped.
+#define STREAM_STILL_MS 150
+
+typedef struct {
+    int id;
+    bool have;
+    float x, y;                    // Last position that changed
+    float vx, vy;                  // Units per second
+    uint64_t t_peer_us;            // Sender's clock at that position
+    uint64_t t_local_us;           // Our clock at that position
+} StreamMotion;
+
+uint64_t stream_now_us(void);
+int stream_format(char *buf, size_t size, const StreamFrame *f);
+bool stream_parse(const char *line, StreamFrame *f);
+bool stream_accept(StreamRx *rx, const StreamFrame *f);
+int stream_format_snapshot(char *buf, size_t size, const StreamSnapshot *snap);
+bool stream_parse_snapshot(const char *line, StreamSnapshot *snap);
+bool stream_accept_seq(StreamRx *rx, uint32_t seq);
+// Peers without timestamps (lock-step) pass our clock as t_peer_us too
+void stream_motion_update(StreamMotion *m, float x, float y, uint64_t t_peer_us, uint64_t t_local_us);
+
+#endif
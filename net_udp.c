@@ -0,0 +1,163 @@
+#include <errno.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "net_udp.h"
+
+// Field writers/readers in network byte order
+
+static unsigned char* put_u32(unsigned char *p, uint32_t v) {
+    v = htonl(v);
+    memcpy(p, &v, 4);
+    return p + 4;
+}
+
+static unsigned char* put_f32(unsigned char *p, float f) {
+    uint32_t v;
+    memcpy(&v, &f, 4);
+    return put_u32(p, v);
+}
+
+static const unsigned char* get_u32(const unsigned char *p, uint32_t *v) {
+    memcpy(v, p, 4);
+    *v = ntohl(*v);
+    return p + 4;
+}
+
+static const unsigned char* get_f32(const unsigned char *p, float *f) {
+    uint32_t v;
+    p = get_u32(p, &v);
+    memcpy(f, &v, 4);
+    return p;
+}
+
+static unsigned char* put_header(unsigned char *p, UdpType type, uint32_t seq, uint64_t t_us) {
+    p[0] = UDP_MAGIC;
+    p[1] = UDP_VERSION;
+    p[2] = (unsigned char)type;
+    p[3] = 0;
+    p = put_u32(p + 4, seq);
+    p = put_u32(p, (uint32_t)(t_us >> 32));
+    return put_u32(p, (uint32_t)t_us);
+}
+
+static ssize_t send_datagram(int fd, const struct sockaddr_in *to, const unsigned char *buf, size_t len) {
+    ssize_t n;
+    do {
+        n = sendto(fd, buf, len, MSG_DONTWAIT, (const struct sockaddr *)to, to ? sizeof(*to) : 0);
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
+
+ssize_t udp_send_hello(int fd, const struct sockaddr_in *to) {
+    unsigned char buf[UDP_HEADER_SIZE];
+    put_header(buf, UDP_HELLO, 0, stream_now_us());
+    return send_datagram(fd, to, buf, sizeof(buf));
+}
+
+ssize_t udp_send_welcome(int fd, const struct sockaddr_in *to, int width, int height, int id) {
+    unsigned char buf[UDP_HEADER_SIZE + 12];
+    unsigned char *p = put_header(buf, UDP_WELCOME, 0, stream_now_us());
+    p = put_u32(p, (uint32_t)width);
+    p = put_u32(p, (uint32_t)height);
+    put_u32(p, (uint32_t)id);
+    return send_datagram(fd, to, buf, sizeof(buf));
+}
+
+ssize_t udp_send_state(int fd, const struct sockaddr_in *to, uint32_t seq, float x, float y, uint32_t ack) {
+    unsigned char buf[UDP_HEADER_SIZE + 12];
+    unsigned char *p = put_header(buf, UDP_STATE, seq, stream_now_us());
+    p = put_f32(p, x);
+    p = put_f32(p, y);
+    put_u32(p, ack);
+    return send_datagram(fd, to, buf, sizeof(buf));
+}
+
+ssize_t udp_send_delta(int fd, const struct sockaddr_in *to, uint32_t seq, uint32_t base_seq,
+                       const uint8_t *bits, size_t len) {
+    unsigned char buf[UDP_MAX_DATAGRAM];
+    if (len > UDP_MAX_DELTA) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    unsigned char *p = put_header(buf, UDP_DELTA, seq, stream_now_us());
+    p = put_u32(p, base_seq);
+    memcpy(p, bits, len);
+    return send_datagram(fd, to, buf, (size_t)(p - buf) + len);
+}
+
+ssize_t udp_send_bye(int fd, const struct sockaddr_in *to) {
+    unsigned char buf[UDP_HEADER_SIZE];
+    put_header(buf, UDP_BYE, 0, stream_now_us());
+    return send_datagram(fd, to, buf, sizeof(buf));
+}
+
+// Payload bytes a datagram of this type must carry, -1 = unknown type.
+// A DELTA carries at least its base seq, the bitstream is whatever follows.
+static int payload_size(int type) {
+    switch (type) {
+    case UDP_HELLO:    return 0;
+    case UDP_WELCOME:  return 12;
+    case UDP_STATE:    return 12;
+    case UDP_DELTA:    return 4;
+    case UDP_BYE:      return 0;
+    default:           return -1;
+    }
+}
+
+static bool decode(const unsigned char *buf, size_t len, UdpMessage *msg) {
+    if (len < UDP_HEADER_SIZE || buf[0] != UDP_MAGIC || buf[1] != UDP_VERSION) return false;
+    int type = buf[2];
+    int payload = payload_size(type);
+    if (payload < 0 || len < (size_t)(UDP_HEADER_SIZE + payload)) return false;
+    if (type != UDP_DELTA && len != (size_t)(UDP_HEADER_SIZE + payload)) return false;
+    if (len > UDP_MAX_DATAGRAM) return false;   // A bitstream longer than UdpMessage.delta
+
+    uint32_t hi, lo;
+    const unsigned char *p = get_u32(buf + 4, &msg->seq);
+    p = get_u32(p, &hi);
+    p = get_u32(p, &lo);
+    msg->type = (UdpType)type;
+    msg->t_us = ((uint64_t)hi << 32) | lo;
+
+    uint32_t v;
+    switch (type) {
+    case UDP_WELCOME:
+        p = get_u32(p, &v); msg->width = (int)v;
+        p = get_u32(p, &v); msg->height = (int)v;
+        get_u32(p, &v);     msg->id = (int)v;
+        break;
+    case UDP_STATE:
+        p = get_f32(p, &msg->x);
+        p = get_f32(p, &msg->y);
+        get_u32(p, &msg->ack);
+        break;
+    case UDP_DELTA:
+        p = get_u32(p, &msg->base_seq);
+        msg->delta_len = len - (size_t)(p - buf);
+        memcpy(msg->delta, p, msg->delta_len);
+        break;
+    }
+    return true;
+}
+
+int udp_recv(int fd, UdpMessage *msg, struct sockaddr_in *from, unsigned long *bad) {
+    unsigned char buf[UDP_MAX_DATAGRAM + 1];   // One spare byte to spot oversized datagrams
+    for (;;) {
+        struct sockaddr_in addr;
+        socklen_t addrlen = sizeof(addr);
+        ssize_t n = recvfrom(fd, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr *)&addr, &addrlen);
+        if (n < 0) {
+            // ECONNREFUSED: an earlier datagram hit a closed port, the peer may still come up
+            if (errno == EINTR || errno == ECONNREFUSED) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        if (!decode(buf, (size_t)n, msg)) {
+            if (bad != NULL) (*bad)++;
+            continue;
+        }
+        if (from != NULL) *from = addr;
+        return 1;
+    }
+}
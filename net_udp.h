@@ -0,0 +1,76 @@
+// net_udp.h
+#ifndef NET_UDP_H
+#define NET_UDP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include "net_stream.h"
+
+// UDP transport (Parameter_File line 16, NET_UDP_1)
+// Every message is one datagram with a 16-byte header, all fields in
+// network byte order:
+//     magic(1) version(1) type(1) reserved(1) seq(4) t_us(8) payload
+// Handshake: the client sends HELLO every UDP_HELLO_RETRY_MS until the
+// server answers WELCOME (its window size and the id it gave the client). A
+// lost HELLO or WELCOME just costs one retry; a duplicate HELLO gets the same
+// WELCOME again.
+// After that both sides only send state, like the streaming TCP protocol:
+// the client its own position (STATE), the server the world it sees, every
+// other drone, delta-encoded against the last world the client acknowledged
+// (DELTA, see net_delta.h; STATE carries the acknowledgement). A state is sent when it changes (at most
+// every STREAM_SEND_PERIOD_MS) and resent every STREAM_KEEPALIVE_MS when
+// idle, which doubles as the heartbeat. seq increases by one per datagram and
+// receivers drop anything not newer than the last accepted one, so a late or
+// duplicated datagram never overwrites fresher state and a lost one is simply
+// replaced by the next. A peer silent for UDP_PEER_TIMEOUT_MS is gone; BYE
+// says so right away.
+
+#define UDP_MAGIC   0xD7
+#define UDP_VERSION 2
+
+#define UDP_HELLO_RETRY_MS  200
+#define UDP_HELLO_TRIES     75       // 15 s, as long as the TCP connect retries
+#define UDP_PEER_TIMEOUT_MS 2000     // 10 missed heartbeats
+
+#define UDP_HEADER_SIZE  16
+#define UDP_MAX_DELTA    1200        // Bitstream bytes, a full world of 64 drones needs ~300
+#define UDP_MAX_DATAGRAM (UDP_HEADER_SIZE + 4 + UDP_MAX_DELTA)
+
+typedef enum {
+    UDP_HELLO = 1,        // Client -> server, no payload
+    UDP_WELCOME,          // Server -> client: width, height, client id
+    UDP_STATE,            // Client -> server: x, y (virtual), newest world decoded
+    UDP_DELTA,            // Server -> client: base world seq (0 = none), bitstream
+    UDP_BYE               // Either way, no payload
+} UdpType;
+
+// A received datagram, decoded to host order
+typedef struct {
+    UdpType type;
+    uint32_t seq;
+    uint64_t t_us;
+    int width, height, id;             // UDP_WELCOME
+    float x, y;                        // UDP_STATE
+    uint32_t ack;                      // UDP_STATE
+    uint32_t base_seq;                 // UDP_DELTA
+    size_t delta_len;
+    uint8_t delta[UDP_MAX_DELTA];
+} UdpMessage;
+
+// to == NULL sends on a connected socket. Return the sendto() result.
+ssize_t udp_send_hello(int fd, const struct sockaddr_in *to);
+ssize_t udp_send_welcome(int fd, const struct sockaddr_in *to, int width, int height, int id);
+ssize_t udp_send_state(int fd, const struct sockaddr_in *to, uint32_t seq, float x, float y, uint32_t ack);
+ssize_t udp_send_delta(int fd, const struct sockaddr_in *to, uint32_t seq, uint32_t base_seq,
+                       const uint8_t *bits, size_t len);
+ssize_t udp_send_bye(int fd, const struct sockaddr_in *to);
+
+// Receive one datagram (from may be NULL). Returns 1 with a valid message,
+// 0 when nothing is waiting, -1 on a socket error. Malformed datagrams are
+// counted in *bad (if not NULL) and skipped.
+int udp_recv(int fd, UdpMessage *msg, struct sockaddr_in *from, unsigned long *bad);
+
+#endif
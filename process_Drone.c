@@ -20,6 +20,16 @@
 #include <sys/file.h>
 #include "logger.h"
 #include "logger_custom.h"
+#include "world_state.h"
+#include "ipc_frame.h"
+#include "tick_scheduler.h"
+#include "drone_dynamics.h"
+#include "force_field.h"
+#include "swarm_state.h"
+#include "traj_recorder.h"
+#include "session_record.h"
+#include "heartbeat.h"
+#include "latency_hist.h"
 
 
 int window_width;
@@ -34,18 +44,13 @@ int t_intial ;
 bool running = true;
 bool repul =false;
 int mode =0;
+WorldState *world = NULL;   // Shared world state, NULL when using the pipes
+int swarm_size = 0;         // Drones integrated by this process in swarm mode, 0 = single drone
+SwarmState *swarm = NULL;   // Swarm positions / arena, NULL outside swarm mode
 
 // sig_atomic_t ensures atomic access during signal handling
-volatile sig_atomic_t health_check = 0;
 volatile sig_atomic_t should_exit = 0;
 
-// Handler for health check signal from watchdog
-void handle_signal(int signo) {
-    if (signo == SIGUSR1) {
-        health_check = 1; // Mark that we received a ping
-    }
-}
-
 //termination handler from master process
 void handle_terminate(int signo) {
     if (signo == SIGTERM) {
@@ -54,22 +59,17 @@ void handle_terminate(int signo) {
 }
 
 
-void log_coordinates(const char *message) {
-    FILE *f = fopen("coordinates_log.log", "a");
-    if (!f) {
-        LOG_ERRNO("Drone","Failed to open coordinates_log.log");
-        return;
-    }
-    if (flock(fileno(f), LOCK_EX) == -1) { fclose(f); return; }
-    
-    time_t now = time(NULL);
-    char *timestamp = ctime(&now);
-    timestamp[strlen(timestamp)-1] = '\0';
-    fprintf(f, "[%s] %s\n", timestamp, message);
-    fflush(f);
-    flock(fileno(f), LOCK_UN);
-    fclose(f);
-}
+TrajWriter traj;            // Binary trajectory, one record per tick
+bool traj_ok = false;
+
+int session_mode = SESSION_OFF;   // Record or replay what we consume, see session_record.h
+bool replaying = false;
+SessionWriter session_out;
+SessionReader session_in;
+uint32_t tick_no = 0;             // Physics ticks run so far, the session time base
+
+LatencyHist lat_input_drone;      // Key read in Input -> applied here, see latency_hist.h
+uint64_t key_t_in = 0;            // Stamp of the newest key applied, sent on with the positions
 
 // Function to identify opposite keys
 char get_opposite_key(char key) {
@@ -101,12 +101,13 @@ void Parameter_File() {
 
         char* tokens[10]; 
         int token_count = 0;
-        char* token = strtok(line, "_");
+        char* save = NULL;
+        char* token = strtok_r(line, "_", &save);
 
         while (token != NULL && token_count < 10) {
             tokens[token_count] = token; // Add token to our array
             token_count++;
-            token = strtok(NULL, "_"); // Get next token
+            token = strtok_r(NULL, "_", &save); // Get next token
         }
 
         switch (line_number) {
@@ -137,19 +138,258 @@ void Parameter_File() {
             case 9:
                 if (token_count > 2) t_intial = atoi(tokens[2]);
                 break;
+            case 14:
+                if (token_count > 2) swarm_size = atoi(tokens[2]);
+                break;
         }
     }
     fclose(file);
 }
 
+// Input -> Drone latency of every stamped key about to be applied
+static void record_key_latency(const uint64_t *stamps, int key_count) {
+    uint64_t now = lat_now_us();
+    for (int k = 0; k < key_count; k++) {
+        if (stamps[k] == 0) continue;   // Replayed key
+        lat_record(&lat_input_drone, now - stamps[k]);
+        key_t_in = stamps[k];
+    }
+}
+
+static void log_latency(const char *when) {
+    char buf[160];
+    lat_format(&lat_input_drone, buf, sizeof(buf));
+    LOG_INFO("Drone", "Latency%s: %s", when, buf);
+}
+
+// Apply the keys received since the last step, in order
+static void apply_keys(const char *keys, int key_count, FrameReader *inReader,
+                       TickScheduler *sched, char *active_key, int *boost_level) {
+    Frame frame;
+    for (int k = 0; k < key_count && running; k++) {
+        char input_key = keys[k];
+
+        // Case A: Quit
+        if (input_key == 'q') {
+            running = false;
+        }
+        // Case: Reset - handled by BlackBoard, just reset our state
+        else if (input_key == 'a') {
+            *boost_level = 0;
+            *active_key = ' ';
+            // Position update comes from fdFromBB pipe (swarm: arena reset_gen)
+        }
+        // Case B: Brake (Stop Engine)
+        else if (input_key == 'd') {
+            *boost_level = 0;
+            *active_key = ' ';
+        }
+        // Case C: Pause Logic
+        else if (input_key == 'p') {
+            // Enter Blocking Wait for 'u', first among the keys already received
+            bool resumed = false;
+            while (!resumed && ++k < key_count) resumed = (keys[k] == 'u');
+            // A replay has no live input; its 'u' is always among the recorded keys
+            if (!resumed && !replaying) heartbeat_idle();
+            while (!resumed && running && !replaying) {
+                while (!resumed && frame_next(inReader, &frame)) {
+                    resumed = (frame.hdr.type == FRAME_KEY && frame.u.key.key == 'u');
+                }
+                if (!resumed) {
+                    int n = frame_fill(inReader);
+                    if (n == 0 || n == -1) running = false;
+                }
+                // Paused ticks don't exist, the 'u' belongs to the tick that paused
+                if (resumed && session_mode == SESSION_RECORD) {
+                    session_record(&session_out, tick_no, SESS_KEY, 'u', 0, 0);
+                }
+            }
+            // Don't replay the paused time as a burst of steps
+            tick_resync(sched);
+        }
+        // Case E: Same Direction -> Increase Speed
+        else if (input_key == *active_key) {
+            if (*boost_level < 2) (*boost_level)++;
+        }
+        // Case F: Opposite Direction -> Decrease Speed
+        else if (input_key == get_opposite_key(*active_key)) {
+            (*boost_level)--;
+            if (*boost_level < 0) {
+                // Crossed the threshold: Reverse Direction
+                *boost_level = 0;
+                *active_key = input_key;
+            }
+        }
+        // Case G: Intializes the first key pressed and if New Direction (Orthogonal) -> Switch immediately
+        else {
+            *boost_level = 0;
+            *active_key = input_key;
+        }
+    }
+}
+
+// Thrust from the active direction key and boost level
+static void command_force(char active_key, int boost_level, float *Fx, float *Fy) {
+    float diag_force = (float)force_intial * M_SQRT1_2;
+    float multiplier = 1.0 + (boost_level * 0.2);
+    float cur_force = force_intial * multiplier;
+    float cur_diag = diag_force * multiplier;
+
+    *Fx = 0;
+    *Fy = 0;
+    switch (active_key) {
+        case 'e': *Fy = -cur_force; break; // Up
+        case 'c': *Fy =  cur_force; break; // Down
+        case 's': *Fx = -cur_force; break; // Left
+        case 'f': *Fx =  cur_force; break; // Right
+        case 'w': *Fx = -cur_diag; *Fy = -cur_diag; break;
+        case 'r': *Fx =  cur_diag; *Fy = -cur_diag; break;
+        case 'x': *Fx = -cur_diag; *Fy =  cur_diag; break;
+        case 'v': *Fx =  cur_diag; *Fy =  cur_diag; break;
+    }
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Lattice spacing that keeps the formation inside 80% of the arena
+static float formation_spacing(int count, float w, float h) {
+    float side = ceilf(sqrtf((float)count));
+    float spacing = 0.8f * fminf(w, h) / side;
+    return (spacing < 1.0f) ? spacing : 1.0f;
+}
+
+FieldSources swarm_obstacles;   // Obstacles from the arena, SoA
+SwarmArena arena;
+
+// Swarm mode: integrate swarm_size drones with the same keys, one SoA step per
+// tick. Every drone is pushed by the obstacles and walls near it; positions go
+// to the BlackBoard through the swarm segment instead of the pipes.
+static void run_swarm(int fdIn, FrameReader *inReader) {
+    Swarm sw;
+    if (swarm_alloc(&sw, swarm_size) == -1) {
+        LOG_CRITICAL("Drone", "Failed to allocate %d swarm drones", swarm_size);
+        return;
+    }
+
+    float T = t_intial / 1000.0; // Convert ms to seconds
+    DynParams dyn;
+    dyn_params_init(&dyn, mass, k_intial, T);
+    FieldParams field;
+    field_params_init(&field, rph_intial, eta_intial);
+
+    // Wait for the BlackBoard to publish the arena size
+    while (swarm_arena_gen(swarm) == 0 && !should_exit) {
+        usleep(1000);
+    }
+    uint32_t arena_gen = 0;
+    uint32_t reset_gen = 0;
+    bool formed = false;
+
+    TickScheduler sched;
+    if (tick_init(&sched, t_intial, TICK_MAX_CATCHUP) == -1 || tick_watch(&sched, fdIn) == -1) {
+        LOG_ERRNO("Drone", "Failed to set up the tick scheduler");
+        swarm_free(&sw);
+        return;
+    }
+    fd_set readfds;
+    int steps = 0;
+    Frame frame;
+    char keys[64];
+    uint64_t key_stamps[64];   // Input's read() time of each key
+    int key_count = 0;
+    char active_key = ' ';
+    int boost_level = 0;
+    double physics_us = 0;
+    unsigned long physics_ticks = 0;
+
+    while (running && !should_exit) {
+        int retval = tick_wait(&sched, &readfds, &steps);
+        if (retval == -1) break;
+        heartbeat_beat();
+
+        if (retval > 0 && FD_ISSET(fdIn, &readfds)) {
+            int n = frame_fill(inReader);
+            if (n == 0 || n == -1) {
+                LOG_ERROR("Drone", "Input pipe closed unexpectedly");
+                running = false;
+            }
+            while (frame_next(inReader, &frame)) {
+                if (frame.hdr.type != FRAME_KEY) continue;
+                if (key_count < (int)sizeof(keys)) {
+                    key_stamps[key_count] = frame.u.key.t_in_us;
+                    keys[key_count++] = frame.u.key.key;
+                }
+            }
+        }
+
+        // New window size, obstacles or a formation reset from the BlackBoard
+        if (swarm_arena_gen(swarm) != arena_gen) {
+            swarm_read_arena(swarm, &arena);
+            arena_gen = arena.gen;
+            field_clear(&swarm_obstacles);
+            for (int i = 0; i < arena.obs_count; i++) {
+                field_add(&swarm_obstacles, arena.obs_x[i], arena.obs_y[i]);
+            }
+            if (!formed || arena.reset_gen != reset_gen) {
+                reset_gen = arena.reset_gen;
+                formed = true;
+                swarm_formation(&sw, arena.width / 2.0f, arena.height / 2.0f,
+                                formation_spacing(sw.count, arena.width, arena.height));
+            }
+        }
+
+        if (steps == 0) continue;
+
+        record_key_latency(key_stamps, key_count);
+        apply_keys(keys, key_count, inReader, &sched, &active_key, &boost_level);
+        key_count = 0;
+        float Fx = 0, Fy = 0;
+        command_force(active_key, boost_level, &Fx, &Fy);
+
+        double t0 = now_us();
+        for (int s = 0; s < steps; s++) {
+            memset(sw.fx, 0, sizeof(float) * (size_t)sw.count);
+            memset(sw.fy, 0, sizeof(float) * (size_t)sw.count);
+            field_swarm_force(&swarm_obstacles, &field, sw.count, sw.x, sw.y, sw.fx, sw.fy);
+            field_swarm_walls(&field, sw.count, sw.x, sw.y, arena.width, arena.height, sw.fx, sw.fy);
+            swarm_step(&sw, &dyn, Fx, Fy);
+            swarm_clamp(&sw, arena.width, arena.height);
+        }
+        physics_us += now_us() - t0;
+        physics_ticks++;
+
+        swarm_publish_drones(swarm, sw.x, sw.y, sw.count);
+
+        if (tick_report_due(&sched, 10000)) {
+            char stats[256];
+            tick_format_stats(&sched, stats, sizeof(stats));
+            LOG_INFO("Drone", "Tick stats: %s", stats);
+            LOG_INFO("Drone", "Swarm physics: %d drones, %.1f us per tick, %d obstacles",
+                     sw.count, physics_us / physics_ticks, swarm_obstacles.count);
+            log_latency("");
+        }
+    }
+
+    char stats[256];
+    tick_format_stats(&sched, stats, sizeof(stats));
+    LOG_INFO("Drone", "Tick stats at exit: %s", stats);
+    if (physics_ticks > 0) {
+        LOG_INFO("Drone", "Swarm physics: %d drones, %.1f us per tick", sw.count, physics_us / physics_ticks);
+    }
+    log_latency(" at exit");
+    tick_close(&sched);
+    swarm_free(&sw);
+}
+
 int main(int argc, char *argv[]) 
 {
         
     // Setup signal handling FIRST
     struct sigaction sa;
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = handle_signal;
-    sigaction(SIGUSR1, &sa, NULL);
     
     memset(&sa, 0, sizeof(sa));
     sa.sa_handler = handle_terminate;
@@ -157,16 +397,9 @@ int main(int argc, char *argv[])
 
     // LOG SELF immediately
     log_process("Drone", getpid());
-    logger_init("system.log",0);
+    logger_init_mode("system.log", 0, LOG_MODE_ASYNC);
     LOG_INFO("Drone", "Starting Drone Process (PID=%d)", getpid());
     
-    // Reset coordinates log at start
-    FILE *reset_f = fopen("coordinates_log.log", "w");
-    if (reset_f) fclose(reset_f);
-    
-   pid_t watchdog_pid = -1;
-   int retries = 0;
-
     // Standardized exit codes
     #define USAGE_ERROR 64
     #define OPEN_FAIL 66
@@ -174,6 +407,7 @@ int main(int argc, char *argv[])
     #define RUNTIME_ERROR 70
 
     Parameter_File();
+    lat_init(&lat_input_drone, "input->drone");
 
     if (argc < 5) {
         fprintf(stderr, "Usage: %s <fd>\n", argv[0]);
@@ -187,61 +421,157 @@ int main(int argc, char *argv[])
     int fdToBB = atoi(argv[3]);
     int fdRepul = atoi(argv[4]);
     mode = atoi(argv[5]);       //1,2,3
+    int use_shm = (argc > 6) ? atoi(argv[6]) : 0;   // 1 = shared-memory world state
+    const char *session_path = NULL;
+    if (argc > 8) {
+        session_mode = atoi(argv[7]);
+        session_path = argv[8];
+    }
+    replaying = (session_mode == SESSION_REPLAY || session_mode == SESSION_REPLAY_FAST);
 
-    if (mode == 2 || mode ==3){
-        LOG_WARNING("Drone","Running in Client/Server mode, watchdog monitoring disabled.\n");
-    }else{
-        
-        while (watchdog_pid == -1 && retries < 10) {
-            sleep(1);
-            watchdog_pid = get_pid_by_name("Watchdog");
-            retries++;
+    if (use_shm) {
+        world = world_attach();
+        if (world == NULL) {
+            LOG_CRITICAL("Drone", "Failed to attach shared world state");
+            exit(OPEN_FAIL);
         }
-        
-        if (watchdog_pid == -1) {
-            LOG_WARNING("Drone","Could not find Watchdog! Exiting.\n");
-            return 1;
+        LOG_INFO("Drone", "Using shared-memory world state");
+    }
+
+    // Swarm mode (standalone only): the BlackBoard attaches to the same segment
+    if (swarm_size > 0 && mode == 1) {
+        if (swarm_size > SWARM_MAX_DRONES) swarm_size = SWARM_MAX_DRONES;
+        swarm = swarm_attach();
+        if (swarm == NULL) {
+            LOG_WARNING("Drone", "Swarm state unavailable, simulating a single drone");
+        } else {
+            LOG_INFO("Drone", "Swarm mode, %d drones", swarm_size);
         }
-    } 
+    }
+
+    if (mode == 2 || mode ==3){
+        LOG_WARNING("Drone","Running in Client/Server mode, watchdog monitoring disabled.\n");
+    }
+    // Watchdog: one heartbeat per loop, at least one per tick
+    if (heartbeat_register("Drone", t_intial * 3 / 2) == -1) {
+        LOG_WARNING("Drone", "Heartbeat table unavailable, not monitored by the watchdog");
+    }
 
     // Avoid process termination on broken pipe and print FD debug
     signal(SIGPIPE, SIG_IGN);
     dprintf(STDERR_FILENO, "DRONE: start fds fdIn=%d fdFromBB=%d fdToBB=%d\n",fdIn, fdFromBB, fdToBB);
     
-    struct timeval tv={0,0};
     int retval;
-    char strIn[135],sOut[135],strFromBB[100], strRepul[50]; 
-    char sIn[10];
+    FrameReader inReader, bbReader, repulReader;
+    frame_reader_init(&inReader, fdIn);
+    frame_reader_init(&bbReader, fdFromBB);
+    frame_reader_init(&repulReader, fdRepul);
+    FrameWriter toBB;
+    frame_writer_init(&toBB, fdToBB);
+    Frame frame;
 
-    float distance=0;
-    float dx=0,dy=0;
+    // Keys received since the last physics step, applied in order
+    char keys[64];
+    uint64_t key_stamps[64];   // Input's read() time of each key
+    int key_count = 0;
+
+    float repul_x = 0, repul_y = 0;   // Net repulsion from the BlackBoard's force field
 
     float x_curr = 0, y_curr = 0;
     float x_prev = 0, y_prev = 0;
     float x_prev2 = 0, y_prev2 = 0;
     float x_update =0 , y_update =0;
 
-    ssize_t bytes = 0;
-    while (bytes <= 0) {
-        bytes = read(fdFromBB, strFromBB, sizeof(strFromBB)-1);
+    uint32_t reset_gen = 0;   // Last BlackBoard reset applied (shared-memory mode)
+
+    if (swarm != NULL) {
+        run_swarm(fdIn, &inReader);
+        close(fdIn);
+        close(fdFromBB);
+        close(fdToBB);
+        close(fdRepul);
+        swarm_detach(swarm);
+        world_detach(world);
+        heartbeat_unregister();
+        logger_close();
+        return 0;
+    }
+
+    if (session_mode == SESSION_RECORD) {
+        if (session_open(&session_out, session_path, SESSION_DRONE) == -1) {
+            LOG_ERRNO("Drone", "Failed to open the session file, not recording");
+            session_mode = SESSION_OFF;
+        }
+    } else if (replaying) {
+        if (session_load(&session_in, session_path, SESSION_DRONE) == -1) {
+            LOG_ERRNO("Drone", "Failed to load the session file");
+            exit(OPEN_FAIL);
+        }
+        // The dynamics of the recorded run, whatever the parameter file says now
+        t_intial = session_in.hdr.tick_ms;
+        force_intial = session_in.hdr.force;
+        mass = session_in.hdr.mass;
+        k_intial = session_in.hdr.k;
+        LOG_INFO("Drone", "Replaying %zu events%s", session_in.count,
+                 session_mode == SESSION_REPLAY_FAST ? ", unpaced" : "");
     }
-    strFromBB[bytes] = '\0';
 
-    sscanf(strFromBB, "%f,%f",&x_curr, &y_curr);
+    if (world != NULL) {
+        // Wait for the BlackBoard to publish the starting position
+        ResetSnapshot reset;
+        world_read_reset(world, &reset);
+        while (reset.gen == 0 && !should_exit) {
+            usleep(1000);
+            world_read_reset(world, &reset);
+        }
+        x_curr = reset.x;
+        y_curr = reset.y;
+        reset_gen = reset.gen;
+    } else {
+        // Wait for the BlackBoard to send the starting position
+        bool have_start = false;
+        while (!have_start && !should_exit) {
+            int n = frame_fill(&bbReader);
+            if (n == 0 || n == -1) break;
+            while (frame_next(&bbReader, &frame)) {
+                if (frame.hdr.type == FRAME_POSITION) {
+                    x_curr = frame.u.pos.x;
+                    y_curr = frame.u.pos.y;
+                    have_start = true;
+                }
+            }
+        }
+    }
     
     x_prev = x_curr;
     x_prev2 = x_curr;
     y_prev = y_curr;
     y_prev2 = y_curr;
+    if (session_mode == SESSION_RECORD) {
+        session_record(&session_out, tick_no, SESS_RESET, 0, x_curr, y_curr);
+    }
 
+    // New trajectory for this run; a replay keeps the recorded one for comparison
+    const char *traj_path = replaying ? TRAJ_REPLAY_PATH : TRAJ_PATH;
+    traj_ok = (traj_open(&traj, traj_path, t_intial) == 0);
+    if (!traj_ok) LOG_ERRNO("Drone", "Failed to create the trajectory file, trajectory not recorded");
+
+    // Physics runs on a fixed T-ms timer; the pipes wake us in between.
+    // A replay takes its keys from the session, not from the Input process.
+    TickScheduler sched;
+    if (tick_init(&sched, t_intial, TICK_MAX_CATCHUP) == -1 ||
+        (!replaying && tick_watch(&sched, fdIn) == -1) || tick_watch(&sched, fdFromBB) == -1 ||
+        tick_watch(&sched, fdRepul) == -1) {
+        LOG_ERRNO("Drone", "Failed to set up the tick scheduler");
+        exit(RUNTIME_ERROR);
+    }
+    if (session_mode == SESSION_REPLAY_FAST) tick_set_unpaced(&sched);
     fd_set readfds;
-
-    int maxfd = fdIn;
-    if (fdFromBB > maxfd) maxfd = fdFromBB;
-    if (fdRepul > maxfd) maxfd = fdRepul;
+    int steps = 0;
  
-    float diag_force = (float)force_intial * M_SQRT1_2;
     float T= t_intial / 1000.0; // Convert ms to seconds
+    DynParams dyn;
+    dyn_params_init(&dyn, mass, k_intial, T);
 
     char active_key = ' '; // The key currently driving the physics
     int boost_level = 0;   // 0 = 0%, 1 = 20%, 2 = 40% (Max)
@@ -253,223 +583,249 @@ int main(int argc, char *argv[])
             break;
         }
 
-        FD_ZERO(&readfds);
-        FD_SET(fdIn, &readfds);
-        FD_SET(fdFromBB, &readfds);
-        FD_SET(fdRepul, &readfds);
-
-        tv.tv_sec = 0;
-        tv.tv_usec = 0; // Use a zero-timeout for select to poll
-
-        retval = select(maxfd + 1, &readfds, NULL, NULL, &tv);
+        // Sleep until a pipe has data or the next physics step is due
+        retval = tick_wait(&sched, &readfds, &steps);
+        heartbeat_beat();
 
         if (retval == -1) {
             break;
         } 
         else if (retval > 0) {
 
-            // Read from keyboard
+            // Read from keyboard, every key in the order it was typed
             if (FD_ISSET(fdIn, &readfds)) {
-                ssize_t bytes = read(fdIn, strIn, sizeof(strIn)-1);
-                if (bytes > 0) {
-                    strIn[bytes] = '\0';
-                    sscanf(strIn, "%s", sIn);
-                    LOG_INFO("Drone", "Received key input: %s", sIn);
-                } else { 
+                int n = frame_fill(&inReader);
+                if (n == 0 || n == -1) {
                     LOG_ERROR("Drone", "Input pipe closed unexpectedly");
                     running = false; } // Pipe closed
+                while (frame_next(&inReader, &frame)) {
+                    if (frame.hdr.type != FRAME_KEY) continue;
+                    if (key_count < (int)sizeof(keys)) {
+                        key_stamps[key_count] = frame.u.key.t_in_us;
+                        keys[key_count++] = frame.u.key.key;
+                    }
+                    LOG_INFO("Drone", "Received key input: %c", frame.u.key.key);
+                }
             }
 
-            // Read from black board PIPE
+            // Read from black board PIPE, only the newest position matters
             if (FD_ISSET(fdFromBB, &readfds)) {
-                ssize_t bytes = read(fdFromBB, strFromBB, sizeof(strFromBB)-1);
-                if (bytes > 0) {
-                    strFromBB[bytes] = '\0';
-                    sscanf(strFromBB, "%f,%f",&x_update, &y_update);
+                int n = frame_fill(&bbReader);
+                if (n == 0 || n == -1) {
+                    LOG_ERROR("Drone", "Input pipe closed unexpectedly");
+                    running = false; }
+                while (frame_next(&bbReader, &frame)) {
+                    // Replays take their resets from the session
+                    if (frame.hdr.type != FRAME_POSITION || replaying) continue;
+                    x_update = frame.u.pos.x;
+                    y_update = frame.u.pos.y;
                     x_prev = x_update;
                     x_prev2 = x_update;
                     y_prev = y_update;
                     y_prev2 = y_update;
+                    if (session_mode == SESSION_RECORD) {
+                        session_record(&session_out, tick_no, SESS_RESET, 0, x_update, y_update);
+                    }
                     LOG_INFO("Drone", "Received key inputs");
-                }else { 
-                    LOG_ERROR("Drone", "Input pipe closed unexpectedly");
-                    running = false; }
+                }
             }
 
-            // Read repulsion keys
+            // Read the net repulsion, the newest one describes the current surroundings
             if (FD_ISSET(fdRepul,&readfds)){
-                 ssize_t bytes = read(fdRepul, strRepul, sizeof(strRepul)-1);
-                if (bytes > 0) {
-                    strRepul[bytes] = '\0';
-                    sscanf(strRepul, "%f,%f,%f",&distance,&dx,&dy);
+                int n = frame_fill(&repulReader);
+                if (n == 0) { // Pipe closed
+                    LOG_ERROR("Drone", "Input pipe closed unexpectedly");
+                    running = false;
+                }
+                while (frame_next(&repulReader, &frame)) {
+                    if (frame.hdr.type != FRAME_FORCE || replaying) continue;
+                    repul_x = frame.u.force.fx;
+                    repul_y = frame.u.force.fy;
                     repul=true;
                     LOG_INFO("Drone", "Received repulsion inputs");
-                } else { 
-                    if (bytes == 0) { // Pipe closed
-                        LOG_ERROR("Drone", "Input pipe closed unexpectedly");
-                        running = false;
-                    }
                 }
             }
         }                
-        
-        char input_key = sIn[0];
-        //char repul_key =sRepul[0];
 
-        if (input_key != ' ' && input_key != 0) {
-
-            // Case A: Quit
-            if (input_key == 'q') {
-                running = false;
-            }
-            // Case: Reset - handled by BlackBoard, just reset our state
-            else if (input_key == 'a') {
-                boost_level = 0;
-                active_key = ' ';
-                // Position update comes from fdFromBB pipe
-            }
-            // Case B: Brake (Stop Engine)
-            else if (input_key == 'd') {
-                boost_level = 0;
-                active_key = ' ';
-            }
-            // Case C: Pause Logic
-            else if (input_key == 'p') {
-                // Enter Blocking Wait for 'u'
-                while(1) {
-                    ssize_t b = 0;
-                    while (b <= 0) b = read(fdIn, strIn, sizeof(strIn)-1);
-                    strIn[b] = '\0';
-                    sscanf(strIn, "%s", sIn);
-                    if (sIn[0] == 'u') break;
+        // Position resets from the BlackBoard (shared-memory mode)
+        if (world != NULL) {
+            ResetSnapshot reset;
+            world_read_reset(world, &reset);
+            if (reset.gen != reset_gen && replaying) {
+                reset_gen = reset.gen;   // Acknowledged, but the session decides the position
+            } else if (reset.gen != reset_gen) {
+                reset_gen = reset.gen;
+                if (session_mode == SESSION_RECORD) {
+                    session_record(&session_out, tick_no, SESS_RESET, 0, reset.x, reset.y);
                 }
+                x_prev = reset.x;
+                x_prev2 = reset.x;
+                y_prev = reset.y;
+                y_prev2 = reset.y;
             }
-            // Case E: Same Direction -> Increase Speed
-            else if (input_key == active_key) {
-                if (boost_level < 2) boost_level++; 
-            }
-            // Case F: Opposite Direction -> Decrease Speed
-            else if (input_key == get_opposite_key(active_key)) {
-                boost_level--;
-                if (boost_level < 0) {
-                    // Crossed the threshold: Reverse Direction
-                    boost_level = 0;
-                    active_key = input_key;
+        }
+
+        // Keys that arrived between ticks wait in keys[] for the next step
+        if (steps == 0) continue;
+
+        if (replaying) {
+            // Exactly what this tick consumed when it was recorded
+            key_count = 0;
+            steps = 1;
+            SessionEvent ev;
+            bool ended = false;
+            while (session_next(&session_in, tick_no, &ev)) {
+                switch (ev.type) {
+                    case SESS_KEY:
+                        if (key_count < (int)sizeof(keys)) {
+                            key_stamps[key_count] = 0;
+                            keys[key_count++] = (char)ev.id;
+                        }
+                        break;
+                    case SESS_RESET:
+                        x_prev = ev.a;
+                        x_prev2 = ev.a;
+                        y_prev = ev.b;
+                        y_prev2 = ev.b;
+                        break;
+                    case SESS_FORCE:
+                        repul_x = ev.a;
+                        repul_y = ev.b;
+                        repul = true;
+                        break;
+                    case SESS_STEPS:
+                        steps = ev.id;
+                        break;
+                    case SESS_END:
+                        ended = true;
+                        break;
                 }
             }
-            // Case G: Intializes the first key pressed and if New Direction (Orthogonal) -> Switch immediately
-            else {
-                boost_level = 0;
-                active_key = input_key;
+            if (ended) {
+                LOG_INFO("Drone", "Replay finished after %u ticks", tick_no);
+                break;
+            }
+        } else if (session_mode == SESSION_RECORD) {
+            for (int k = 0; k < key_count; k++) {
+                session_record(&session_out, tick_no, SESS_KEY, keys[k], 0, 0);
             }
+            if (steps != 1) session_record(&session_out, tick_no, SESS_STEPS, steps, 0, 0);
         }
         
+        // Apply every key received since the last step, in order
+        record_key_latency(key_stamps, key_count);
+        apply_keys(keys, key_count, &inReader, &sched, &active_key, &boost_level);
+        
 
         // Clear physical input so keys don't "stick" in the buffer,
         // BUT active_key persists, so the engine keeps running.
-        sIn[0] = ' '; 
+        key_count = 0;
         
         // Note: We no longer reset boost_level and active_key when repulsion occurs.
         // This allows both user input force and repulsion force to be applied simultaneously.
 
-        float multiplier = 1.0 + (boost_level * 0.2);
-        float cur_force = force_intial * multiplier;
-        float cur_diag = diag_force * multiplier;
-
         float Fx = 0, Fy = 0;
-        float total_fx=0, total_fy=0;
-       
-
-         switch (active_key) {
-            case 'e': Fy = -cur_force; break; // Up
-            case 'c': Fy =  cur_force; break; // Down
-            case 's': Fx = -cur_force; break; // Left
-            case 'f': Fx =  cur_force; break; // Right
-            case 'w': Fx = -cur_diag; Fy = -cur_diag; break;
-            case 'r': Fx =  cur_diag; Fy = -cur_diag; break;
-            case 'x': Fx = -cur_diag; Fy =  cur_diag; break;
-            case 'v': Fx =  cur_diag; Fy =  cur_diag; break;
-        }
-
-        total_fx= Fx;
-        total_fy= Fy;
-        float MAX_REPULSION = 40.0; //increased for drones running towards each other
+        command_force(active_key, boost_level, &Fx, &Fy);
 
+        float total_fx = Fx;
+        float total_fy = Fy;
+        float rep_fx = 0, rep_fy = 0;
         if (repul){
 
-            float dist_f = distance;
-
-            //this is the bridge between physics and pixels 
-            float scale_factor = 400; //increased for drones running towards each other
-
-            float term_rph = (1.0 / rph_intial);
-            float norm_dx = dx/dist_f;
-            float norm_dy = dy/dist_f;
-                        
-            float repulsion_force= scale_factor * eta_intial * 1/pow(dist_f,2) * (1/dist_f - term_rph);
-
-            if (repulsion_force > MAX_REPULSION) repulsion_force = MAX_REPULSION;
-            float repul_x = repulsion_force * norm_dx;
-            float repul_y = repulsion_force * norm_dy;
-
+            // Already summed over every obstacle and wall by the BlackBoard
             // Add repulsion (Push away), it has its own sign to be repul
-            total_fx += repul_x;
-            total_fy += repul_y;
-
-            char msg[256];
-            snprintf(msg, 256, "DRONE: Repulsion - dist=%.2f, Fmag=%.4f, Fx=%.4f, Fy=%.4f", dist_f, repulsion_force, repul_x, repul_y);
-            log_coordinates(msg);
+            rep_fx = repul_x;
+            rep_fy = repul_y;
+            total_fx += rep_fx;
+            total_fy += rep_fy;
             repul=false;
+            if (session_mode == SESSION_RECORD) {
+                session_record(&session_out, tick_no, SESS_FORCE, 0, rep_fx, rep_fy);
+            }
         }
     
-        float denom = mass + (k_intial * T);
-        float history_factor = (2 * mass) + (k_intial * T);
-
-        float num_x = (total_fx * T * T) + (x_prev * history_factor) - (mass * x_prev2);
-        float x_new = num_x / denom;
-
-        float num_y = (total_fy * T * T) + (y_prev * history_factor) - (mass * y_prev2);
-        float y_new = num_y / denom;
-        
-        // Update history
-        x_prev2 = x_prev; x_prev = x_new;
-        y_prev2 = y_prev; y_prev = y_new;
-        x_curr = x_new;
-        y_curr = y_new;
+        // One integration step per timer period; after an overrun the missed
+        // ones are caught up here with the same forces
+        for (int s = 0; s < steps; s++) {
+            dyn_step(&dyn, 1, &x_prev, &y_prev, &x_prev2, &y_prev2, NULL, NULL, total_fx, total_fy);
+        }
+        x_curr = x_prev;
+        y_curr = y_prev;
+        tick_no++;
+
+        if (session_mode == SESSION_RECORD && session_flush(&session_out) == -1) {
+            LOG_ERRNO("Drone", "Session write failed, recording stopped");
+            session_close(&session_out);
+            session_mode = SESSION_OFF;
+        }
+        // A truncated session (crashed recorder) ends with its last event
+        if (replaying && session_finished(&session_in)) {
+            LOG_WARNING("Drone", "Session ended without an end marker after %u ticks", tick_no);
+            running = false;
+        }
         
         // Sends the current position back to bb
-        snprintf(sOut, sizeof(sOut), "%d,%d", (int)(x_curr), (int)(y_curr));
-        ssize_t w = write(fdToBB, sOut, strlen(sOut) + 1);
-        char msg[256];
-        // Log coordinates with timestamp
-        if (w > 0) {
-            snprintf(msg, 256, "Drone: coordinates %d,%d - write successful", (int)x_curr, (int)y_curr);
-            log_coordinates(msg);
+        ssize_t w;
+        float vx = (x_prev - x_prev2) / T;
+        float vy = (y_prev - y_prev2) / T;
+        if (world != NULL) {
+            world_publish_drone(world, x_curr, y_curr, vx, vy, reset_gen, key_t_in);
+            w = 1;
         } else {
-            snprintf(msg, 256, "Drone: coordinates %d,%d - write failed: %s", (int)x_curr, (int)y_curr, strerror(errno));
-            log_coordinates(msg);
+            w = frame_send_position(&toBB, (int)(x_curr), (int)(y_curr), key_t_in);
+        }
+        // A replay outlives the BlackBoard when the BlackBoard finishes first
+        if (w <= 0 && !replaying) {
+            LOG_ERRNO("Drone", "Failed to send coordinates to the BlackBoard");
             running = false;
         }
-           
-        
-        // Checking alive signal
-        if (mode != 2 || mode !=3){
-            if (health_check) {
-                health_check = 0; // Reset flag
-                kill(watchdog_pid, SIGUSR2); // Send signal back to watchdog
+
+        // Record the tick in the trajectory
+        if (traj_ok) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            TrajRecord rec = {
+                .t_ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec,
+                .x = x_curr, .y = y_curr, .vx = vx, .vy = vy,
+                .cmd_fx = Fx, .cmd_fy = Fy, .rep_fx = rep_fx, .rep_fy = rep_fy,
+                .active_key = active_key, .boost_level = (uint8_t)boost_level,
+                .flags = (w <= 0) ? TRAJ_WRITE_FAILED : 0, .steps = (uint8_t)steps,
+            };
+            if (traj_append(&traj, &rec) == -1) {
+                LOG_ERRNO("Drone", "Trajectory write failed, recording stopped");
+                traj_close(&traj);
+                traj_ok = false;
             }
         }
+           
         
-        
+        if (tick_report_due(&sched, 10000)) {
+            char stats[256];
+            tick_format_stats(&sched, stats, sizeof(stats));
+            LOG_INFO("Drone", "Tick stats: %s", stats);
+            log_latency("");
+        }
+    }
 
-    usleep(10000);
-}
+    char stats[256];
+    tick_format_stats(&sched, stats, sizeof(stats));
+    LOG_INFO("Drone", "Tick stats at exit: %s", stats);
+    log_latency(" at exit");
+    tick_close(&sched);
+    if (traj_ok) traj_close(&traj);
+    if (session_mode == SESSION_RECORD) {
+        session_record(&session_out, tick_no, SESS_END, 0, 0, 0);
+        session_close(&session_out);
+    }
+    if (replaying) session_unload(&session_in);
 
     // Close all file descriptors to signal EOF to parent
     close(fdIn);
     close(fdFromBB);
     close(fdToBB);
     close(fdRepul);
+    world_detach(world);
+    heartbeat_unregister();
     logger_close();
    
 
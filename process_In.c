@@ -10,24 +10,22 @@
 #include <sys/wait.h>
 #include <curses.h>
 #include <sys/time.h>
+#include <time.h>
+#include <ctype.h>
+#include <stdbool.h>
 #include <termios.h>
 #include <signal.h>
 #include <sys/file.h>
 #include "logger.h"
 #include "logger_custom.h"
+#include "ipc_frame.h"
+#include "heartbeat.h"
+#include "latency_hist.h"
 
 
 // sig_atomic_t ensures atomic access during signal handling
-volatile sig_atomic_t health_check = 0;
 volatile sig_atomic_t should_exit = 0;
 
-// Handler for health check signal from watchdog
-void handle_signal(int signo) {
-    if (signo == SIGUSR1) {
-        health_check = 1; // Mark that we received a ping
-    }
-}
-
 //termination handler from master process
 void handle_terminate(int signo) {
     if (signo == SIGTERM) {
@@ -35,15 +33,58 @@ void handle_terminate(int signo) {
     }
 }
 
+// Scripted input for headless mode
+// One "<t_ms> <key>" event per line, t_ms counted from the start of the run;
+// blank lines and '#' comments are skipped. When the script runs out the
+// run is ended with 'q'.
+typedef struct {
+    FILE *file;
+    long start_ms;
+    bool pending;        // Event read but not yet due
+    long t_ms;
+    char key;
+    bool done;
+} Script;
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+// Returns true and the key when the next event is due
+static bool script_next_key(Script *script, char *key) {
+    char line[128];
+    while (!script->pending && !script->done) {
+        if (fgets(line, sizeof(line), script->file) == NULL) {
+            script->done = true;
+            script->pending = true;
+            script->t_ms = 0;
+            script->key = 'q';
+            break;
+        }
+        char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '#' || *p == '\0') continue;
+
+        if (sscanf(p, "%ld %c", &script->t_ms, &script->key) == 2) {
+            script->pending = true;
+        } else {
+            LOG_WARNING("Input", "Ignoring invalid script line: %s", p);
+        }
+    }
+
+    if (!script->pending || now_ms() - script->start_ms < script->t_ms) return false;
+    script->pending = false;
+    *key = script->key;
+    return true;
+}
+
 int main(int argc, char *argv[]) 
 {
 
     // Setup signal handling FIRST
     struct sigaction sa;
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = handle_signal;
-    sigaction(SIGUSR1, &sa, NULL);
-
     memset(&sa, 0, sizeof(sa));
     sa.sa_handler = handle_terminate;
     sigaction(SIGTERM, &sa, NULL);
@@ -53,17 +94,9 @@ int main(int argc, char *argv[])
     logger_init("system.log",0);
     LOG_INFO("Input", "Starting Input Process (PID=%d)", getpid());
     
-    pid_t watchdog_pid = -1;
-    int retries = 0;
-    while (watchdog_pid == -1 && retries < 10) {
-        sleep(1);
-        watchdog_pid = get_pid_by_name("Watchdog");
-        retries++;
-    }
-    
-    if (watchdog_pid == -1) {
-        LOG_ERROR("Input", "Could not find Watchdog! Exiting.");
-        return 1;
+    // Watchdog: one heartbeat per loop (10 ms)
+    if (heartbeat_register("Input", 50) == -1) {
+        LOG_WARNING("Input", "Heartbeat table unavailable, not monitored by the watchdog");
     }
 
     signal(SIGPIPE, SIG_IGN);
@@ -82,30 +115,46 @@ int main(int argc, char *argv[])
     //Convert the argument to an integer file descriptor
     int fdIn = atoi(argv[1]);
     char *path_bb = argv[2];
-    int fdIn_BB = open(path_bb, O_WRONLY);
+    int fdIn_BB = chan_open(path_bb, O_WRONLY);   // Named pipe, or a channel when threaded
     if (fdIn_BB == -1) { 
         LOG_ERRNO("Input", "Failed to open In_BB Pipe");
         return OPEN_FAIL; 
     }
 
+    // Headless mode: keys come from a script instead of the terminal
+    Script script;
+    memset(&script, 0, sizeof(script));
+    if (argc > 3) {
+        script.file = fopen(argv[3], "r");
+        if (script.file == NULL) {
+            LOG_ERRNO("Input", "Failed to open input script");
+            return OPEN_FAIL;
+        }
+        script.start_ms = now_ms();
+        LOG_INFO("Input", "Reading scripted input from %s", argv[3]);
+    }
+
     // Setting up the terminal to read single characters without waiting for Enter
     struct termios old_tio, new_tio;
-    tcgetattr(STDIN_FILENO, &old_tio); 
-    new_tio = old_tio;                 
-
-    // Disable canonical mode (waiting for Enter) and echo
-    new_tio.c_lflag &= ~(ICANON); 
-    new_tio.c_cc[VMIN] = 0;  
-    new_tio.c_cc[VTIME] = 0; 
-    tcsetattr(STDIN_FILENO, TCSANOW, &new_tio); 
-
-    printf("BEGIN GAME!:D\n");
-    printf("Controls: 'w,e,r,f,v,c,x,s' - movement, 'a' - reset position, 'p' - pause, 'u' - unpause, 'q' - quit\n"); 
+    if (script.file == NULL) {
+        tcgetattr(STDIN_FILENO, &old_tio); 
+        new_tio = old_tio;                 
+
+        // Disable canonical mode (waiting for Enter) and echo
+        new_tio.c_lflag &= ~(ICANON); 
+        new_tio.c_cc[VMIN] = 0;  
+        new_tio.c_cc[VTIME] = 0; 
+        tcsetattr(STDIN_FILENO, TCSANOW, &new_tio); 
+
+        printf("BEGIN GAME!:D\n");
+        printf("Controls: 'w,e,r,f,v,c,x,s' - movement, 'a' - reset position, 'p' - pause, 'u' - unpause, 'q' - quit\n"); 
+    }
 
-    // Characters to be written
-    // One is the typed character, the other is the "automatic Enter"
+    // Every key goes to the Drone, the control keys also to the BlackBoard
     char c;
-    char newline = '\n'; 
+    FrameWriter toDrone, toBB;
+    frame_writer_init(&toDrone, fdIn);
+    frame_writer_init(&toBB, fdIn_BB);
 
     while (1) 
     {
@@ -114,45 +163,47 @@ int main(int argc, char *argv[])
             break;
         }
 
-        if (read(STDIN_FILENO, &c, 1) > 0) 
+        bool got_key = (script.file != NULL) ? script_next_key(&script, &c)
+                                             : read(STDIN_FILENO, &c, 1) > 0;
+        if (got_key) 
         {
-            write(fdIn, &c, 1);
+            // Start of the key -> frame latency path, see latency_hist.h
+            uint64_t t_in_us = lat_now_us();
+            frame_send_key(&toDrone, c, t_in_us);
 
             if (c == 'q' || c == 'a' || c == 'p' || c == 'u') {
                 
                 
-                write(fdIn_BB, &c, 1); 
-                write(fdIn_BB, &newline, 1);     
+                frame_send_key(&toBB, c, t_in_us);
                 
                 if (c == 'q') {
                 // --- 3. RESTORE TERMINAL ---
                 // This is critical, or the terminal will be "broken" after
+                heartbeat_idle();
                 sleep(1); // Give some time for the 'q' to be processed
-                tcsetattr(STDIN_FILENO, TCSANOW, &old_tio);
+                if (script.file == NULL) tcsetattr(STDIN_FILENO, TCSANOW, &old_tio);
+                else fclose(script.file);
                 LOG_INFO("Input", "Exiting Input Process from q command.");
                 close(fdIn_BB);
                 close(fdIn);
 
+                heartbeat_unregister();
                 logger_close();
                 exit(EXIT_SUCCESS);
             }
         }
-            // 2. Write the "automatic Enter"
-            write(fdIn, &newline, 1);
                
         }
         
-        // Checking alive signal
-        if (health_check) {
-            health_check = 0; // Reset flag
-            kill(watchdog_pid, SIGUSR2); // Send signal back to watchdog
-        }
+        heartbeat_beat();
         
-        usleep(10000);
+        // Scripted keys that are due together go out back to back
+        if (!got_key || script.file == NULL) usleep(10000);
     }
 
     // Restore the old terminal settings
-    tcsetattr(STDIN_FILENO, TCSANOW, &old_tio);
+    if (script.file == NULL) tcsetattr(STDIN_FILENO, TCSANOW, &old_tio);
+    heartbeat_unregister();
     logger_close();
     return 0;
 }
@@ -14,6 +14,8 @@
 #include <sys/file.h>
 #include "logger.h"
 #include "logger_custom.h"
+#include "ipc_frame.h"
+#include "heartbeat.h"
 
 int window_width;
 int window_height;
@@ -21,16 +23,8 @@ int x_coord_Ob;
 int y_coord_Ob; 
 
 // sig_atomic_t ensures atomic access during signal handling
-volatile sig_atomic_t health_check = 0;
 volatile sig_atomic_t should_exit = 0;
 
-// Handler for health check signal from watchdog
-void handle_signal(int signo) {
-    if (signo == SIGUSR1) {
-        health_check = 1; // Mark that we received a ping
-    }
-}
-
 //termination handler from master process
 void handle_terminate(int signo) {
     if (signo == SIGTERM) {
@@ -67,12 +61,13 @@ void Parameter_File() {
 
         char* tokens[10]; 
         int token_count = 0;
-        char* token = strtok(line, "_");
+        char* save = NULL;
+        char* token = strtok_r(line, "_", &save);
 
         while (token != NULL && token_count < 10) {
             tokens[token_count] = token; 
             token_count++;
-            token = strtok(NULL, "_");
+            token = strtok_r(NULL, "_", &save);
         }
 
         switch (line_number) {
@@ -93,10 +88,6 @@ int main(int argc, char *argv[])
 {
     // Setup signal handling FIRST
     struct sigaction sa;
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = handle_signal;
-    sigaction(SIGUSR1, &sa, NULL);
-
     memset(&sa, 0, sizeof(sa));
     sa.sa_handler = handle_terminate;
     sigaction(SIGTERM, &sa, NULL);
@@ -106,17 +97,9 @@ int main(int argc, char *argv[])
     logger_init("system.log",0);
     LOG_INFO("Obstacles", "Starting Obstacles Process (PID=%d)", getpid());
 
-    pid_t watchdog_pid = -1;
-    int retries = 0;
-    while (watchdog_pid == -1 && retries < 10) {
-        sleep(1);
-        watchdog_pid = get_pid_by_name("Watchdog");
-        retries++;
-    }
-    
-    if (watchdog_pid == -1) {
-        printf("Could not find Watchdog! Exiting.\n");
-        return 1;
+    // Watchdog: one heartbeat per loop (20 ms)
+    if (heartbeat_register("Obstacles", 50) == -1) {
+        LOG_WARNING("Obstacles", "Heartbeat table unavailable, not monitored by the watchdog");
     }
     // Parameter file reading
     Parameter_File();
@@ -129,7 +112,8 @@ int main(int argc, char *argv[])
 
     // Convert the argument to an integer file descriptor
     int fdOb = atoi(argv[1]);
-    char buffer[100];
+    FrameWriter writer;
+    frame_writer_init(&writer, fdOb);
 
     // Obstacle generation every 5 seconds
     const long obstacle_interval_ms = 5000;
@@ -142,11 +126,7 @@ int main(int argc, char *argv[])
             break;
         }
         
-        // Checking alive signal
-        if (health_check) {
-            health_check = 0; // Reset flag
-            kill(watchdog_pid, SIGUSR2); // Send signal back to watchdog
-        }
+        heartbeat_beat();
         
         // Randomly generate obstacle coordinates every 5 seconds
         long now_ms = current_millis();
@@ -154,15 +134,15 @@ int main(int argc, char *argv[])
             x_coord_Ob = 1 + rand() % (window_width - 10);
             y_coord_Ob = 1 + rand() % (window_height - 10);
             last_obstacle_ms = now_ms;
-            sprintf(buffer, "%d,%d", x_coord_Ob, y_coord_Ob);
-            write(fdOb, buffer, strlen(buffer)+1);
+            frame_send_item(&writer, x_coord_Ob, y_coord_Ob);
             LOG_INFO("Obstacles", "Generated new obstacle at (%d, %d)", x_coord_Ob, y_coord_Ob);
         }
-        usleep(100000); // Sleep 100ms to avoid busy-waiting
+        usleep(20000); // Sleep 20ms to avoid busy-waiting, well inside the heartbeat budget
     }
 
     //clean up
     close(fdOb);
+    heartbeat_unregister();
     logger_close();
     return 0;
  
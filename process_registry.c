@@ -0,0 +1,133 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "process_registry.h"
+
+// Names as passed to log_process(), in slot order
+static const char *const registry_names[REG_COUNT] = {
+    [REG_MASTER] = "Master",
+    [REG_BLACKBOARD] = "BlackBoard",
+    [REG_INPUT] = "Input",
+    [REG_DRONE] = "Drone",
+    [REG_OBSTACLES] = "Obstacles",
+    [REG_TARGETS] = "Targets",
+    [REG_WATCHDOG] = "Watchdog",
+    [REG_COMM_SERVER] = "CommServer",
+    [REG_COMM_CLIENT] = "CommClient",
+};
+
+static ProcessRegistry *registry = NULL;   // This process's mapping
+
+static ProcessRegistry* registry_map(int flags) {
+    int fd = shm_open(REGISTRY_SHM_NAME, flags, 0666);
+    if (fd == -1) {
+        perror("shm_open process registry");
+        return NULL;
+    }
+
+    if ((flags & O_CREAT) && ftruncate(fd, sizeof(ProcessRegistry)) == -1) {
+        perror("ftruncate process registry");
+        close(fd);
+        return NULL;
+    }
+
+    void *p = mmap(NULL, sizeof(ProcessRegistry), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the segment alive
+    if (p == MAP_FAILED) {
+        perror("mmap process registry");
+        return NULL;
+    }
+    return (ProcessRegistry *)p;
+}
+
+ProcessRegistry* registry_create(void) {
+    // Drop any registry left over from a crashed run, its PIDs are stale
+    shm_unlink(REGISTRY_SHM_NAME);
+    registry = registry_map(O_CREAT | O_RDWR | O_TRUNC);
+    if (registry != NULL) {
+        memset(registry, 0, sizeof(*registry));
+    }
+    return registry;
+}
+
+void registry_unlink(void) {
+    shm_unlink(REGISTRY_SHM_NAME);
+}
+
+static ProcessRegistry* registry_get(void) {
+    if (registry == NULL) registry = registry_map(O_RDWR);
+    return registry;
+}
+
+int registry_slot(const char *name) {
+    for (int i = 0; i < REG_COUNT; i++) {
+        if (strcmp(registry_names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+int registry_register(const char *name, pid_t pid) {
+    int slot = registry_slot(name);
+    ProcessRegistry *reg = registry_get();
+    if (slot == -1 || reg == NULL) return -1;
+
+    atomic_store(&reg->pids[slot], (int)pid);
+    atomic_fetch_add(&reg->generation, 1);
+    // Shared (non-private) futex: the waiters are other processes
+    syscall(SYS_futex, &reg->generation, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    return 0;
+}
+
+pid_t registry_lookup(const char *name) {
+    int slot = registry_slot(name);
+    ProcessRegistry *reg = registry_get();
+    if (slot == -1 || reg == NULL) return -1;
+
+    int pid = atomic_load(&reg->pids[slot]);
+    return (pid != 0) ? (pid_t)pid : -1;
+}
+
+pid_t registry_wait(const char *name, int timeout_ms) {
+    int slot = registry_slot(name);
+    ProcessRegistry *reg = registry_get();
+    if (slot == -1 || reg == NULL) return -1;
+
+    struct timespec now, deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    for (;;) {
+        // Read the generation first: a registration after the PID check
+        // changes it, and the futex wait then returns at once
+        unsigned gen = atomic_load(&reg->generation);
+        int pid = atomic_load(&reg->pids[slot]);
+        if (pid != 0) return (pid_t)pid;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        struct timespec left = {
+            .tv_sec = deadline.tv_sec - now.tv_sec,
+            .tv_nsec = deadline.tv_nsec - now.tv_nsec
+        };
+        if (left.tv_nsec < 0) {
+            left.tv_sec--;
+            left.tv_nsec += 1000000000L;
+        }
+        if (left.tv_sec < 0) return -1;
+
+        // FUTEX_WAIT takes a relative timeout; on a wake, EAGAIN, EINTR or
+        // ETIMEDOUT the loop re-checks the slot and the deadline
+        syscall(SYS_futex, &reg->generation, FUTEX_WAIT, gen, &left, NULL, 0);
+    }
+}
@@ -0,0 +1,54 @@
+// process_registry.h
+#ifndef PROCESS_REGISTRY_H
+#define PROCESS_REGISTRY_H
+
+#include <stdatomic.h>
+#include <sys/types.h>
+
+// Shared-memory process registry
+// Master creates one segment with a fixed slot per process name (Master,
+// BlackBoard, Input, ...). A process publishes its PID with one atomic store
+// into its own slot, so a lookup is a name -> slot match over a constant
+// table and one atomic load, with no file to open or parse. Every
+// registration bumps a generation counter and wakes it as a futex:
+// registry_wait() sleeps in the kernel until the process it wants appears
+// (or the timeout runs out) instead of polling.
+
+#define REGISTRY_SHM_NAME "/arp_registry"
+#define REGISTRY_TIMEOUT_MS 10000   // Master's wait for a process started in konsole
+
+enum {
+    REG_MASTER,
+    REG_BLACKBOARD,
+    REG_INPUT,
+    REG_DRONE,
+    REG_OBSTACLES,
+    REG_TARGETS,
+    REG_WATCHDOG,
+    REG_COMM_SERVER,
+    REG_COMM_CLIENT,
+    REG_COUNT
+};
+
+typedef struct {
+    atomic_uint generation;          // Futex word, bumped on every registration
+    atomic_int pids[REG_COUNT];      // 0 = not registered (yet)
+} ProcessRegistry;
+
+// Segment lifetime: Master creates/unlinks, the other processes attach on
+// their first registry call
+ProcessRegistry* registry_create(void);
+void registry_unlink(void);
+
+// Slot of a process name ("BlackBoard", "Input", ...), -1 if unknown
+int registry_slot(const char *name);
+
+// Publish pid under name and wake the waiters; -1 if the name is unknown or
+// the registry is unavailable
+int registry_register(const char *name, pid_t pid);
+// PID registered under name, -1 if there is none
+pid_t registry_lookup(const char *name);
+// Block until name is registered; -1 after timeout_ms
+pid_t registry_wait(const char *name, int timeout_ms);
+
+#endif
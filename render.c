@@ -0,0 +1,294 @@
+#define _XOPEN_SOURCE_EXTENDED
+#include <fcntl.h>
+#include <locale.h>
+#include <ncurses.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "render.h"
+
+// One map cell: what is (front) or should be (back) on the terminal
+typedef struct {
+    char glyph[8];               // UTF-8, NUL padded so cells compare with memcmp
+    short pair;
+    short bold;
+} Cell;
+
+static RenderMode render_mode = RENDER_HEADLESS;
+static WINDOW *win = NULL;
+static bool colors_enabled = false;
+
+static int io_fd = -1;           // /proc/thread-self/io of the drawing thread
+
+static Cell *front = NULL;       // Last frame sent to ncurses
+static Cell *back = NULL;        // Frame being drawn
+static int cells_w = 0, cells_h = 0;
+
+static uint64_t frame_ns = 0;    // Minimum time between presents, 0 = no cap
+static uint64_t last_present_ns = 0;
+
+// Counters for render_format_stats()
+static uint64_t frames_shown = 0, frames_dropped = 0, cells_updated = 0;
+static uint64_t tty_bytes = 0;
+static uint64_t window_bytes = 0, window_start_ns = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Bytes this thread has passed to write() so far. ncurses writes to the
+// tty with plain write() calls, so the difference across a refresh is
+// exactly what that refresh sent to the terminal.
+static uint64_t thread_wchar(void) {
+    char buf[256];
+    if (io_fd == -1) return 0;
+    ssize_t n = pread(io_fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return 0;
+    buf[n] = '\0';
+    char *p = strstr(buf, "wchar:");
+    return (p != NULL) ? strtoull(p + 6, NULL, 10) : 0;
+}
+
+static void count_tty_bytes(uint64_t wchar_before) {
+    uint64_t n = thread_wchar() - wchar_before;
+    tty_bytes += n;
+    window_bytes += n;
+}
+
+static const Cell blank_cell = { " ", 0, 0 };
+
+static void cells_fill(Cell *cells) {
+    for (int i = 0; i < cells_w * cells_h; i++) cells[i] = blank_cell;
+}
+
+// (Re)allocate both buffers for a w x h window, both blank like the window
+static void cells_resize(int w, int h) {
+    Cell *f = realloc(front, sizeof(Cell) * (size_t)w * (size_t)h);
+    if (f != NULL) front = f;
+    Cell *b = realloc(back, sizeof(Cell) * (size_t)w * (size_t)h);
+    if (b != NULL) back = b;
+    if (f == NULL || b == NULL) {
+        // Out of memory: draw calls become no-ops until the next resize
+        cells_w = cells_h = 0;
+        return;
+    }
+    cells_w = w;
+    cells_h = h;
+    cells_fill(front);
+    cells_fill(back);
+}
+
+static void draw_border(void) {
+    if (colors_enabled) {
+        wattron(win, COLOR_PAIR(RENDER_BORDER));
+        box(win, 0, 0);
+        wattroff(win, COLOR_PAIR(RENDER_BORDER));
+    } else {
+        box(win, 0, 0);
+    }
+}
+
+static void layout_and_draw(int *ww, int *wh) {
+    int H, W;
+    getmaxyx(stdscr, H, W);
+
+    // Window with fixed margin
+    *wh = (H > 6) ? H - 6 : H;
+    *ww = (W > 10) ? W - 10 : W;
+    if (*wh < 3) *wh = 3;
+    if (*ww < 3) *ww = 3;
+
+    // Resize and recenter window
+    wresize(win, *wh, *ww);
+    mvwin(win, (H - *wh) / 2, (W - *ww) / 2);
+
+    // Clean up and draw again
+    werase(stdscr);
+    werase(win);
+    draw_border();
+    cells_resize(*ww, *wh);
+
+    uint64_t before = thread_wchar();
+    refresh();
+    wrefresh(win);
+    count_tty_bytes(before);
+}
+
+void render_init(RenderMode mode, int want_w, int want_h, int *ww, int *wh) {
+    render_mode = mode;
+    if (mode == RENDER_HEADLESS) {
+        *ww = want_w;
+        *wh = want_h;
+        return;
+    }
+
+    setlocale(LC_ALL, "");
+
+    // Without /proc the tty byte counters stay at 0
+    io_fd = open("/proc/thread-self/io", O_RDONLY | O_CLOEXEC);
+    window_start_ns = now_ns();
+
+    initscr();
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+    (void)curs_set(0);
+    if (has_colors()) {
+        start_color();
+        use_default_colors();
+        init_pair(RENDER_DRONE, COLOR_CYAN, -1);
+        init_pair(RENDER_TARGET, COLOR_GREEN, -1);
+        init_pair(RENDER_OBSTACLE, COLOR_RED, -1);
+        init_pair(RENDER_BORDER, COLOR_BLUE, -1);
+        colors_enabled = true;
+    }
+
+    int term_h, term_w;
+    getmaxyx(stdscr, term_h, term_w);
+    // Parameter file values clamped to terminal size
+    int win_h = (want_h > 0) ? want_h : term_h;
+    int win_w = (want_w > 0) ? want_w : term_w;
+    if (win_h > term_h) win_h = term_h;
+    if (win_w > term_w) win_w = term_w;
+
+    win = newwin(win_w, win_h, 0, 0);
+    layout_and_draw(ww, wh);
+    // Allow window to report keys / KEY_RESIZE without blocking
+    keypad(win, TRUE);
+    wtimeout(win, 0); // never block in wgetch, the tick scheduler paces the loop
+}
+
+bool render_poll_resize(int *ww, int *wh) {
+    if (render_mode == RENDER_HEADLESS) return false;
+
+    int ch = wgetch(win); // poll window for keys (returns KEY_RESIZE)
+    if (ch != KEY_RESIZE) return false;
+
+    // Update ncurses internal structures for new dimensions
+    resize_term(0, 0);
+    layout_and_draw(ww, wh);
+    return true;
+}
+
+void render_clear(void) {
+    if (render_mode == RENDER_HEADLESS) return;
+    cells_fill(back);
+}
+
+void render_glyph(int y, int x, int pair, bool bold, const char *glyph) {
+    if (render_mode == RENDER_HEADLESS) return;
+    if (x < 0 || y < 0 || x >= cells_w || y >= cells_h) return;
+    Cell *c = &back[y * cells_w + x];
+    strncpy(c->glyph, glyph, sizeof(c->glyph) - 1);
+    c->glyph[sizeof(c->glyph) - 1] = '\0';
+    c->pair = (short)pair;
+    c->bold = bold;
+}
+
+void render_text(int y, int x, const char *text) {
+    if (render_mode == RENDER_HEADLESS) return;
+    char glyph[2] = { 0, 0 };
+    for (; *text != '\0' && x < cells_w; text++, x++) {
+        glyph[0] = *text;
+        render_glyph(y, x, 0, false, glyph);
+    }
+}
+
+static bool on_border(int y, int x) {
+    return x == 0 || y == 0 || x == cells_w - 1 || y == cells_h - 1;
+}
+
+static void put_cell(int y, int x, const Cell *c) {
+    attr_t attrs = (c->pair > 0 ? COLOR_PAIR(c->pair) : 0) | (c->bold ? A_BOLD : 0);
+    wattron(win, attrs);
+    mvwaddstr(win, y, x, c->glyph);
+    wattroff(win, attrs);
+}
+
+// Send the cells that differ from the previous frame
+static void present_changes(void) {
+    bool border_touched = false;
+    uint64_t changed = 0;
+
+    for (int y = 0; y < cells_h; y++) {
+        for (int x = 0; x < cells_w; x++) {
+            int i = y * cells_w + x;
+            if (memcmp(&front[i], &back[i], sizeof(Cell)) == 0) continue;
+            front[i] = back[i];
+            changed++;
+            // A blank border cell shows the border, redrawn below
+            if (on_border(y, x)) border_touched = true;
+            else put_cell(y, x, &back[i]);
+        }
+    }
+
+    if (border_touched) {
+        draw_border();
+        for (int y = 0; y < cells_h; y++) {
+            for (int x = 0; x < cells_w; x++) {
+                const Cell *c = &back[y * cells_w + x];
+                if (on_border(y, x) && memcmp(c, &blank_cell, sizeof(Cell)) != 0) put_cell(y, x, c);
+            }
+        }
+    }
+
+    frames_shown++;
+    cells_updated += changed;
+    // Nothing moved: no refresh, nothing written to the tty
+    if (changed > 0) {
+        uint64_t before = thread_wchar();
+        wrefresh(win);
+        count_tty_bytes(before);
+    }
+}
+
+bool render_present(void) {
+    if (render_mode == RENDER_HEADLESS) return false;
+    uint64_t now = now_ns();
+    if (frame_ns > 0 && last_present_ns != 0 && now - last_present_ns < frame_ns) {
+        frames_dropped++;
+        return false;
+    }
+    last_present_ns = now;
+    present_changes();
+    return true;
+}
+
+void render_flush(void) {
+    if (render_mode == RENDER_HEADLESS) return;
+    last_present_ns = now_ns();
+    present_changes();
+}
+
+void render_set_max_fps(int fps) {
+    // A little slack so a cap equal to the tick rate does not drop frames to jitter
+    frame_ns = (fps > 0) ? 1000000000ULL / (uint64_t)fps * 9 / 10 : 0;
+}
+
+void render_format_stats(char *buf, size_t len) {
+    uint64_t now = now_ns();
+    double secs = (window_start_ns != 0 && now > window_start_ns) ? (now - window_start_ns) / 1e9 : 0;
+    snprintf(buf, len, "%llu frames shown, %llu dropped, %llu cells updated, %llu tty bytes (%.0f B/s)",
+             (unsigned long long)frames_shown, (unsigned long long)frames_dropped,
+             (unsigned long long)cells_updated, (unsigned long long)tty_bytes,
+             secs > 0 ? window_bytes / secs : 0.0);
+    window_bytes = 0;
+    window_start_ns = now;
+}
+
+void render_close(void) {
+    if (render_mode == RENDER_HEADLESS) return;
+    delwin(win);
+    endwin();
+    if (io_fd != -1) close(io_fd);
+    io_fd = -1;
+    free(front);
+    free(back);
+    front = back = NULL;
+    cells_w = cells_h = 0;
+}
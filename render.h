@@ -0,0 +1,54 @@
+// render.h
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Drawing backend for the BlackBoard
+// RENDER_CURSES draws the map in a boxed ncurses window. RENDER_HEADLESS
+// accepts the same calls and draws nothing, so the BlackBoard logic runs
+// without a terminal (CI machines, throughput measurements).
+//
+// In curses mode a frame is composed in an off-screen cell buffer and
+// render_present() compares it with the previous frame: only the cells that
+// changed are sent to ncurses, and a frame with no change writes nothing.
+// Presents are capped to a frame rate independent of the simulation tick
+// (frames in between are dropped, the next present shows the latest one).
+// The bytes each refresh writes to the tty are counted (from the thread's
+// write() total in /proc), so the terminal bandwidth can be logged.
+
+typedef enum {
+    RENDER_CURSES,
+    RENDER_HEADLESS
+} RenderMode;
+
+// Colour pairs
+#define RENDER_DRONE    1
+#define RENDER_TARGET   2
+#define RENDER_OBSTACLE 3
+#define RENDER_BORDER   4
+
+// Set up the backend and report the map size in *ww x *wh.
+// Curses fits the map in the terminal, headless uses want_w x want_h as is.
+void render_init(RenderMode mode, int want_w, int want_h, int *ww, int *wh);
+
+// Poll the window (waits up to 50 ms in curses mode, never in headless mode).
+// Returns true if the terminal was resized; *ww and *wh are then updated.
+bool render_poll_resize(int *ww, int *wh);
+
+void render_clear(void);                                           // Blank map + border
+void render_glyph(int y, int x, int pair, bool bold, const char *glyph);
+void render_text(int y, int x, const char *text);
+bool render_present(void);                     // Show what was drawn; false if the cap dropped it
+void render_flush(void);                       // Show it now, ignoring the cap
+void render_close(void);
+
+// Most frames per second sent to the terminal, 0 = every present
+void render_set_max_fps(int fps);
+
+// Frames shown/dropped, cells updated and tty bytes (total and per second
+// since the previous call) in human-readable form
+void render_format_stats(char *buf, size_t len);
+
+#endif
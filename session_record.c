@@ -0,0 +1,141 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "session_record.h"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// write() until everything is out
+static int write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static bool header_ok(const SessionHeader *hdr) {
+    return memcmp(hdr->magic, SESSION_MAGIC, sizeof(hdr->magic)) == 0 &&
+           hdr->version == SESSION_VERSION && hdr->event_size == sizeof(SessionEvent);
+}
+
+int session_create(const char *path, const SessionHeader *hdr) {
+    SessionHeader h = *hdr;
+    memcpy(h.magic, SESSION_MAGIC, sizeof(h.magic));
+    h.version = SESSION_VERSION;
+    h.event_size = sizeof(SessionEvent);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) return -1;
+    int ret = write_all(fd, &h, sizeof(h));
+    close(fd);
+    return ret;
+}
+
+int session_read_header(const char *path, SessionHeader *hdr) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+    ssize_t n = read(fd, hdr, sizeof(*hdr));
+    close(fd);
+    if (n != (ssize_t)sizeof(*hdr) || !header_ok(hdr)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+int session_open(SessionWriter *w, const char *path, uint8_t source) {
+    memset(w, 0, sizeof(*w));
+    w->source = source;
+    // Both processes append to the same file, one whole batch per write()
+    w->fd = open(path, O_WRONLY | O_APPEND | O_CLOEXEC);
+    return (w->fd == -1) ? -1 : 0;
+}
+
+void session_record(SessionWriter *w, uint32_t tick, uint8_t type, int id, float a, float b) {
+    if (w->fd == -1) return;
+    if (w->count == SESSION_BATCH) session_flush(w);
+    SessionEvent *ev = &w->buf[w->count++];
+    ev->t_ns = now_ns();
+    ev->tick = tick;
+    ev->source = w->source;
+    ev->type = type;
+    ev->id = (int16_t)id;
+    ev->a = a;
+    ev->b = b;
+}
+
+int session_flush(SessionWriter *w) {
+    if (w->fd == -1 || w->count == 0) return 0;
+    int ret = write_all(w->fd, w->buf, sizeof(SessionEvent) * (size_t)w->count);
+    w->count = 0;
+    return ret;
+}
+
+void session_close(SessionWriter *w) {
+    if (w->fd == -1) return;
+    session_flush(w);
+    close(w->fd);
+    w->fd = -1;
+}
+
+int session_load(SessionReader *r, const char *path, uint8_t source) {
+    memset(r, 0, sizeof(*r));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || read(fd, &r->hdr, sizeof(r->hdr)) != (ssize_t)sizeof(r->hdr) ||
+        !header_ok(&r->hdr)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Upper bound: every event in the file belongs to this source
+    size_t total = ((size_t)st.st_size - sizeof(r->hdr)) / sizeof(SessionEvent);
+    r->events = malloc(sizeof(SessionEvent) * (total > 0 ? total : 1));
+    if (r->events == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    SessionEvent batch[SESSION_BATCH];
+    ssize_t n;
+    while ((n = read(fd, batch, sizeof(batch))) > 0) {
+        // A partial event at the end (crashed writer) is dropped
+        for (size_t i = 0; i < (size_t)n / sizeof(SessionEvent) && r->count < total; i++) {
+            if (batch[i].source == source) r->events[r->count++] = batch[i];
+        }
+        if ((size_t)n % sizeof(SessionEvent) != 0) break;
+    }
+    close(fd);
+    return 0;
+}
+
+bool session_next(SessionReader *r, uint32_t tick, SessionEvent *ev) {
+    if (r->next >= r->count || r->events[r->next].tick > tick) return false;
+    *ev = r->events[r->next++];
+    return true;
+}
+
+bool session_finished(const SessionReader *r) {
+    return r->next >= r->count;
+}
+
+void session_unload(SessionReader *r) {
+    free(r->events);
+    memset(r, 0, sizeof(*r));
+}
@@ -0,0 +1,98 @@
+// session_record.h
+#ifndef SESSION_RECORD_H
+#define SESSION_RECORD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Session recording and replay
+// A session file holds every input the BlackBoard and the Drone consumed:
+// keys, obstacles, targets and remote drones on the BlackBoard side; keys,
+// position resets, repulsion and catch-up steps on the Drone side. Each event
+// is stamped with the tick of the process that consumed it. main writes the
+// header (mode and dynamics parameters), then both processes append
+// fixed-size events to the same file (O_APPEND, at most one write per tick).
+// On replay each process loads only its own events and injects them at the
+// same ticks through the same code paths. The Drone therefore integrates the
+// same forces for the same number of steps, and its trajectory is reproduced
+// bit for bit whether the replay runs at 1x or unpaced.
+
+#define SESSION_MAGIC   "ARPSESS1"
+#define SESSION_VERSION 1
+#define SESSION_BATCH   256      // Events buffered before a write
+
+// Process argument: what to do with the session file
+enum { SESSION_OFF, SESSION_RECORD, SESSION_REPLAY, SESSION_REPLAY_FAST };
+
+// Event source
+enum { SESSION_BB = 1, SESSION_DRONE = 2 };
+
+// Event types
+enum {
+    SESS_KEY = 1,                // id = key
+    SESS_OBSTACLE,               // a, b = cell, as stored in the current window
+    SESS_TARGET,
+    SESS_REMOTE,                 // id = remote drone, a, b = position
+    SESS_REMOTE_DEL,             // id = remote drone
+    SESS_RESET,                  // a, b = position set by the BlackBoard
+    SESS_FORCE,                  // a, b = net repulsion applied
+    SESS_STEPS,                  // id = physics steps run (only recorded when != 1)
+    SESS_END,                    // Recording stopped before this tick
+    SESS_REMOTE_VEL              // id = remote drone, a, b = velocity; precedes its SESS_REMOTE
+};
+
+typedef struct __attribute__((packed)) {
+    char magic[8];
+    uint32_t version;
+    uint32_t event_size;         // sizeof(SessionEvent) of the writer
+    int32_t mode;                // 1 standalone, 2 server, 3 client
+    int32_t tick_ms;             // Parameter file values of the recorded run
+    int32_t force;
+    int32_t mass;
+    int32_t k;
+    int32_t reserved;
+} SessionHeader;
+
+typedef struct __attribute__((packed)) {
+    uint64_t t_ns;               // CLOCK_MONOTONIC when recorded
+    uint32_t tick;
+    uint8_t source;              // SESSION_BB / SESSION_DRONE
+    uint8_t type;                // SESS_*
+    int16_t id;
+    float a, b;
+} SessionEvent;
+
+typedef struct {
+    int fd;
+    uint8_t source;
+    int count;                   // Buffered events
+    SessionEvent buf[SESSION_BATCH];
+} SessionWriter;
+
+typedef struct {
+    SessionHeader hdr;
+    SessionEvent *events;        // This source's events, in tick order
+    size_t count;
+    size_t next;
+} SessionReader;
+
+// main: create (truncate) path with the header; -1 with errno set on failure
+int session_create(const char *path, const SessionHeader *hdr);
+// Read and check the header; -1 if the file is missing or not a session
+int session_read_header(const char *path, SessionHeader *hdr);
+
+// Recording side; events are buffered until session_flush()
+int session_open(SessionWriter *w, const char *path, uint8_t source);
+void session_record(SessionWriter *w, uint32_t tick, uint8_t type, int id, float a, float b);
+int session_flush(SessionWriter *w);
+void session_close(SessionWriter *w);
+
+// Replay side: load the events of one source
+int session_load(SessionReader *r, const char *path, uint8_t source);
+// Next event recorded at or before tick, false when there is none left for it
+bool session_next(SessionReader *r, uint32_t tick, SessionEvent *ev);
+bool session_finished(const SessionReader *r);
+void session_unload(SessionReader *r);
+
+#endif
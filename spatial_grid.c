@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "spatial_grid.h"
+
+static int clamp(int v, int lo, int hi) {
+    if (v < lo) return lo;
+    if (v > hi) return hi;
+    return v;
+}
+
+static int cell_index(const SpatialGrid *g, int x, int y) {
+    return clamp(y, 0, g->h - 1) * g->w + clamp(x, 0, g->w - 1);
+}
+
+static void link_cell(SpatialGrid *g, int id) {
+    GridItem *it = &g->items[id];
+    it->cell = cell_index(g, it->x, it->y);
+    it->prev = -1;
+    it->next = g->cells[it->cell];
+    if (it->next != -1) g->items[it->next].prev = id;
+    g->cells[it->cell] = id;
+}
+
+static void unlink_cell(SpatialGrid *g, int id) {
+    GridItem *it = &g->items[id];
+    if (it->prev != -1) g->items[it->prev].next = it->next;
+    else g->cells[it->cell] = it->next;
+    if (it->next != -1) g->items[it->next].prev = it->prev;
+}
+
+static int alloc_cells(SpatialGrid *g, int w, int h) {
+    if (w < 1) w = 1;
+    if (h < 1) h = 1;
+    int *cells = malloc(sizeof(int) * (size_t)w * (size_t)h);
+    if (cells == NULL) return -1;
+    memset(cells, 0xff, sizeof(int) * (size_t)w * (size_t)h);   // All -1
+    free(g->cells);
+    g->cells = cells;
+    g->w = w;
+    g->h = h;
+    return 0;
+}
+
+int grid_init(SpatialGrid *g, int w, int h, int capacity) {
+    memset(g, 0, sizeof(*g));
+    g->items = calloc((size_t)capacity, sizeof(GridItem));
+    if (g->items == NULL || alloc_cells(g, w, h) == -1) {
+        grid_free(g);
+        return -1;
+    }
+    g->capacity = capacity;
+    g->oldest = g->newest = -1;
+
+    // Every item starts on the free list
+    for (int i = 0; i < capacity; i++) g->items[i].next = i + 1;
+    g->items[capacity - 1].next = -1;
+    g->free_head = 0;
+    return 0;
+}
+
+void grid_free(SpatialGrid *g) {
+    free(g->cells);
+    free(g->items);
+    g->cells = NULL;
+    g->items = NULL;
+    g->count = 0;
+}
+
+int grid_insert(SpatialGrid *g, int x, int y) {
+    if (g->free_head == -1) return -1;
+    int id = g->free_head;
+    GridItem *it = &g->items[id];
+    g->free_head = it->next;
+
+    it->x = x;
+    it->y = y;
+    it->used = true;
+    link_cell(g, id);
+
+    // Append to the insertion order
+    it->older = g->newest;
+    it->newer = -1;
+    if (g->newest != -1) g->items[g->newest].newer = id;
+    else g->oldest = id;
+    g->newest = id;
+
+    g->count++;
+    return id;
+}
+
+void grid_remove(SpatialGrid *g, int id) {
+    if (id < 0 || id >= g->capacity || !g->items[id].used) return;
+    GridItem *it = &g->items[id];
+    unlink_cell(g, id);
+
+    if (it->older != -1) g->items[it->older].newer = it->newer;
+    else g->oldest = it->newer;
+    if (it->newer != -1) g->items[it->newer].older = it->older;
+    else g->newest = it->older;
+
+    it->used = false;
+    it->next = g->free_head;
+    g->free_head = id;
+    g->count--;
+}
+
+int grid_resize(SpatialGrid *g, int w, int h) {
+    if (alloc_cells(g, w, h) == -1) return -1;
+    for (int id = g->oldest; id != -1; id = g->items[id].newer) link_cell(g, id);
+    return 0;
+}
+
+int grid_cell_first(const SpatialGrid *g, int x, int y) {
+    if (x < 0 || x >= g->w || y < 0 || y >= g->h) return -1;
+    return g->cells[y * g->w + x];
+}
+
+int grid_query(const SpatialGrid *g, float cx, float cy, float r, int *ids, int max_ids) {
+    int x0 = clamp((int)floorf(cx - r), 0, g->w - 1);
+    int x1 = clamp((int)ceilf(cx + r), 0, g->w - 1);
+    int y0 = clamp((int)floorf(cy - r), 0, g->h - 1);
+    int y1 = clamp((int)ceilf(cy + r), 0, g->h - 1);
+    float r2 = r * r;
+    int n = 0;
+
+    for (int y = y0; y <= y1; y++) {
+        const int *row = &g->cells[y * g->w];
+        for (int x = x0; x <= x1; x++) {
+            for (int id = row[x]; id != -1; id = g->items[id].next) {
+                float dx = g->items[id].x - cx;
+                float dy = g->items[id].y - cy;
+                if (dx * dx + dy * dy >= r2) continue;
+                if (n == max_ids) return n;
+                ids[n++] = id;
+            }
+        }
+    }
+    return n;
+}
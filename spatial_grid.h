@@ -0,0 +1,53 @@
+// spatial_grid.h
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <stdbool.h>
+
+// Uniform grid over the window cells
+// Every item is stored in a pool and linked into the list of the cell it sits
+// on, plus a second list in insertion order (oldest first) so the owner can
+// evict the oldest item when the pool is full. Both lists are doubly linked
+// by index, so insert and remove are O(1) and nothing is ever moved with
+// memmove. Looking up a cell is one array access; a radius query only visits
+// the cells of the bounding box around the centre, so its cost depends on
+// the radius and on how crowded those cells are, not on the total count.
+
+typedef struct {
+    int x, y;
+    int cell;              // Index into cells[] this item is linked into
+    int prev, next;        // Same cell, -1 = none
+    int older, newer;      // Insertion order, -1 = none
+    bool used;
+} GridItem;
+
+typedef struct {
+    int w, h;              // Cells
+    int *cells;            // w * h list heads, -1 = empty
+    GridItem *items;
+    int capacity;
+    int count;
+    int free_head;         // Unused items, chained through next
+    int oldest, newest;
+} SpatialGrid;
+
+// Allocate a w x h grid that holds up to capacity items; -1 on allocation failure
+int grid_init(SpatialGrid *g, int w, int h, int capacity);
+void grid_free(SpatialGrid *g);
+
+// Add an item at (x, y), clamped into the grid. Returns its id, -1 when full.
+int grid_insert(SpatialGrid *g, int x, int y);
+void grid_remove(SpatialGrid *g, int id);
+
+// Change the grid size and re-bucket every item. Callers that rescale
+// coordinates write items[id].x/y first, then call this.
+int grid_resize(SpatialGrid *g, int w, int h);
+
+// First item linked into cell (x, y), -1 when empty or outside the grid.
+// Walk the rest with items[id].next.
+int grid_cell_first(const SpatialGrid *g, int x, int y);
+
+// Ids of the items within r of (cx, cy), at most max_ids. Returns how many.
+int grid_query(const SpatialGrid *g, float cx, float cy, float r, int *ids, int max_ids);
+
+#endif
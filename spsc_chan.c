@@ -0,0 +1,203 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "spsc_chan.h"
+
+// Filled by the runtime before the component threads start, read-only after
+// that except for the claimed/nonblock flags of each component's own ends
+static ChanEnd ends[CHAN_MAX_ENDS];
+static int end_count = 0;
+
+static size_t ring_used(SpscChan *c) {
+    return atomic_load(&c->tail) - atomic_load(&c->head);
+}
+
+// Writer only: copy len bytes in, all or nothing
+static bool ring_push(SpscChan *c, const void *buf, size_t len) {
+    size_t tail = atomic_load_explicit(&c->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&c->head, memory_order_acquire);
+    if (CHAN_RING_SIZE - (tail - head) < len) return false;
+
+    size_t at = tail & (CHAN_RING_SIZE - 1);
+    size_t first = CHAN_RING_SIZE - at;
+    if (first > len) first = len;
+    memcpy(c->ring + at, buf, first);
+    memcpy(c->ring, (const unsigned char *)buf + first, len - first);
+    atomic_store(&c->tail, tail + len);
+    return true;
+}
+
+// Reader only: take up to len bytes
+static size_t ring_pop(SpscChan *c, void *buf, size_t len) {
+    size_t head = atomic_load_explicit(&c->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&c->tail, memory_order_acquire);
+    size_t n = tail - head;
+    if (n > len) n = len;
+    if (n == 0) return 0;
+
+    size_t at = head & (CHAN_RING_SIZE - 1);
+    size_t first = CHAN_RING_SIZE - at;
+    if (first > n) first = n;
+    memcpy(buf, c->ring + at, first);
+    memcpy((unsigned char *)buf + first, c->ring, n - first);
+    atomic_store(&c->head, head + n);
+    return n;
+}
+
+// Reader, after a pop: clear data_fd once the ring is empty so epoll stops
+// reporting it. Data pushed (or EOF signalled) between the check and the
+// read would lose its wakeup, so look again and re-arm.
+static void settle_data(SpscChan *c) {
+    if (ring_used(c) > 0 || atomic_load(&c->writer_closed)) return;
+    eventfd_t v;
+    eventfd_read(c->data_fd, &v);
+    if (ring_used(c) > 0 || atomic_load(&c->writer_closed)) eventfd_write(c->data_fd, 1);
+}
+
+SpscChan* chan_create(int reader_owner, int writer_owner, bool nonblock, int *rfd, int *wfd) {
+    if (end_count + 2 > CHAN_MAX_ENDS) {
+        errno = ENFILE;
+        return NULL;
+    }
+    SpscChan *c = aligned_alloc(64, sizeof(SpscChan));
+    if (c == NULL) return NULL;
+    memset(c, 0, sizeof(*c));
+
+    c->data_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    c->space_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    // The components get their own numbers, so closing one never closes ours
+    *rfd = (c->data_fd == -1) ? -1 : fcntl(c->data_fd, F_DUPFD_CLOEXEC, 0);
+    *wfd = (c->space_fd == -1) ? -1 : fcntl(c->space_fd, F_DUPFD_CLOEXEC, 0);
+    if (*rfd == -1 || *wfd == -1) {
+        int saved = errno;
+        if (*rfd != -1) close(*rfd);
+        if (*wfd != -1) close(*wfd);
+        if (c->data_fd != -1) close(c->data_fd);
+        if (c->space_fd != -1) close(c->space_fd);
+        free(c);
+        errno = saved;
+        return NULL;
+    }
+
+    ends[end_count++] = (ChanEnd){ c, *rfd, false, nonblock, reader_owner, false };
+    ends[end_count++] = (ChanEnd){ c, *wfd, true, nonblock, writer_owner, false };
+    return c;
+}
+
+void chan_close_owner(int owner) {
+    for (int i = 0; i < end_count; i++) {
+        ChanEnd *e = &ends[i];
+        if (e->owner != owner) continue;
+        if (e->writer) {
+            atomic_store(&e->chan->writer_closed, true);
+            eventfd_write(e->chan->data_fd, 1);
+        } else {
+            atomic_store(&e->chan->reader_closed, true);
+            eventfd_write(e->chan->space_fd, 1);
+        }
+    }
+}
+
+void chan_destroy_all(void) {
+    // Each channel has its reader end at an even index, its writer next to it
+    for (int i = 0; i < end_count; i += 2) {
+        SpscChan *c = ends[i].chan;
+        close(c->data_fd);
+        close(c->space_fd);
+        free(c);
+    }
+    memset(ends, 0, sizeof(ends));
+    end_count = 0;
+}
+
+static ChanEnd* find_end(int fd) {
+    for (int i = 0; i < end_count; i++) {
+        if (ends[i].fd == fd && !ends[i].claimed) return &ends[i];
+    }
+    return NULL;
+}
+
+ChanEnd* chan_claim(int fd) {
+    ChanEnd *e = find_end(fd);
+    if (e != NULL) e->claimed = true;
+    return e;
+}
+
+int chan_open(const char *path, int flags) {
+    if (strncmp(path, "chan:", 5) != 0) return open(path, flags);
+
+    ChanEnd *e = find_end(atoi(path + 5));
+    if (e == NULL || e->writer != ((flags & O_ACCMODE) == O_WRONLY)) {
+        errno = ENOENT;
+        return -1;
+    }
+    e->nonblock = (flags & O_NONBLOCK) != 0;
+    return e->fd;
+}
+
+ssize_t chan_read(ChanEnd *end, void *buf, size_t len) {
+    SpscChan *c = end->chan;
+    bool drained = false;
+    for (;;) {
+        size_t n = ring_pop(c, buf, len);
+        if (n > 0) {
+            settle_data(c);
+            if (atomic_load(&c->writer_waiting)) eventfd_write(c->space_fd, 1);
+            return (ssize_t)n;
+        }
+        // Everything written before the close is visible by now
+        if (atomic_load(&c->writer_closed)) return (ssize_t)ring_pop(c, buf, len);
+
+        // A pending count means data may have raced in: look once more.
+        // Finding nothing after that was a stale wakeup, not a reason to block.
+        eventfd_t v;
+        if (eventfd_read(c->data_fd, &v) == 0) {
+            drained = true;
+            continue;
+        }
+        if (drained || end->nonblock) {
+            errno = EAGAIN;
+            return -1;
+        }
+        struct pollfd p = { c->data_fd, POLLIN, 0 };
+        if (poll(&p, 1, -1) == -1 && errno != EINTR) return -1;
+    }
+}
+
+ssize_t chan_write(ChanEnd *end, const void *buf, size_t len) {
+    SpscChan *c = end->chan;
+    if (len > CHAN_RING_SIZE) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    for (;;) {
+        if (atomic_load(&c->reader_closed)) {
+            errno = EPIPE;
+            return -1;
+        }
+        if (ring_push(c, buf, len)) {
+            eventfd_write(c->data_fd, 1);
+            return (ssize_t)len;
+        }
+        if (end->nonblock) {
+            errno = EAGAIN;
+            return -1;
+        }
+
+        // Full: park until the reader frees space. The flag is set before
+        // the last check, so a pop in between always sees it and kicks us.
+        atomic_store(&c->writer_waiting, true);
+        if (CHAN_RING_SIZE - ring_used(c) < len && !atomic_load(&c->reader_closed)) {
+            struct pollfd p = { c->space_fd, POLLIN, 0 };
+            poll(&p, 1, -1);
+        }
+        eventfd_t v;
+        eventfd_read(c->space_fd, &v);
+        atomic_store(&c->writer_waiting, false);
+    }
+}
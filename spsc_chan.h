@@ -0,0 +1,64 @@
+// spsc_chan.h
+#ifndef SPSC_CHAN_H
+#define SPSC_CHAN_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// In-process channels for the threaded runtime (./main --threaded)
+// A channel replaces one pipe between two component threads: a lock-free
+// single-producer single-consumer byte ring (the writer only moves tail,
+// the reader only moves head) plus an eventfd that is readable while the
+// ring holds data, so the reader's epoll/tick_wait loop works unchanged.
+// A frame is pushed whole or not at all, like a write() below PIPE_BUF.
+// The components still see plain fd numbers: frame_reader_init() and
+// frame_writer_init() find the channel behind an fd with chan_claim(), and
+// chan_open() stands in for open() on the named pipe. In the multi-process
+// binaries no channel is ever registered and every fd is a real pipe.
+
+#define CHAN_RING_SIZE 65536        // Power of two
+#define CHAN_MAX_ENDS  32
+
+typedef struct {
+    _Alignas(64) atomic_size_t head;   // Reader position (free-running), own cache line
+    _Alignas(64) atomic_size_t tail;   // Writer position (free-running)
+    _Alignas(64) atomic_bool reader_closed;
+    atomic_bool writer_closed;
+    atomic_bool writer_waiting;     // Blocking writer parked on space_fd
+    int data_fd;                    // eventfd, readable while there is data (or EOF)
+    int space_fd;                   // eventfd, kicked by the reader for a parked writer
+    unsigned char ring[CHAN_RING_SIZE];
+} SpscChan;
+
+typedef struct {
+    SpscChan *chan;
+    int fd;                         // Number handed to the component (a dup of an eventfd)
+    bool writer;
+    bool nonblock;                  // O_NONBLOCK semantics: -1/EAGAIN instead of waiting
+    int owner;                      // Component that holds this end, see chan_close_owner
+    bool claimed;                   // Taken by a frame reader/writer already
+} ChanEnd;
+
+// Runtime side: create a channel between two owners; *rfd / *wfd are the
+// numbers to pass to the components in place of a pipe's ends
+SpscChan* chan_create(int reader_owner, int writer_owner, bool nonblock, int *rfd, int *wfd);
+// Owner finished (returned, exited or was stopped): its readers report
+// EPIPE to their writers and its writers report EOF to their readers
+void chan_close_owner(int owner);
+void chan_destroy_all(void);
+
+// Component side: the channel end registered under fd, claimed at most once;
+// NULL for any other fd
+ChanEnd* chan_claim(int fd);
+// open() for the named pipe: "chan:<fd>" names a channel end, anything
+// else is passed to open(); O_NONBLOCK is honoured either way
+int chan_open(const char *path, int flags);
+
+// read()/write() semantics: bytes moved, 0 = EOF, -1 with errno
+// (EAGAIN on an empty/full non-blocking end, EPIPE when the reader is gone)
+ssize_t chan_read(ChanEnd *end, void *buf, size_t len);
+ssize_t chan_write(ChanEnd *end, const void *buf, size_t len);
+
+#endif
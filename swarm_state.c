@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "swarm_state.h"
+
+static SwarmState* swarm_map(int flags) {
+    int fd = shm_open(SWARM_SHM_NAME, flags, 0666);
+    if (fd == -1) {
+        perror("shm_open swarm state");
+        return NULL;
+    }
+
+    if ((flags & O_CREAT) && ftruncate(fd, sizeof(SwarmState)) == -1) {
+        perror("ftruncate swarm state");
+        close(fd);
+        return NULL;
+    }
+
+    void *p = mmap(NULL, sizeof(SwarmState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the segment alive
+    if (p == MAP_FAILED) {
+        perror("mmap swarm state");
+        return NULL;
+    }
+    return (SwarmState *)p;
+}
+
+SwarmState* swarm_create(void) {
+    // Drop any segment left over from a crashed run
+    shm_unlink(SWARM_SHM_NAME);
+    SwarmState *ss = swarm_map(O_CREAT | O_RDWR | O_TRUNC);
+    if (ss != NULL) {
+        memset(ss, 0, sizeof(*ss));
+    }
+    return ss;
+}
+
+SwarmState* swarm_attach(void) {
+    return swarm_map(O_RDWR);
+}
+
+void swarm_detach(SwarmState *ss) {
+    if (ss != NULL) munmap(ss, sizeof(SwarmState));
+}
+
+void swarm_unlink(void) {
+    shm_unlink(SWARM_SHM_NAME);
+}
+
+void swarm_publish_drones(SwarmState *ss, const float *x, const float *y, int count) {
+    if (count > SWARM_MAX_DRONES) count = SWARM_MAX_DRONES;
+    seqlock_write_begin(&ss->drones_lock);
+    ss->drones.gen++;
+    ss->drones.count = count;
+    memcpy(ss->drones.x, x, sizeof(float) * (size_t)count);
+    memcpy(ss->drones.y, y, sizeof(float) * (size_t)count);
+    seqlock_write_end(&ss->drones_lock);
+}
+
+uint32_t swarm_read_drones(SwarmState *ss, float *x, float *y, int max, int *count) {
+    unsigned s;
+    uint32_t gen;
+    do {
+        s = seqlock_read_begin(&ss->drones_lock);
+        gen = ss->drones.gen;
+        int n = ss->drones.count;
+        if (n > max) n = max;
+        if (n < 0) n = 0;
+        memcpy(x, ss->drones.x, sizeof(float) * (size_t)n);
+        memcpy(y, ss->drones.y, sizeof(float) * (size_t)n);
+        *count = n;
+    } while (seqlock_read_retry(&ss->drones_lock, s));
+    return gen;
+}
+
+void swarm_publish_arena(SwarmState *ss, const SwarmArena *arena) {
+    int n = arena->obs_count;
+    if (n > SWARM_MAX_OBSTACLES) n = SWARM_MAX_OBSTACLES;
+    seqlock_write_begin(&ss->arena_lock);
+    ss->arena.gen++;
+    ss->arena.reset_gen = arena->reset_gen;
+    ss->arena.width = arena->width;
+    ss->arena.height = arena->height;
+    ss->arena.obs_count = n;
+    memcpy(ss->arena.obs_x, arena->obs_x, sizeof(float) * (size_t)n);
+    memcpy(ss->arena.obs_y, arena->obs_y, sizeof(float) * (size_t)n);
+    seqlock_write_end(&ss->arena_lock);
+}
+
+void swarm_read_arena(SwarmState *ss, SwarmArena *out) {
+    unsigned s;
+    do {
+        s = seqlock_read_begin(&ss->arena_lock);
+        int n = ss->arena.obs_count;
+        if (n > SWARM_MAX_OBSTACLES) n = SWARM_MAX_OBSTACLES;
+        if (n < 0) n = 0;
+        out->gen = ss->arena.gen;
+        out->reset_gen = ss->arena.reset_gen;
+        out->width = ss->arena.width;
+        out->height = ss->arena.height;
+        out->obs_count = n;
+        memcpy(out->obs_x, ss->arena.obs_x, sizeof(float) * (size_t)n);
+        memcpy(out->obs_y, ss->arena.obs_y, sizeof(float) * (size_t)n);
+    } while (seqlock_read_retry(&ss->arena_lock, s));
+}
+
+uint32_t swarm_arena_gen(SwarmState *ss) {
+    unsigned s;
+    uint32_t gen;
+    do {
+        s = seqlock_read_begin(&ss->arena_lock);
+        gen = ss->arena.gen;
+    } while (seqlock_read_retry(&ss->arena_lock, s));
+    return gen;
+}
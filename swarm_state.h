@@ -0,0 +1,59 @@
+// swarm_state.h
+#ifndef SWARM_STATE_H
+#define SWARM_STATE_H
+
+#include <stdint.h>
+#include "world_state.h"
+
+// Shared memory for swarm mode
+// The Drone process integrates the whole swarm and publishes every position;
+// the BlackBoard publishes the arena (window size, obstacles) and asks for a
+// formation reset. Like world_state, each section has one writer and a
+// seqlock. Positions are stored as separate x[] / y[] arrays so both sides
+// copy them straight into their own SoA buffers.
+
+#define SWARM_SHM_NAME "/arp_swarm_state"
+#define SWARM_MAX_DRONES 16384
+#define SWARM_MAX_OBSTACLES 4096
+
+// Written by the Drone once per tick
+typedef struct {
+    uint32_t gen;
+    int count;
+    float x[SWARM_MAX_DRONES];
+    float y[SWARM_MAX_DRONES];
+} SwarmDrones;
+
+// Written by the BlackBoard when the window, the obstacles or the formation change
+typedef struct {
+    uint32_t gen;
+    uint32_t reset_gen;      // Bumped to re-form the swarm at the window centre
+    int width, height;
+    int obs_count;
+    float obs_x[SWARM_MAX_OBSTACLES];
+    float obs_y[SWARM_MAX_OBSTACLES];
+} SwarmArena;
+
+typedef struct {
+    SeqLock drones_lock;
+    SwarmDrones drones;
+
+    SeqLock arena_lock;
+    SwarmArena arena;
+} SwarmState;
+
+// Segment lifetime: Master creates/unlinks, Drone and BlackBoard attach/detach
+SwarmState* swarm_create(void);
+SwarmState* swarm_attach(void);
+void swarm_detach(SwarmState *ss);
+void swarm_unlink(void);
+
+void swarm_publish_drones(SwarmState *ss, const float *x, const float *y, int count);
+// Copies at most max drones; returns the generation read
+uint32_t swarm_read_drones(SwarmState *ss, float *x, float *y, int max, int *count);
+
+void swarm_publish_arena(SwarmState *ss, const SwarmArena *arena);
+void swarm_read_arena(SwarmState *ss, SwarmArena *out);
+uint32_t swarm_arena_gen(SwarmState *ss);   // Cheap check before a full read
+
+#endif
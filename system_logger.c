@@ -5,12 +5,44 @@
 #include <errno.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <sched.h>
 #include <sys/file.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include "logger_custom.h"
 
 // Store the log file PATH instead of FILE pointer
 static char log_file_path[256] = {0};
 
+// --- Asynchronous backend ---
+// logger_log only formats the record into a slot of a bounded lock-free ring
+// (multi-producer, single consumer). A flusher thread drains the ring in
+// batches and writes them to a file descriptor that stays open for the whole
+// life of the process, taking flock once per batch instead of once per line.
+#define LOG_RING_SLOTS 4096            // Must be a power of two
+#define LOG_RECORD_MAX 512             // Longer records are truncated
+#define LOG_BATCH_BYTES (64 * 1024)    // Max bytes written per flush
+#define LOG_FLUSH_IDLE_NS 5000000L     // Flusher sleeps 5 ms when the ring is empty
+#define LOG_ERROR_SPIN 64              // Errors retry a few times before being dropped
+
+typedef struct {
+    atomic_size_t seq;                 // Slot sequence number (Vyukov queue)
+    size_t len;
+    char text[LOG_RECORD_MAX];
+} LogSlot;
+
+static LogMode log_mode = LOG_MODE_SYNC;
+static LogSlot *log_ring = NULL;
+static atomic_size_t ring_head;        // Next slot producers claim
+static size_t ring_tail;               // Next slot the flusher reads (flusher only)
+static atomic_ulong dropped_records;
+static atomic_int flusher_stop;
+static pthread_t flusher_thread;
+static int log_fd = -1;
+
 static const char* log_level_to_string(LogLevel level) {
     switch(level) {
         case LOG_DEBUG:    return "DEBUG";
@@ -42,6 +74,168 @@ static const char* log_level_to_string(LogLevel level) {
     return 0;
 }*/
 
+// Format "[time] [PID] [LEVEL] [process] file:line (func) - " into buf.
+// The time string is cached per second so localtime is not called per record.
+static int format_header(char *buf, size_t size, LogLevel level, const char* process_name,
+                         const char* file, int line, const char* function) {
+    static __thread time_t cached_sec = (time_t)-1;
+    static __thread char cached_time[26];
+
+    time_t now = time(NULL);
+    if (now != cached_sec) {
+        struct tm tm_info;
+        localtime_r(&now, &tm_info);
+        strftime(cached_time, sizeof(cached_time), "%Y-%m-%d %H:%M:%S", &tm_info);
+        cached_sec = now;
+    }
+
+    return snprintf(buf, size, "[%s] [PID:%d] [%s] [%s] %s:%d (%s) - ",
+                    cached_time, getpid(), log_level_to_string(level),
+                    process_name, file, line, function);
+}
+
+// Write a whole batch under one lock, retrying on short writes
+static void write_batch(const char *buf, size_t len) {
+    if (len == 0 || log_fd < 0) return;
+
+    flock(log_fd, LOCK_EX);
+    size_t done = 0;
+    while (done < len) {
+        ssize_t w = write(log_fd, buf + done, len - done);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        done += (size_t)w;
+    }
+    flock(log_fd, LOCK_UN);
+}
+
+// Claim a slot for one record. Returns NULL when the ring is full.
+static LogSlot* ring_claim(void) {
+    size_t pos = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    for (;;) {
+        LogSlot *slot = &log_ring[pos & (LOG_RING_SLOTS - 1)];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring_head, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed)) {
+                return slot;
+            }
+        } else if (diff < 0) {
+            return NULL; // Full: the flusher has not caught up yet
+        } else {
+            pos = atomic_load_explicit(&ring_head, memory_order_relaxed);
+        }
+    }
+}
+
+// Publish a filled slot to the flusher
+static void ring_publish(LogSlot *slot) {
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_release);
+}
+
+// Drain every published record into buf. Returns the number of bytes copied.
+static size_t ring_drain(char *buf, size_t size) {
+    size_t used = 0;
+    for (;;) {
+        LogSlot *slot = &log_ring[ring_tail & (LOG_RING_SLOTS - 1)];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq != ring_tail + 1) break;           // Nothing more published
+        if (used + slot->len > size) break;        // Batch full, keep it for next round
+
+        memcpy(buf + used, slot->text, slot->len);
+        used += slot->len;
+
+        // Hand the slot back to producers for the next lap
+        atomic_store_explicit(&slot->seq, ring_tail + LOG_RING_SLOTS, memory_order_release);
+        ring_tail++;
+    }
+    return used;
+}
+
+static void* flusher_main(void *arg) {
+    (void)arg;
+    static char batch[LOG_BATCH_BYTES];
+    unsigned long reported_drops = 0;
+
+    for (;;) {
+        int stopping = atomic_load(&flusher_stop);
+        size_t len = ring_drain(batch, sizeof(batch));
+
+        // Report drops as a normal record, so they show up next to the gap
+        unsigned long drops = atomic_load(&dropped_records);
+        if (drops != reported_drops && len + 256 <= sizeof(batch)) {
+            len += format_header(batch + len, sizeof(batch) - len, LOG_WARNING,
+                                 "Logger", __FILE__, __LINE__, __func__);
+            len += snprintf(batch + len, sizeof(batch) - len,
+                            "Log ring full, dropped %lu records so far\n", drops);
+            reported_drops = drops;
+        }
+
+        if (len > 0) {
+            write_batch(batch, len);
+            continue; // There may be more waiting
+        }
+
+        if (stopping) break;
+
+        struct timespec idle = {0, LOG_FLUSH_IDLE_NS};
+        nanosleep(&idle, NULL);
+    }
+    return NULL;
+}
+
+// Registered with atexit so records are not lost when a process calls exit()
+static void logger_atexit(void) {
+    logger_close();
+}
+
+static int start_async(void) {
+    log_ring = calloc(LOG_RING_SLOTS, sizeof(LogSlot));
+    if (log_ring == NULL) return -1;
+    for (size_t i = 0; i < LOG_RING_SLOTS; i++) {
+        atomic_init(&log_ring[i].seq, i);
+    }
+    atomic_init(&ring_head, 0);
+    ring_tail = 0;
+    atomic_init(&dropped_records, 0);
+    atomic_init(&flusher_stop, 0);
+
+    log_fd = open(log_file_path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (log_fd < 0) {
+        perror("Failed to open log file");
+        free(log_ring);
+        log_ring = NULL;
+        return -1;
+    }
+
+    // The flusher must never steal SIGTERM/SIGUSR1 from the main loop
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    int rc = pthread_create(&flusher_thread, NULL, flusher_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (rc != 0) {
+        close(log_fd);
+        log_fd = -1;
+        free(log_ring);
+        log_ring = NULL;
+        return -1;
+    }
+
+    static int atexit_done = 0;
+    if (!atexit_done) {
+        atexit(logger_atexit);
+        atexit_done = 1;
+    }
+    return 0;
+}
+
 // int should_wipe: 1 = wipe file (truncate), 0 = append only
 int logger_init(const char* path, int should_wipe) {
 
@@ -67,17 +261,82 @@ int logger_init(const char* path, int should_wipe) {
     return 0;
 }
 
+int logger_init_mode(const char* path, int should_wipe, LogMode mode) {
+    if (logger_init(path, should_wipe) != 0) return -1;
+
+    log_mode = LOG_MODE_SYNC;
+    if (mode == LOG_MODE_ASYNC) {
+        if (start_async() != 0) {
+            // Fall back to the synchronous path rather than losing logs
+            fprintf(stderr, "Async logger unavailable, using synchronous logging\n");
+            return 0;
+        }
+        log_mode = LOG_MODE_ASYNC;
+    }
+    return 0;
+}
+
+unsigned long logger_dropped_count(void) {
+    return (log_ring != NULL) ? atomic_load(&dropped_records) : 0;
+}
+
 void logger_close(void) {
-    // Nothing to do - we open/close per log
+    if (log_mode == LOG_MODE_ASYNC) {
+        // Let the flusher drain whatever is left, then release everything
+        atomic_store(&flusher_stop, 1);
+        pthread_join(flusher_thread, NULL);
+        close(log_fd);
+        log_fd = -1;
+        free(log_ring);
+        log_ring = NULL;
+        log_mode = LOG_MODE_SYNC;
+    }
     log_file_path[0] = '\0';
 }
 
+// Async path: format straight into a ring slot, no syscalls
+static void log_async(LogLevel level, const char* process_name, const char* file,
+                      int line, const char* function, const char* format, va_list args) {
+    LogSlot *slot = ring_claim();
+
+    // Errors are worth a short wait for the flusher, everything else is dropped
+    for (int spin = 0; slot == NULL && level >= LOG_ERROR && spin < LOG_ERROR_SPIN; spin++) {
+        sched_yield();
+        slot = ring_claim();
+    }
+    if (slot == NULL) {
+        atomic_fetch_add_explicit(&dropped_records, 1, memory_order_relaxed);
+        return;
+    }
+
+    int n = format_header(slot->text, LOG_RECORD_MAX, level, process_name, file, line, function);
+    if (n < 0) n = 0;
+    if (n < LOG_RECORD_MAX - 1) {
+        int m = vsnprintf(slot->text + n, LOG_RECORD_MAX - n, format, args);
+        if (m > 0) n += m;
+    }
+    // Keep room for the newline, truncating long messages
+    if (n > LOG_RECORD_MAX - 1) n = LOG_RECORD_MAX - 1;
+    slot->text[n++] = '\n';
+    slot->len = (size_t)n;
+
+    ring_publish(slot);
+}
+
 void logger_log(LogLevel level, const char* process_name, const char* file, 
                 int line, const char* function, const char* format, ...) {
     
     if (log_file_path[0] == '\0') {
         return;  // Logger not initialized
     }
+
+    if (log_mode == LOG_MODE_ASYNC) {
+        va_list args;
+        va_start(args, format);
+        log_async(level, process_name, file, line, function, format, args);
+        va_end(args);
+        return;
+    }
     
     // OPEN the file each time (just like your log_watchdog)
     FILE* log_file = fopen(log_file_path, "a");
@@ -96,8 +355,9 @@ void logger_log(LogLevel level, const char* process_name, const char* file,
     time_t now;
     time(&now);
     char time_str[26];
-    struct tm* tm_info = localtime(&now);
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
+    struct tm tm_info;
+    localtime_r(&now, &tm_info);
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm_info);
     
     // Get process ID
     pid_t pid = getpid();
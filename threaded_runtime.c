@@ -0,0 +1,248 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "logger_custom.h"
+#include "spsc_chan.h"
+#include "threaded_runtime.h"
+
+// Entry points and stop flags left global by the Makefile's component rules
+extern int blackboard_main(int argc, char *argv[]);
+extern int drone_main(int argc, char *argv[]);
+extern int input_main(int argc, char *argv[]);
+extern int obstacles_main(int argc, char *argv[]);
+extern int targets_main(int argc, char *argv[]);
+extern int comm_server_main(int argc, char *argv[]);
+extern int comm_client_main(int argc, char *argv[]);
+extern volatile sig_atomic_t blackboard_should_exit, drone_should_exit, input_should_exit,
+                             obstacles_should_exit, targets_should_exit,
+                             comm_server_should_exit, comm_client_should_exit;
+
+// Channel owners, one per component thread
+enum { COMP_BLACKBOARD, COMP_DRONE, COMP_INPUT, COMP_OBSTACLES, COMP_TARGETS, COMP_COMM, COMP_COUNT };
+
+#define COMP_MAX_ARGS 16
+
+typedef struct {
+    const char *name;
+    int (*entry)(int argc, char *argv[]);
+    volatile sig_atomic_t *should_exit;
+    int argc;
+    char *argv[COMP_MAX_ARGS + 1];
+    char args[COMP_MAX_ARGS][256];
+    pthread_t thread;
+    bool started;
+    atomic_bool done;
+    int status;
+} Component;
+
+static Component comps[COMP_COUNT];
+
+void component_exit(int code) {
+    pthread_exit((void *)(intptr_t)code);
+}
+
+// The components signal their parent (the master) with kill(getppid(), ...);
+// here the master is this process
+pid_t component_getppid(void) {
+    return getpid();
+}
+
+static void comp_setup(int id, const char *name, int (*entry)(int, char **),
+                       volatile sig_atomic_t *should_exit) {
+    Component *c = &comps[id];
+    c->name = name;
+    c->entry = entry;
+    c->should_exit = should_exit;
+    c->argc = 0;
+}
+
+static void comp_arg(int id, const char *fmt, ...) {
+    Component *c = &comps[id];
+    if (c->argc == COMP_MAX_ARGS) return;
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(c->args[c->argc], sizeof(c->args[c->argc]), fmt, ap);
+    va_end(ap);
+    c->argv[c->argc] = c->args[c->argc];
+    c->argv[++c->argc] = NULL;
+}
+
+// Runs when the component returns or calls exit(): its writers show EOF and
+// its readers EPIPE, exactly like a process whose pipe ends were closed
+static void comp_finished(void *arg) {
+    Component *c = arg;
+    chan_close_owner((int)(c - comps));
+    atomic_store(&c->done, true);
+}
+
+static void* comp_thread(void *arg) {
+    Component *c = arg;
+    void *ret;
+    pthread_cleanup_push(comp_finished, c);
+    ret = (void *)(intptr_t)c->entry(c->argc, c->argv);
+    pthread_cleanup_pop(1);
+    return ret;
+}
+
+static double elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1e3 + (now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
+int threaded_run(const ThreadedConfig *cfg) {
+    struct timespec t_start;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+
+    // SIGINT/SIGTERM go to sigtimedwait below, never to a component's handler
+    sigset_t stop_set;
+    sigemptyset(&stop_set);
+    sigaddset(&stop_set, SIGINT);
+    sigaddset(&stop_set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_set, NULL);
+
+    // Same topology as main.c's pipes, named after them
+    int in_r, in_w, inbb_r, inbb_w, ob_r, ob_w, ta_r, ta_w;
+    int tobb_r, tobb_w, frombb_r, frombb_w, repul_r, repul_w;
+    int commto_r, commto_w, commfrom_r, commfrom_w;
+    if (chan_create(COMP_DRONE, COMP_INPUT, false, &in_r, &in_w) == NULL ||
+        chan_create(COMP_BLACKBOARD, COMP_INPUT, false, &inbb_r, &inbb_w) == NULL ||
+        chan_create(COMP_BLACKBOARD, COMP_OBSTACLES, false, &ob_r, &ob_w) == NULL ||
+        chan_create(COMP_BLACKBOARD, COMP_TARGETS, false, &ta_r, &ta_w) == NULL ||
+        chan_create(COMP_BLACKBOARD, COMP_DRONE, false, &tobb_r, &tobb_w) == NULL ||
+        chan_create(COMP_DRONE, COMP_BLACKBOARD, false, &frombb_r, &frombb_w) == NULL ||
+        chan_create(COMP_DRONE, COMP_BLACKBOARD, false, &repul_r, &repul_w) == NULL ||
+        chan_create(COMP_BLACKBOARD, COMP_COMM, true, &commto_r, &commto_w) == NULL ||
+        chan_create(COMP_COMM, COMP_BLACKBOARD, true, &commfrom_r, &commfrom_w) == NULL) {
+        LOG_ERRNO("Master", "Failed to create the component channels");
+        chan_destroy_all();
+        return 1;
+    }
+
+    // Same argv as the programs get from main.c
+    comp_setup(COMP_BLACKBOARD, "BlackBoard", blackboard_main, &blackboard_should_exit);
+    comp_arg(COMP_BLACKBOARD, "BlackBoard");
+    comp_arg(COMP_BLACKBOARD, "%d", tobb_r);
+    comp_arg(COMP_BLACKBOARD, "%d", frombb_w);
+    comp_arg(COMP_BLACKBOARD, "%d", ob_r);
+    comp_arg(COMP_BLACKBOARD, "%d", ta_r);
+    comp_arg(COMP_BLACKBOARD, "chan:%d", inbb_r);
+    comp_arg(COMP_BLACKBOARD, "%d", repul_w);
+    comp_arg(COMP_BLACKBOARD, "%d", commfrom_w);
+    comp_arg(COMP_BLACKBOARD, "%d", commto_r);
+    comp_arg(COMP_BLACKBOARD, "%d", cfg->mode);
+    comp_arg(COMP_BLACKBOARD, "%d", cfg->transport);
+    comp_arg(COMP_BLACKBOARD, "%s", cfg->state_path);
+    comp_arg(COMP_BLACKBOARD, "0");     // No session
+    comp_arg(COMP_BLACKBOARD, "");
+
+    comp_setup(COMP_DRONE, "Drone", drone_main, &drone_should_exit);
+    comp_arg(COMP_DRONE, "Drone");
+    comp_arg(COMP_DRONE, "%d", in_r);
+    comp_arg(COMP_DRONE, "%d", frombb_r);
+    comp_arg(COMP_DRONE, "%d", tobb_w);
+    comp_arg(COMP_DRONE, "%d", repul_r);
+    comp_arg(COMP_DRONE, "%d", cfg->mode);
+    comp_arg(COMP_DRONE, "%d", cfg->transport);
+    comp_arg(COMP_DRONE, "0");
+    comp_arg(COMP_DRONE, "");
+
+    comp_setup(COMP_INPUT, "Input", input_main, &input_should_exit);
+    comp_arg(COMP_INPUT, "Input");
+    comp_arg(COMP_INPUT, "%d", in_w);
+    comp_arg(COMP_INPUT, "chan:%d", inbb_w);
+    comp_arg(COMP_INPUT, "%s", cfg->script_path);
+
+    if (cfg->mode == 1) {
+        comp_setup(COMP_OBSTACLES, "Obstacles", obstacles_main, &obstacles_should_exit);
+        comp_arg(COMP_OBSTACLES, "Obstacles");
+        comp_arg(COMP_OBSTACLES, "%d", ob_w);
+        comp_setup(COMP_TARGETS, "Targets", targets_main, &targets_should_exit);
+        comp_arg(COMP_TARGETS, "Targets");
+        comp_arg(COMP_TARGETS, "%d", ta_w);
+    } else if (cfg->mode == 2) {
+        comp_setup(COMP_COMM, "CommServer", comm_server_main, &comm_server_should_exit);
+        comp_arg(COMP_COMM, "CommServer");
+        comp_arg(COMP_COMM, "%d", cfg->sockfd);
+        comp_arg(COMP_COMM, "%d", commfrom_r);
+        comp_arg(COMP_COMM, "%d", commto_w);
+        comp_arg(COMP_COMM, "%d", cfg->width);
+        comp_arg(COMP_COMM, "%d", cfg->height);
+        comp_arg(COMP_COMM, "%d", cfg->net_stream);
+        comp_arg(COMP_COMM, "%d", cfg->net_udp);
+    } else {
+        comp_setup(COMP_COMM, "CommClient", comm_client_main, &comm_client_should_exit);
+        comp_arg(COMP_COMM, "CommClient");
+        comp_arg(COMP_COMM, "%s", cfg->hostname);
+        comp_arg(COMP_COMM, "%d", cfg->portno);
+        comp_arg(COMP_COMM, "%d", commfrom_r);
+        comp_arg(COMP_COMM, "%d", commto_w);
+        comp_arg(COMP_COMM, "%d", cfg->net_stream);
+        comp_arg(COMP_COMM, "%d", cfg->net_udp);
+        comp_arg(COMP_COMM, "%d", cfg->width);
+        comp_arg(COMP_COMM, "%d", cfg->height);
+    }
+
+    int started = 0;
+    for (int i = 0; i < COMP_COUNT; i++) {
+        Component *c = &comps[i];
+        if (c->entry == NULL) continue;
+        if (pthread_create(&c->thread, NULL, comp_thread, c) != 0) {
+            LOG_ERROR("Master", "Failed to start the %s thread", c->name);
+            chan_close_owner(i);
+            atomic_store(&c->done, true);
+            continue;
+        }
+        c->started = true;
+        started++;
+    }
+    LOG_INFO("Master", "Threaded runtime: %d components started in %.3f ms", started, elapsed_ms(&t_start));
+
+    // The run ends with the BlackBoard or the Drone, like in main.c
+    struct timespec poll_period = { 0, 50 * 1000000L };
+    for (;;) {
+        int sig = sigtimedwait(&stop_set, NULL, &poll_period);
+        if (sig == SIGINT || sig == SIGTERM) {
+            LOG_INFO("Master", "Termination signal received, stopping the components");
+            break;
+        }
+        if (atomic_load(&comps[COMP_BLACKBOARD].done) || atomic_load(&comps[COMP_DRONE].done)) break;
+    }
+
+    struct timespec t_stop;
+    clock_gettime(CLOCK_MONOTONIC, &t_stop);
+    for (int i = 0; i < COMP_COUNT; i++) {
+        if (comps[i].should_exit != NULL) *comps[i].should_exit = 1;
+    }
+
+    int failures = 0;
+    for (int i = 0; i < COMP_COUNT; i++) {
+        Component *c = &comps[i];
+        if (!c->started) continue;
+        void *ret;
+        pthread_join(c->thread, &ret);
+        c->status = (int)(intptr_t)ret;
+        if (c->status != 0) {
+            fprintf(stderr, "%s exited with error code %d\n", c->name, c->status);
+            failures++;
+        }
+    }
+    LOG_INFO("Master", "Threaded runtime: components stopped in %.3f ms", elapsed_ms(&t_stop));
+
+    chan_destroy_all();
+    if (failures) {
+        fprintf(stderr, "One or more components failed (%d)\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+// threaded_runtime.h
+#ifndef THREADED_RUNTIME_H
+#define THREADED_RUNTIME_H
+
+#include <sys/types.h>
+
+// Single-process runtime: ./main --threaded ...
+// BlackBoard, Drone, Input, Obstacles, Targets and the Communication
+// server/client run as threads of the master process instead of seven
+// forked programs. Each component is the same source file as its program:
+// the Makefile links it with private copies of the modules it uses (logger,
+// frames, heartbeat, ...) and renames main() to <component>_main, exit() to
+// component_exit() and should_exit to <component>_should_exit, so nothing is
+// shared by accident and the runtime can stop a component by setting its
+// flag. Every pipe becomes an in-process SPSC channel (spsc_chan.h), started
+// in microseconds and read without a context switch. The run is headless
+// (scripted input, world state as JSON lines) and has no watchdog.
+
+typedef struct {
+    int mode;                  // 1 standalone, 2 server, 3 client
+    int transport;             // Drone/BlackBoard world state: 0 pipes, 1 shared memory
+    int net_stream;
+    int width, height;         // Parameter file window size, sent by the server
+    int sockfd;                // Server: listening socket
+    const char *hostname;      // Client: server address and port
+    int portno;
+    const char *script_path;   // Input script, see process_In.c
+    const char *state_path;    // BlackBoard world state output
+    int net_udp;               // Server/client over UDP instead of TCP
+} ThreadedConfig;
+
+// Start every component, wait for the BlackBoard or the Drone to finish (or
+// SIGINT/SIGTERM), stop the rest and join them. Returns the exit code.
+int threaded_run(const ThreadedConfig *cfg);
+
+// Stand-ins the components are linked against in the threaded build
+void component_exit(int code) __attribute__((noreturn));
+pid_t component_getppid(void);
+
+#endif
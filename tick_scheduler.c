@@ -0,0 +1,145 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "tick_scheduler.h"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int tick_init(TickScheduler *ts, unsigned period_ms, int max_catchup) {
+    memset(ts, 0, sizeof(*ts));
+    ts->tfd = -1;
+    ts->epfd = -1;
+    if (period_ms == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    ts->period_ns = (uint64_t)period_ms * 1000000ULL;
+    ts->max_catchup = (max_catchup > 0) ? max_catchup : 1;
+
+    ts->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    ts->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (ts->tfd == -1 || ts->epfd == -1) {
+        tick_close(ts);
+        return -1;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.fd = ts->tfd};
+    if (epoll_ctl(ts->epfd, EPOLL_CTL_ADD, ts->tfd, &ev) == -1) {
+        tick_close(ts);
+        return -1;
+    }
+
+    // Absolute schedule: start + k * period, independent of how long each step takes
+    ts->start_ns = now_ns() + ts->period_ns;
+    ts->last_report_ns = ts->start_ns;
+    struct itimerspec its;
+    its.it_value.tv_sec = ts->start_ns / 1000000000ULL;
+    its.it_value.tv_nsec = ts->start_ns % 1000000000ULL;
+    its.it_interval.tv_sec = ts->period_ns / 1000000000ULL;
+    its.it_interval.tv_nsec = ts->period_ns % 1000000000ULL;
+    if (timerfd_settime(ts->tfd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+        tick_close(ts);
+        return -1;
+    }
+    return 0;
+}
+
+void tick_close(TickScheduler *ts) {
+    if (ts->tfd != -1) close(ts->tfd);
+    if (ts->epfd != -1) close(ts->epfd);
+    ts->tfd = -1;
+    ts->epfd = -1;
+}
+
+int tick_watch(TickScheduler *ts, int fd) {
+    struct epoll_event ev = {.events = EPOLLIN, .data.fd = fd};
+    return epoll_ctl(ts->epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+void tick_unwatch(TickScheduler *ts, int fd) {
+    epoll_ctl(ts->epfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+int tick_wait(TickScheduler *ts, fd_set *ready, int *steps) {
+    struct epoll_event events[TICK_MAX_WATCH + 1];
+    FD_ZERO(ready);
+    *steps = 0;
+
+    int n = epoll_wait(ts->epfd, events, TICK_MAX_WATCH + 1, ts->unpaced ? 0 : -1);
+    if (n == -1) return (errno == EINTR) ? 0 : -1;
+
+    int nready = 0;
+    bool timer = false;
+    for (int i = 0; i < n; i++) {
+        if (events[i].data.fd == ts->tfd) {
+            timer = true;
+        } else {
+            FD_SET(events[i].data.fd, ready);
+            nready++;
+        }
+    }
+    if (ts->unpaced) {
+        ts->wakes++;
+        ts->steps++;
+        *steps = 1;
+        return nready;
+    }
+    if (!timer) return nready;
+
+    uint64_t exp;
+    if (read(ts->tfd, &exp, sizeof(exp)) != sizeof(exp) || exp == 0) return nready;
+
+    // How late we woke up compared with the newest scheduled expiration
+    ts->expirations += exp;
+    uint64_t now = now_ns();
+    uint64_t scheduled = ts->start_ns + (ts->expirations - 1) * ts->period_ns;
+    double jitter_us = (now > scheduled) ? (double)(now - scheduled) / 1000.0 : 0.0;
+    ts->jitter_sum_us += jitter_us;
+    if (jitter_us > ts->jitter_max_us) ts->jitter_max_us = jitter_us;
+
+    int due = (exp > (uint64_t)ts->max_catchup) ? ts->max_catchup : (int)exp;
+    if (exp > 1) ts->overruns++;
+    ts->dropped += (unsigned long)(exp - (uint64_t)due);
+    ts->wakes++;
+    ts->steps += (unsigned long)due;
+    *steps = due;
+    return nready;
+}
+
+void tick_set_unpaced(TickScheduler *ts) {
+    ts->unpaced = true;
+    // The timer keeps running but is never waited for
+    tick_unwatch(ts, ts->tfd);
+}
+
+void tick_resync(TickScheduler *ts) {
+    uint64_t exp;
+    if (read(ts->tfd, &exp, sizeof(exp)) == sizeof(exp)) {
+        ts->expirations += exp;
+        ts->skipped += (unsigned long)exp;
+    }
+}
+
+bool tick_report_due(TickScheduler *ts, unsigned interval_ms) {
+    uint64_t now = now_ns();
+    if (now - ts->last_report_ns < (uint64_t)interval_ms * 1000000ULL) return false;
+    ts->last_report_ns = now;
+    return true;
+}
+
+void tick_format_stats(const TickScheduler *ts, char *buf, size_t len) {
+    double mean = (ts->wakes > 0) ? ts->jitter_sum_us / (double)ts->wakes : 0.0;
+    snprintf(buf, len,
+             "period=%.1fms steps=%lu wakes=%lu overruns=%lu dropped=%lu skipped=%lu "
+             "jitter_mean=%.1fus jitter_max=%.1fus",
+             (double)ts->period_ns / 1e6, ts->steps, ts->wakes, ts->overruns,
+             ts->dropped, ts->skipped, mean, ts->jitter_max_us);
+}
@@ -0,0 +1,68 @@
+// tick_scheduler.h
+#ifndef TICK_SCHEDULER_H
+#define TICK_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/select.h>
+
+// Fixed-rate tick scheduler
+// A periodic timerfd and the caller's input fds share one epoll instance.
+// tick_wait() sleeps until either a pipe has data or the timer expires, and
+// reports how many fixed steps are due. The timer is absolute (CLOCK_MONOTONIC)
+// so the loop body's own run time never shifts the schedule: simulated time
+// advances exactly one period per expiration. After an overrun the missed
+// steps are run back to back, at most max_catchup per wake; anything beyond
+// that is dropped and counted so the simulation never spirals.
+
+#define TICK_MAX_CATCHUP 5
+#define TICK_MAX_WATCH   16
+
+typedef struct {
+    int tfd;                   // Periodic timerfd
+    int epfd;
+    uint64_t period_ns;
+    int max_catchup;
+    uint64_t start_ns;         // First expiration
+    uint64_t expirations;      // Timer expirations seen so far
+    bool unpaced;              // One step per wake, as fast as the caller loops
+
+    // Statistics
+    unsigned long steps;       // Fixed steps handed to the caller
+    unsigned long wakes;       // Wakes with at least one step due
+    unsigned long overruns;    // Wakes where more than one step was due
+    unsigned long dropped;     // Steps beyond max_catchup, never run
+    unsigned long skipped;     // Steps discarded by tick_resync (pause)
+    double jitter_sum_us;      // Wake time - scheduled expiration
+    double jitter_max_us;
+    uint64_t last_report_ns;
+} TickScheduler;
+
+// period_ms > 0; returns -1 (errno set) when timerfd/epoll can't be created
+int tick_init(TickScheduler *ts, unsigned period_ms, int max_catchup);
+void tick_close(TickScheduler *ts);
+
+// Wake tick_wait() when fd is readable
+int tick_watch(TickScheduler *ts, int fd);
+void tick_unwatch(TickScheduler *ts, int fd);
+
+// Block until a watched fd is readable or the timer fires.
+// Fills *ready with the readable watched fds and *steps with the number of
+// fixed steps to run now (0 when only input arrived). Returns the number of
+// readable fds, or -1 on error. EINTR is returned as 0 with no steps.
+int tick_wait(TickScheduler *ts, fd_set *ready, int *steps);
+
+// Stop following the timer: every tick_wait() polls the watched fds without
+// blocking and reports one step (unpaced session replay)
+void tick_set_unpaced(TickScheduler *ts);
+
+// Discard the steps that piled up while the caller was blocked on purpose
+// (e.g. paused), so they are not replayed as a burst
+void tick_resync(TickScheduler *ts);
+
+// True once every interval_ms; use with tick_format_stats for periodic logs
+bool tick_report_due(TickScheduler *ts, unsigned interval_ms);
+void tick_format_stats(const TickScheduler *ts, char *buf, size_t len);
+
+#endif
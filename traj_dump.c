@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "traj_recorder.h"
+
+// Convert a binary drone trajectory to CSV
+//   ./traj_dump [trajectory_file] [output.csv]
+// Defaults: drone_trajectory.traj, CSV on stdout.
+
+// Standardized exit codes
+#define USAGE_ERROR 64
+#define DATA_ERROR 65
+#define OPEN_FAIL 66
+
+int main(int argc, char *argv[]) {
+    if (argc > 3) {
+        fprintf(stderr, "Usage: %s [trajectory_file] [output.csv]\n", argv[0]);
+        return USAGE_ERROR;
+    }
+    const char *in_path = (argc > 1) ? argv[1] : TRAJ_PATH;
+    const char *out_path = (argc > 2) ? argv[2] : NULL;
+
+    int fd = open(in_path, O_RDONLY);
+    if (fd == -1) {
+        perror(in_path);
+        return OPEN_FAIL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(TrajHeader)) {
+        fprintf(stderr, "%s: not a trajectory file\n", in_path);
+        close(fd);
+        return DATA_ERROR;
+    }
+    const unsigned char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return OPEN_FAIL;
+    }
+
+    const TrajHeader *hdr = (const TrajHeader *)map;
+    if (memcmp(hdr->magic, TRAJ_MAGIC, sizeof(hdr->magic)) != 0 || hdr->version != TRAJ_VERSION ||
+        hdr->record_size != sizeof(TrajRecord)) {
+        fprintf(stderr, "%s: unsupported trajectory format\n", in_path);
+        return DATA_ERROR;
+    }
+
+    // Never trust the count beyond what the file holds (crashed writer)
+    uint64_t count = hdr->count;
+    uint64_t fits = (st.st_size - sizeof(TrajHeader)) / sizeof(TrajRecord);
+    if (count > fits) count = fits;
+
+    FILE *out = stdout;
+    if (out_path != NULL && (out = fopen(out_path, "w")) == NULL) {
+        perror(out_path);
+        return OPEN_FAIL;
+    }
+
+    const TrajRecord *rec = (const TrajRecord *)(map + sizeof(TrajHeader));
+    uint64_t t0 = (count > 0) ? rec[0].t_ns : 0;
+    fprintf(out, "t_s,x,y,vx,vy,cmd_fx,cmd_fy,rep_fx,rep_fy,active_key,boost_level,steps,write_failed\n");
+    for (uint64_t i = 0; i < count; i++) {
+        const TrajRecord *r = &rec[i];
+        char key = (r->active_key == ' ' || r->active_key == '\0') ? '-' : r->active_key;
+        fprintf(out, "%.6f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%c,%u,%u,%d\n",
+                (r->t_ns - t0) / 1e9, r->x, r->y, r->vx, r->vy, r->cmd_fx, r->cmd_fy,
+                r->rep_fx, r->rep_fy, key, r->boost_level, r->steps,
+                (r->flags & TRAJ_WRITE_FAILED) ? 1 : 0);
+    }
+
+    if (out != stdout) fclose(out);
+    fprintf(stderr, "%s: %llu records, %u ms tick\n", in_path, (unsigned long long)count, hdr->tick_ms);
+    munmap((void *)map, st.st_size);
+    return 0;
+}
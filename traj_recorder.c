@@ -0,0 +1,75 @@
+#define _GNU_SOURCE          // mremap
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "traj_recorder.h"
+
+static size_t file_size(size_t records) {
+    return sizeof(TrajHeader) + records * sizeof(TrajRecord);
+}
+
+int traj_open(TrajWriter *w, const char *path, uint32_t tick_ms) {
+    memset(w, 0, sizeof(*w));
+    w->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (w->fd == -1) return -1;
+
+    w->capacity = TRAJ_PREALLOC;
+    if (ftruncate(w->fd, file_size(w->capacity)) == -1) {
+        close(w->fd);
+        return -1;
+    }
+    w->map = mmap(NULL, file_size(w->capacity), PROT_READ | PROT_WRITE, MAP_SHARED, w->fd, 0);
+    if (w->map == MAP_FAILED) {
+        close(w->fd);
+        w->map = NULL;
+        return -1;
+    }
+
+    w->hdr = (TrajHeader *)w->map;
+    memcpy(w->hdr->magic, TRAJ_MAGIC, sizeof(w->hdr->magic));
+    w->hdr->version = TRAJ_VERSION;
+    w->hdr->record_size = sizeof(TrajRecord);
+    w->hdr->count = 0;
+    w->hdr->tick_ms = tick_ms;
+    return 0;
+}
+
+// Double the file and the mapping
+static int traj_grow(TrajWriter *w) {
+    size_t new_capacity = w->capacity * 2;
+    if (ftruncate(w->fd, file_size(new_capacity)) == -1) return -1;
+    void *p = mremap(w->map, file_size(w->capacity), file_size(new_capacity), MREMAP_MAYMOVE);
+    if (p == MAP_FAILED) return -1;
+    w->map = p;
+    w->hdr = (TrajHeader *)w->map;
+    w->capacity = new_capacity;
+    return 0;
+}
+
+int traj_append(TrajWriter *w, const TrajRecord *rec) {
+    if (w->map == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+    if (w->hdr->count == w->capacity && traj_grow(w) == -1) return -1;
+
+    TrajRecord *slot = (TrajRecord *)(w->map + sizeof(TrajHeader)) + w->hdr->count;
+    memcpy(slot, rec, sizeof(*rec));
+    w->hdr->count++;   // Only after the record is complete
+    return 0;
+}
+
+void traj_close(TrajWriter *w) {
+    if (w->map == NULL) return;
+    size_t used = file_size(w->hdr->count);
+    munmap(w->map, file_size(w->capacity));
+    // Drop the preallocated tail
+    if (ftruncate(w->fd, used) == -1) {
+        // The header count still tells readers where the records end
+    }
+    close(w->fd);
+    w->map = NULL;
+    w->hdr = NULL;
+}
@@ -0,0 +1,59 @@
+// traj_recorder.h
+#ifndef TRAJ_RECORDER_H
+#define TRAJ_RECORDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary drone trajectory
+// The file is a fixed header followed by fixed-size records, one per physics
+// tick. The writer maps the file and appends with a plain memory copy; the
+// mapping is preallocated and doubled (ftruncate + mremap) when it fills up,
+// and trimmed to the records actually written on close. The header's count
+// is updated after each record, so a file left by a crash is still readable
+// up to the last complete record. Convert to CSV with ./traj_dump.
+
+#define TRAJ_PATH        "drone_trajectory.traj"
+#define TRAJ_REPLAY_PATH "drone_trajectory_replay.traj"   // Written by session replays
+#define TRAJ_MAGIC       "ARPTRAJ1"
+#define TRAJ_VERSION     1
+#define TRAJ_PREALLOC    65536   // Records mapped up front, ~55 minutes at 20 Hz
+
+typedef struct __attribute__((packed)) {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;        // sizeof(TrajRecord) of the writer
+    uint64_t count;              // Complete records that follow
+    uint32_t tick_ms;            // Physics period
+    uint32_t reserved;
+} TrajHeader;
+
+#define TRAJ_WRITE_FAILED 0x01   // Position could not be sent to the BlackBoard
+
+typedef struct __attribute__((packed)) {
+    uint64_t t_ns;               // CLOCK_MONOTONIC
+    float x, y;
+    float vx, vy;                // Cells per second
+    float cmd_fx, cmd_fy;        // Thrust from the keys
+    float rep_fx, rep_fy;        // Net repulsion applied
+    char active_key;             // ' ' = engine off
+    uint8_t boost_level;
+    uint8_t flags;               // TRAJ_*
+    uint8_t steps;               // Physics steps run on this tick (> 1 after an overrun)
+} TrajRecord;
+
+typedef struct {
+    int fd;
+    uint8_t *map;
+    size_t capacity;             // Records the current mapping can hold
+    TrajHeader *hdr;
+} TrajWriter;
+
+// Create (truncate) path; -1 with errno set on failure
+int traj_open(TrajWriter *w, const char *path, uint32_t tick_ms);
+// Append one record, growing the file when needed; -1 on failure
+int traj_append(TrajWriter *w, const TrajRecord *rec);
+void traj_close(TrajWriter *w);
+
+#endif
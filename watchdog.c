@@ -1,31 +1,35 @@
 #define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <signal.h>
 #include <string.h>
+#include <errno.h>
 #include <time.h>
 #include "logger.h"
 #include <sys/file.h>  
 #include <time.h>
 #include "logger_custom.h"
+#include "heartbeat.h"
 
-#define CHECK_INTERVAL 10
-#define RESPONSE_TIMEOUT 10
-#define MAX_PROCESSES 50
+#define CHECK_INTERVAL 10      // Seconds between loop latency reports
+#define RESPONSE_TIMEOUT 10    // Seconds without a heartbeat before a process is killed
 
+// What the watchdog remembers about each heartbeat slot
 typedef struct {
-    pid_t pid;
-    char name[100];
-    int active;
-} ProcessInfo;
-
-ProcessInfo processes[MAX_PROCESSES];
-int process_count = 0;
-volatile sig_atomic_t response_received = 0;
-volatile sig_atomic_t timeout_occurred = 0;
+    int pid;                   // Owner when last looked at, 0 = free
+    bool stalled;              // Past its budget, reported once
+    uint64_t stall_from_ns;    // Last beat before the stall
+    uint64_t beats_seen;       // At the previous report
+    uint64_t gap_sum_seen;
+} SlotWatch;
+
+HeartbeatTable *table = NULL;
+SlotWatch watch[HEARTBEAT_MAX_SLOTS];
 volatile sig_atomic_t terminate_flag = 0;
 int mode=0;
+double detect_max_ms = 0;      // Longest delay between a missed deadline and its detection
 
 // Helper to log watchdog specific events
 void log_watchdog(const char *message) {
@@ -42,16 +46,6 @@ void log_watchdog(const char *message) {
     fclose(f);
 }
 
-// Handlers for signals
-void response_handler(int signo) {
-    if (signo == SIGUSR2) response_received = 1;
-}
-
-// Handler for timeout alarm
-void timeout_handler(int signo) {
-    if (signo == SIGALRM) timeout_occurred = 1;
-}
-
 // Handler for termination signal from Master Process
 void terminate_handler(int signo) {
     if (signo == SIGTERM) {
@@ -62,96 +56,109 @@ void terminate_handler(int signo) {
     }
 }
 
-// Load the process_log from file
-// This allows for the watchdog to have all processes pids and names
-int load_processes() {
-    FILE *f = fopen("process_log.log", "r");
-    if (!f) {
-        LOG_ERROR("Watchdog", "Failed to open process_log.log");
-        return 0;
-    }
+// Give a slot back once its process is gone
+static void release_slot(HeartbeatSlot *slot, int pid) {
+    int expected = pid;
+    atomic_compare_exchange_strong(&slot->pid, &expected, 0);
+}
 
-    // LOCK THE FILE
-    if (flock(fileno(f), LOCK_EX) == -1) {
-        fclose(f);
-        return 0;
-    }
-    
-    char line[256];
-    process_count = 0; // WARNING: This resets your list every time!
-    pid_t my_pid = getpid();
-    
-    while (fgets(line, sizeof(line), f) && process_count < MAX_PROCESSES) {
-        char name[100];
-        int pid;
-        if (sscanf(line, "Process: %s | PID: %d", name, &pid) == 2) {
-            if (pid == my_pid) continue;
-            if (strcmp(name, "Master") == 0) continue;
-            
-            // Explicitly ignore core processes ONLY if mode is 2 or 3
-            if (mode == 2 || mode == 3){
-                if (strcmp(name, "CommClient") == 0) continue;
-                if (strcmp(name, "CommServer") == 0) continue;
-                if (strcmp(name, "Drone") == 0) continue;
-                if (strcmp(name, "BlackBoard") == 0) continue;
+// One pass over every slot: flag processes past their budget, kill the hung ones
+static void scan_slots(void) {
+    char msg[256];
+    uint64_t now = heartbeat_now_ns();
+
+    for (int i = 0; i < HEARTBEAT_MAX_SLOTS; i++) {
+        HeartbeatSlot *slot = &table->slots[i];
+        SlotWatch *w = &watch[i];
+        int pid = atomic_load_explicit(&slot->pid, memory_order_acquire);
+        if (pid != w->pid) {
+            // New owner (or freed): start from its current counters
+            memset(w, 0, sizeof(*w));
+            w->pid = pid;
+            w->beats_seen = atomic_load(&slot->beats);
+            w->gap_sum_seen = atomic_load(&slot->gap_sum_ns);
+            if (pid != 0) {
+                snprintf(msg, sizeof(msg), "Monitoring '%s' (PID=%d), heartbeat budget %u ms",
+                         slot->name, pid, slot->budget_ms);
+                log_watchdog(msg);
+            }
+        }
+        if (pid == 0 || atomic_load_explicit(&slot->state, memory_order_acquire) != HEARTBEAT_ACTIVE) {
+            w->stalled = false;
+            continue;
+        }
+
+        uint64_t last = atomic_load_explicit(&slot->last_ns, memory_order_acquire);
+        uint64_t budget_ns = (uint64_t)slot->budget_ms * 1000000ULL;
+        uint64_t gap = (now > last) ? now - last : 0;
+
+        if (gap <= budget_ns) {
+            if (w->stalled) {
+                snprintf(msg, sizeof(msg), "✓ '%s' (PID=%d) recovered after %.0f ms without a heartbeat",
+                         slot->name, pid, (last - w->stall_from_ns) / 1e6);
+                log_watchdog(msg);
+                w->stalled = false;
             }
-            
-            processes[process_count].pid = pid;
-            strncpy(processes[process_count].name, name, 99);
-            processes[process_count].active = 1; // Resets status to 1
-            process_count++;
+            continue;
+        }
+
+        // Past the budget: a process that exited without unregistering is just gone
+        if (kill(pid, 0) == -1 && errno == ESRCH) {
+            snprintf(msg, sizeof(msg), "Process '%s' (PID=%d) no longer exists", slot->name, pid);
+            log_watchdog(msg);
+            release_slot(slot, pid);
+            continue;
+        }
+
+        if (!w->stalled) {
+            w->stalled = true;
+            w->stall_from_ns = last;
+            double detect_ms = (gap - budget_ns) / 1e6;
+            if (detect_ms > detect_max_ms) detect_max_ms = detect_ms;
+            snprintf(msg, sizeof(msg), "✗ '%s' (PID=%d) missed its heartbeat: %.0f ms since the last one "
+                     "(budget %u ms, detected %.1f ms after the deadline)",
+                     slot->name, pid, gap / 1e6, slot->budget_ms, detect_ms);
+            log_watchdog(msg);
+        }
+
+        if (gap > (uint64_t)RESPONSE_TIMEOUT * 1000000000ULL) {
+            // TIMEOUT - TERMINATE
+            snprintf(msg, sizeof(msg), "✗ '%s' (PID=%d) TIMEOUT - TERMINATING", slot->name, pid);
+            log_watchdog(msg);
+            kill(pid, SIGKILL); // Force Kill
+            release_slot(slot, pid);
         }
     }
-    
-    flock(fileno(f), LOCK_UN); // Unlock
-    fclose(f);
-    return process_count;
 }
 
-// Core Logic: Ping -> Wait -> Kill if necessary
-void check_process(int index) {
-    ProcessInfo *proc = &processes[index];
+// Loop time of every monitored process since the previous report
+static void report_latency(int cycle) {
     char msg[256];
-
-    // Check if process still exists in OS
-    if (kill(proc->pid, 0) == -1) {
-        snprintf(msg, 256, "Process '%s' (PID=%d) no longer exists", proc->name, proc->pid);
-        log_watchdog(msg);
-        proc->active = 0;
-        return;
-    }
-    
-    response_received = 0;
-    timeout_occurred = 0;
-    
-    // Send PING
-    snprintf(msg, 256, "Checking '%s' (PID=%d)...", proc->name, proc->pid);
+    snprintf(msg, sizeof(msg), "--- Health Check Cycle #%d --- (worst detection delay %.1f ms)",
+             cycle, detect_max_ms);
     log_watchdog(msg);
-    kill(proc->pid, SIGUSR1);
-    
-    // Set Timeout Alarm
-    alarm(RESPONSE_TIMEOUT);
-    
-    // Wait for PONG or ALARM
-    while (!response_received && !timeout_occurred) {
-        pause(); // Sleep until any signal arrives
-    }
-    
-    alarm(0); // Disable alarm
-    
-    if (response_received) {
-        snprintf(msg, 256, "✓ '%s' (PID=%d) is ALIVE", proc->name, proc->pid);
-        log_watchdog(msg);
-    } else {
-        // TIMEOUT - TERMINATE
-        snprintf(msg, 256, "✗ '%s' (PID=%d) TIMEOUT - TERMINATING", proc->name, proc->pid);
+
+    for (int i = 0; i < HEARTBEAT_MAX_SLOTS; i++) {
+        HeartbeatSlot *slot = &table->slots[i];
+        SlotWatch *w = &watch[i];
+        int pid = atomic_load(&slot->pid);
+        if (pid == 0 || pid != w->pid) continue;
+
+        uint64_t beats = atomic_load(&slot->beats);
+        uint64_t gap_sum = atomic_load(&slot->gap_sum_ns);
+        uint64_t gap_max = atomic_exchange(&slot->gap_max_ns, 0);
+        uint64_t n = beats - w->beats_seen;
+        double mean_ms = (n > 0) ? (gap_sum - w->gap_sum_seen) / 1e6 / n : 0.0;
+        w->beats_seen = beats;
+        w->gap_sum_seen = gap_sum;
+
+        snprintf(msg, sizeof(msg), "%s '%s' (PID=%d): %llu loops, mean %.2f ms, max %.2f ms",
+                 w->stalled ? "✗" : "✓", slot->name, pid, (unsigned long long)n, mean_ms, gap_max / 1e6);
         log_watchdog(msg);
-        kill(proc->pid, SIGKILL); // Force Kill
-        proc->active = 0;
     }
 }
 
-// Main Watchdog Loop, sets up signal handlers and monitors child processes
+// Main Watchdog Loop: scans the heartbeat table, reports loop latency
 int main(int argc, char *argv[]) {
    
     // Standardized exit codes
@@ -171,12 +178,6 @@ int main(int argc, char *argv[]) {
     // Setup Handlers
     struct sigaction sa;
     memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = response_handler;
-    sigaction(SIGUSR2, &sa, NULL);
-    
-    sa.sa_handler = timeout_handler;
-    sigaction(SIGALRM, &sa, NULL);
-
     sa.sa_handler = terminate_handler;
     sigaction(SIGTERM, &sa, NULL);
 
@@ -184,51 +185,48 @@ int main(int argc, char *argv[]) {
     FILE *f = fopen("watchdog_log.log", "w"); if (f) fclose(f);
     log_process("Watchdog", getpid());
     printf("Watchdog started (PID=%d)\n", getpid());
-    
-       
-    printf("Loading processes from process_log.log...\n");
-    while (load_processes() == 0) {
-        sleep(1);
-        LOG_WARNING("Watchdog","No processes to monitor!\n");
-    }
-    
-    LOG_INFO("Watchdog","Monitoring %d processes. Check logs: tail -f watchdog_log.log\n", process_count);
-
 
+    table = heartbeat_attach();
+    if (table == NULL) {
+        LOG_ERROR("Watchdog", "Heartbeat table unavailable, nothing to monitor");
+        return OPEN_FAIL;
+    }
+    LOG_INFO("Watchdog", "Scanning the heartbeat table every %d ms. Check logs: tail -f watchdog_log.log\n",
+             HEARTBEAT_SCAN_MS);
 
+    int scans_per_report = CHECK_INTERVAL * 1000 / HEARTBEAT_SCAN_MS;
     int cycle = 0;
+    int scans = 0;
+    bool seen_any = false;
     while (1) {
         if (terminate_flag) {
             log_watchdog("Watchdog received termination signal, exiting.");
             break;  // Exit if termination signal received
         }
 
-        // Just sleep and restart the loop to keep the process alive.
-        if (mode == 2 || mode == 3) {
-            sleep(CHECK_INTERVAL);
-            continue;
-        }
+        usleep(HEARTBEAT_SCAN_MS * 1000);
+
+        // Client/Server mode: nothing is monitored, just stay alive
+        if (mode == 2 || mode == 3) continue;
+
+        scan_slots();
 
-        sleep(CHECK_INTERVAL);
-        cycle++;
-        load_processes();
-        char msg[256];
-        snprintf(msg, 256, "--- Health Check Cycle #%d ---", cycle);
-        log_watchdog(msg);
-        
         int alive = 0;
-        for (int i = 0; i < process_count; i++) {
-            if (processes[i].active) {
-                check_process(i);
-                if (processes[i].active) alive++;
-            }
+        for (int i = 0; i < HEARTBEAT_MAX_SLOTS; i++) {
+            if (atomic_load(&table->slots[i].pid) != 0) alive++;
         }
-        
-        if (alive == 0) {
+        if (alive > 0) seen_any = true;
+        if (seen_any && alive == 0) {
             LOG_INFO("Watchdog","\nAll processes dead. Watchdog exiting.\n");
             log_watchdog("All processes dead. Watchdog exiting.");
             break;
         }
+
+        if (++scans == scans_per_report) {
+            scans = 0;
+            report_latency(++cycle);
+        }
     }
+    heartbeat_detach(table);
     return 0;
-}
\ No newline at end of file
+}
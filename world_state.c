@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "world_state.h"
+
+void seqlock_write_begin(SeqLock *lock) {
+    unsigned s = atomic_load_explicit(&lock->seq, memory_order_relaxed);
+    atomic_store_explicit(&lock->seq, s + 1, memory_order_relaxed);
+    // Order the odd sequence before any of the data stores
+    atomic_thread_fence(memory_order_release);
+}
+
+void seqlock_write_end(SeqLock *lock) {
+    unsigned s = atomic_load_explicit(&lock->seq, memory_order_relaxed);
+    atomic_store_explicit(&lock->seq, s + 1, memory_order_release);
+}
+
+unsigned seqlock_read_begin(const SeqLock *lock) {
+    unsigned s;
+    // Wait out a writer that is halfway through
+    while ((s = atomic_load_explicit((atomic_uint *)&lock->seq, memory_order_acquire)) & 1u) {
+    }
+    return s;
+}
+
+bool seqlock_read_retry(const SeqLock *lock, unsigned start) {
+    // Order the data loads before re-checking the sequence
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit((atomic_uint *)&lock->seq, memory_order_relaxed) != start;
+}
+
+static WorldState* world_map(int flags) {
+    int fd = shm_open(WORLD_SHM_NAME, flags, 0666);
+    if (fd == -1) {
+        perror("shm_open world state");
+        return NULL;
+    }
+
+    if ((flags & O_CREAT) && ftruncate(fd, sizeof(WorldState)) == -1) {
+        perror("ftruncate world state");
+        close(fd);
+        return NULL;
+    }
+
+    void *p = mmap(NULL, sizeof(WorldState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the segment alive
+    if (p == MAP_FAILED) {
+        perror("mmap world state");
+        return NULL;
+    }
+    return (WorldState *)p;
+}
+
+WorldState* world_create(void) {
+    // Drop any segment left over from a crashed run
+    shm_unlink(WORLD_SHM_NAME);
+    WorldState *ws = world_map(O_CREAT | O_RDWR | O_TRUNC);
+    if (ws != NULL) {
+        memset(ws, 0, sizeof(*ws));
+    }
+    return ws;
+}
+
+WorldState* world_attach(void) {
+    return world_map(O_RDWR);
+}
+
+void world_detach(WorldState *ws) {
+    if (ws != NULL) munmap(ws, sizeof(WorldState));
+}
+
+void world_unlink(void) {
+    shm_unlink(WORLD_SHM_NAME);
+}
+
+void world_publish_drone(WorldState *ws, float x, float y, float vx, float vy, uint32_t reset_ack,
+                         uint64_t t_in_us) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    seqlock_write_begin(&ws->drone_lock);
+    ws->drone.gen++;
+    ws->drone.reset_ack = reset_ack;
+    ws->drone.x = x;
+    ws->drone.y = y;
+    ws->drone.vx = vx;
+    ws->drone.vy = vy;
+    ws->drone.t_us = (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+    ws->drone.t_in_us = t_in_us;
+    seqlock_write_end(&ws->drone_lock);
+}
+
+void world_read_drone(WorldState *ws, DroneSnapshot *out) {
+    unsigned s;
+    do {
+        s = seqlock_read_begin(&ws->drone_lock);
+        memcpy(out, &ws->drone, sizeof(*out));
+    } while (seqlock_read_retry(&ws->drone_lock, s));
+}
+
+void world_publish_reset(WorldState *ws, float x, float y) {
+    seqlock_write_begin(&ws->reset_lock);
+    ws->reset.gen++;
+    ws->reset.x = x;
+    ws->reset.y = y;
+    seqlock_write_end(&ws->reset_lock);
+}
+
+void world_read_reset(WorldState *ws, ResetSnapshot *out) {
+    unsigned s;
+    do {
+        s = seqlock_read_begin(&ws->reset_lock);
+        memcpy(out, &ws->reset, sizeof(*out));
+    } while (seqlock_read_retry(&ws->reset_lock, s));
+}
+
+void world_publish_items(WorldState *ws, const ItemsSnapshot *items) {
+    seqlock_write_begin(&ws->items_lock);
+    memcpy(&ws->items, items, sizeof(*items));
+    seqlock_write_end(&ws->items_lock);
+}
+
+void world_read_items(WorldState *ws, ItemsSnapshot *out) {
+    unsigned s;
+    do {
+        s = seqlock_read_begin(&ws->items_lock);
+        memcpy(out, &ws->items, sizeof(*out));
+    } while (seqlock_read_retry(&ws->items_lock, s));
+}
@@ -0,0 +1,87 @@
+// world_state.h
+#ifndef WORLD_STATE_H
+#define WORLD_STATE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Shared-memory blackboard
+// Master creates one POSIX shared-memory segment holding the latest world
+// state. Each section has exactly one writer and is guarded by a seqlock:
+// the writer bumps the sequence to odd, writes, and bumps it back to even;
+// readers copy the section and retry if the sequence moved underneath them.
+// Reading is a couple of loads and a memcpy, with no syscalls.
+
+#define WORLD_SHM_NAME "/arp_world_state"
+#define WORLD_MAX_ITEMS 20
+#define WORLD_MAX_REMOTES 64
+
+typedef struct {
+    atomic_uint seq;
+} SeqLock;
+
+typedef struct {
+    float x;
+    float y;
+} WorldPoint;
+
+// Written by the Drone every integration step
+typedef struct {
+    uint32_t gen;          // Incremented on every publish
+    uint32_t reset_ack;    // Last reset generation the drone has applied
+    float x, y;            // Position
+    float vx, vy;          // Velocity (cells per second)
+    uint64_t t_us;         // When it was published (CLOCK_MONOTONIC us)
+    uint64_t t_in_us;      // Newest key reflected, see latency_hist.h (0 = none)
+} DroneSnapshot;
+
+// Written by the BlackBoard when it moves the drone (start, reset, clamp, resize)
+typedef struct {
+    uint32_t gen;          // 0 = nothing published yet
+    float x, y;
+} ResetSnapshot;
+
+// Written by the BlackBoard whenever obstacles, targets or the remote drones change
+typedef struct {
+    int obs_count;
+    int tar_count;
+    WorldPoint obstacles[WORLD_MAX_ITEMS];
+    WorldPoint targets[WORLD_MAX_ITEMS];
+    int remote_count;
+    WorldPoint remotes[WORLD_MAX_REMOTES];
+} ItemsSnapshot;
+
+typedef struct {
+    SeqLock drone_lock;
+    DroneSnapshot drone;
+
+    SeqLock reset_lock;
+    ResetSnapshot reset;
+
+    SeqLock items_lock;
+    ItemsSnapshot items;
+} WorldState;
+
+// Seqlock primitives
+void seqlock_write_begin(SeqLock *lock);
+void seqlock_write_end(SeqLock *lock);
+unsigned seqlock_read_begin(const SeqLock *lock);
+bool seqlock_read_retry(const SeqLock *lock, unsigned start);
+
+// Segment lifetime: Master creates/unlinks, children attach/detach
+WorldState* world_create(void);
+WorldState* world_attach(void);
+void world_detach(WorldState *ws);
+void world_unlink(void);
+
+// Publish / snapshot helpers
+void world_publish_drone(WorldState *ws, float x, float y, float vx, float vy, uint32_t reset_ack,
+                         uint64_t t_in_us);
+void world_read_drone(WorldState *ws, DroneSnapshot *out);
+void world_publish_reset(WorldState *ws, float x, float y);
+void world_read_reset(WorldState *ws, ResetSnapshot *out);
+void world_publish_items(WorldState *ws, const ItemsSnapshot *items);
+void world_read_items(WorldState *ws, ItemsSnapshot *out);
+
+#endif